@@ -24,7 +24,12 @@ entity efbx is
         wb_ack_o  : out   std_logic;
         i2c1_scl  : inout std_logic;
         i2c1_sda  : inout std_logic;
-        i2c1_irqo : out   std_logic       );
+        i2c1_irqo : out   std_logic;
+        spi_clk   : inout std_logic;
+        spi_miso  : inout std_logic;
+        spi_mosi  : inout std_logic;
+        spi_scsn  : in    std_logic;
+        spi_irq   : out   std_logic       );
 end efbx;
 
 architecture struct of efbx is
@@ -32,7 +37,10 @@ architecture struct of efbx is
   signal scuba_vhi, scuba_vlo,
          i2c1_sdao, i2c1_sdaoen,
          i2c1_sclo, i2c1_scloen,
-         i2c1_sdai, i2c1_scli     : std_logic;
+         i2c1_sdai, i2c1_scli,
+         spi_scki, spi_scko, spi_scken,
+         spi_misoi, spi_misoo, spi_misoen,
+         spi_mosii, spi_mosio, spi_mosien : std_logic;
 
   -------------------------------------------------
   component VHI
@@ -61,11 +69,20 @@ begin
     BB1_scl: BB port map (I=>i2c1_sclo, T=>i2c1_scloen, O=>i2c1_scli,
                           B=>i2c1_scl);
 
+    BBspi_clk:  BB port map (I=>spi_scko, T=>spi_scken, O=>spi_scki,
+                             B=>spi_clk);
+
+    BBspi_miso: BB port map (I=>spi_misoo, T=>spi_misoen, O=>spi_misoi,
+                             B=>spi_miso);
+
+    BBspi_mosi: BB port map (I=>spi_mosio, T=>spi_mosien, O=>spi_mosii,
+                             B=>spi_mosi);
+
     EFBInst_0: EFB
       generic map (
         EFB_I2C1              => "ENABLED",
         EFB_I2C2              => "DISABLED",
-        EFB_SPI               => "DISABLED",
+        EFB_SPI               => "ENABLED",
         EFB_TC                => "ENABLED",
         EFB_TC_PORTMODE       => "WB",
         EFB_UFM               => "ENABLED",
@@ -103,7 +120,7 @@ begin
         SPI_CLK_INV           => "DISABLED",
         SPI_LSB_FIRST         => "DISABLED",
         SPI_CLK_DIVIDER       =>  1,
-        SPI_MODE              => "MASTER",
+        SPI_MODE              => "SLAVE",
 
         I2C2_WAKEUP           => "DISABLED",
         I2C2_GEN_CALL         => "DISABLED",
@@ -162,10 +179,10 @@ begin
         I2C1SDAI    => i2c1_sdai,
         I2C2SCLI    => scuba_vlo,
         I2C2SDAI    => scuba_vlo,
-        SPISCKI     => scuba_vlo,
-        SPIMISOI    => scuba_vlo,
-        SPIMOSII    => scuba_vlo,
-        SPISCSN     => scuba_vlo,
+        SPISCKI     => spi_scki,
+        SPIMISOI    => spi_misoi,
+        SPIMOSII    => spi_mosii,
+        SPISCSN     => spi_scsn,
 
         TCCLKI      => wb_clk_i,
         TCRSTN      => "not"(wb_rst_i),   -- resets internal 16-bit clock
@@ -209,12 +226,12 @@ begin
         I2C2SDAOEN  => open,
         I2C1IRQO    => i2c1_irqo,
         I2C2IRQO    => open,
-        SPISCKO     => open,
-        SPISCKEN    => open,
-        SPIMISOO    => open,
-        SPIMISOEN   => open,
-        SPIMOSIO    => open,
-        SPIMOSIEN   => open,
+        SPISCKO     => spi_scko,
+        SPISCKEN    => spi_scken,
+        SPIMISOO    => spi_misoo,
+        SPIMISOEN   => spi_misoen,
+        SPIMOSIO    => spi_mosio,
+        SPIMOSIEN   => spi_mosien,
         SPIMCSN7    => open,
         SPIMCSN6    => open,
         SPIMCSN5    => open,
@@ -224,7 +241,7 @@ begin
         SPIMCSN1    => open,
         SPIMCSN0    => open,
         SPICSNEN    => open,
-        SPIIRQO     => open,
+        SPIIRQO     => spi_irq,
 
         TCINT       => open,
         TCOC        => open,
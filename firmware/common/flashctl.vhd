@@ -22,9 +22,14 @@ library machxo2;    use machxo2.components.all;
 entity flasher is
    port ( SCL,
           SDA           : inout std_logic;
+          SCLK,
+          MOSI,
+          MISO          : inout std_logic;
+          CE1           : in    std_logic;
           GSRn          : in    std_logic;
           LEDR,
-          LEDG          : out   std_logic   );
+          LEDG          : out   std_logic;
+          GPIO25        : out   std_logic   );  -- attention to the Pi
 end flasher;
 
 --=====================================================================
@@ -39,6 +44,10 @@ architecture rtl of flasher is
   component pifwb is port (
       i2c_SCL       : inout std_logic;
       i2c_SDA       : inout std_logic;
+      spi_SCK       : inout std_logic;
+      spi_MOSI      : inout std_logic;
+      spi_MISO      : inout std_logic;
+      spi_CSn       : in    std_logic;
       xclk          : in    std_logic;
       XI            : out   XIrec;
       XO            : in    slv8            );
@@ -48,7 +57,8 @@ architecture rtl of flasher is
       xclk          : in    std_logic;
       XI            : in    XIrec;
       XO            : out   slv8;
-      MiscReg       : out   TMisc           );
+      MiscReg       : out   TMisc;
+      Attn          : out   std_logic       );
   end component pifctl;
   -----------------------------------------------
 
@@ -59,11 +69,17 @@ architecture rtl of flasher is
                                          ,  PWr         => false
                                          ,  PRWA        => 0
                                          ,  PRdSubA     => 0
-                                         ,  PD          => (others=>'0'));
+                                         ,  PD          => (others=>'0')
+                                         ,  PWrSubA     => 0
+                                         ,  PStreamWr   => false
+                                         ,  PStreamD    => (others=>'0')
+                                         ,  PSel        => false
+                                         ,  PEv         => (others=>'0'));
   signal  XO          : slv8          := (others=>'0');
 
   signal  GSRnX       : std_logic;
   signal  MiscReg     : TMisc;
+  signal  Attn        : std_logic;
 
   -- attach a pullup to the GSRn signal
   attribute pullmode  : string;
@@ -78,6 +94,10 @@ begin
   -- wishbone interface
   WB: pifwb      port map ( i2c_SCL     => SCL,
                             i2c_SDA     => SDA,
+                            spi_SCK     => SCLK,
+                            spi_MOSI    => MOSI,
+                            spi_MISO    => MISO,
+                            spi_CSn     => CE1,
                             xclk        => xclk,
                             XI          => XI,
                             XO          => XO           );
@@ -93,7 +113,12 @@ begin
   TC: pifctl     port map ( xclk        => xclk,
                             XI          => XI,
                             XO          => XO,
-                            MiscReg     => MiscReg      );
+                            MiscReg     => MiscReg,
+                            Attn        => Attn         );
+
+  -----------------------------------------------
+  -- attention, active high, see R_ATTN in pifdefs.vhd
+  ATTN_BUF: OB port map ( I=>Attn, O=>GPIO25 );
 
   -----------------------------------------------
   -- drive the LEDs
@@ -101,9 +101,14 @@ signal TestFinished : boolean := false;         -- set 'true' at end of sim
 component flasher is port (
     SCL,
     SDA           : inout std_logic;
+    SCLK,
+    MOSI,
+    MISO          : inout std_logic;
+    CE1           : in    std_logic;
     GSRn          : in    std_logic;
     LEDR,
-    LEDG          : out   std_logic
+    LEDG          : out   std_logic;
+    GPIO25        : out   std_logic
     );
 end component flasher;
 
@@ -112,6 +117,7 @@ signal  ExtClock,
         RSTn        : std_logic := '0';
 
 signal RedLedn,  GreenLedn  : std_logic;
+signal Attn                 : std_logic;
 signal TrigInPad, ClkInPad  : std_logic := '0';
 
 signal outBuf, inBuf : Tbuf;
@@ -127,14 +133,25 @@ signal  i2cToggle               : boolean   := true;
 signal  i2cAckn                 : std_logic;
 
 signal  obSig                   : Tbuf      := (count=>0, data=>(others=>0));
+
+---------------------------------------------
+-- app SPI, idle
+signal  spiSCLK, spiMOSI,
+        spiMISO                 : std_logic := 'Z';
+signal  spiCE1                  : std_logic := '1';
 ---------------------------------------------
 begin
     -- instantiate the design
     UUT : flasher port map ( SCL          => i2cSCL
                            , SDA          => i2cSDA
+                           , SCLK         => spiSCLK
+                           , MOSI         => spiMOSI
+                           , MISO         => spiMISO
+                           , CE1          => spiCE1
                            , GSRn         => RSTn
                            , LEDR         => RedLedn
                            , LEDG         => GreenLedn
+                           , GPIO25       => Attn
                            );
 
     i2cSCL <= 'H';
@@ -176,8 +193,9 @@ STIMULUS: process
   variable  Ibuffstrt   : integer;
   variable  Ibuffend    : integer;
 
-  constant  x1          : time      := 2500 ns;        -- i2c clock
-  constant  x2          : time      := x1 / 2;
+  variable  x1          : time      := 2500 ns;        -- i2c clock
+  variable  x2          : time      := x1 / 2;
+  variable  stretch     : time      := 0 ns;           -- SCL held by slave
 
   variable  outBuf      : Tbuf      := (count=>0, data=>(others=>0));
 
@@ -358,6 +376,20 @@ STIMULUS: process
         write(L, v);
       end write_string;
 
+    ---------------------------------------------
+    -- the slave may hold SCL low after the master releases it. Called
+    -- straight after the release, so the high time is counted from
+    -- when SCL really went high and all of a stretch is measured.
+    procedure sclHigh is
+      variable t0 : time;
+    begin
+      if i2c_sclIn /= '1' then
+        t0 := now;
+        wait until i2c_sclIn = '1';
+        stretch := stretch + (now - t0);
+      end if;
+    end procedure sclHigh;
+
     ---------------------------------------------
     --       <--- i2cStart ---->   or <-- Rep i2cStart ->
     -- time     |   |   |   |         |   |   |   |
@@ -389,7 +421,7 @@ STIMULUS: process
     procedure i2cSendBit(b:std_logic) is
     begin
       i2c_sdaOut <=  b ;    wait for x2;
-      i2c_sclOut <= '1';    wait for x2;
+      i2c_sclOut <= '1';    sclHigh;        wait for x2;
       i2c_sclOut <= '0';    wait for x2;
     end procedure i2cSendBit;
 
@@ -397,7 +429,7 @@ STIMULUS: process
     procedure i2cDoClock is
     begin
       i2c_sclOut <= '0';    wait for x2;
-      i2c_sclOut <= '1';    wait for x2;
+      i2c_sclOut <= '1';    sclHigh;        wait for x2;
       i2c_sclOut <= '0';    wait for x2;
     end procedure i2cDoClock;
 
@@ -471,6 +503,17 @@ STIMULUS: process
       writeD(ToInteger(x));
     end writexD;
 
+    -- an X byte, then untagged bytes through writeB
+    procedure writeX(Addr: in integer) is
+    begin
+      writeBus(X_ADDR & n2slv(Addr,I2C_DATA_BITS));
+    end writeX;
+
+    procedure writeB(V : in integer) is
+    begin
+      writeBus(n2slv(V,8));
+    end writeB;
+
     procedure writeA(Addr: in integer) is
     begin
       writeBus(A_ADDR & n2slv(Addr,I2C_DATA_BITS));
@@ -512,6 +555,70 @@ STIMULUS: process
       i2cStop;
     end readReg;
 
+    ---------------------------------------------
+    -- the FIFO header and rdCount data bytes in one read, timed
+    procedure readFifo(rdCount:integer) is
+      variable i2cAckn : std_logic;
+      variable v       : slv8;
+      variable level   : integer := 0;
+      variable t0      : time;
+      variable us      : integer;
+    begin
+      t0 := now;
+      i2cRdStart;
+      for i in 0 to (FIFO_HDR_BYTES + rdCount -1) loop
+        if i < (FIFO_HDR_BYTES + rdCount -1) then
+          i2cAckn := '0';
+        else
+          i2cAckn := '1';
+        end if;
+        i2cRecvBit(v, i2cAckn);
+        if i = 0 then
+          level := ToInteger(v);
+        elsif i = 1 then
+          level := level + 256 * ToInteger(v(2 downto 0));
+          if v(7) = '1' then
+            write_string(Lout, "  overflow");
+          end if;
+        elsif (i = FIFO_HDR_BYTES) or (i = FIFO_HDR_BYTES + rdCount -1) then
+          write_string(Lout, "  " & hstr8(ToInteger(v)));
+        end if;
+      end loop;
+      i2cStop;
+      us := (now - t0) / 1 us;
+      write_string(Lout, "  level ");
+      write(Lout, level);
+      write_string(Lout, ", ");
+      write(Lout, us);
+      write_string(Lout, "us, bytes/s ");
+      write(Lout, (rdCount * 1000000) / us);
+    end readFifo;
+
+    ---------------------------------------------
+    -- wrCount data bytes to register Reg in one write, timed. Reports
+    -- the sustained byte rate and the clock stretch per byte
+    procedure burstWrite(Reg:integer; wrCount:integer) is
+      variable t0      : time;
+      variable ns      : integer;
+    begin
+      stretch := 0 ns;
+      t0 := now;
+      i2cWrStart;
+      i2cSendByte(A_ADDR & n2slv(Reg,I2C_DATA_BITS));
+      for i in 0 to (wrCount-1) loop
+        i2cSendByte(D_ADDR & n2slv(i mod 64,I2C_DATA_BITS));
+      end loop;
+      i2cStop;
+      ns := (now - t0) / 1 ns;
+      write_string(Lout, "  ");
+      write(Lout, ns / 1000);
+      write_string(Lout, "us, kB/s on the bus ");
+      write(Lout, ((wrCount + 2) * 1000) / (ns / 1000));
+      write_string(Lout, ", stretch/byte ");
+      write(Lout, (stretch / 1 ns) / (wrCount + 2));
+      write_string(Lout, "ns");
+    end burstWrite;
+
 ------------------------------------------------------------------
   variable  dummy   : integer;
   variable  trace   : boolean := true;
@@ -529,9 +636,17 @@ STIMULUS: process
 --    data hex_data
 -- address to wrData array
 --    addr hex_addr
+-- X byte and untagged bytes to wrData array
+--    write_x decimal_addr
+--    write_b hex_data
 -- write:
 --    write
 --    takes data from the wrData array
+-- FIFO drain, timed:
+--    readfifo decimal_num
+-- write burst, timed, and the I2C clock for what follows:
+--    burst decimal_reg decimal_num
+--    i2cclock decimal_khz
 begin
     TestFinished <= false;
 
@@ -573,6 +688,12 @@ begin
         when "WRITE_D_"  =>
               InputHexAsInt(Val);
               writeD(Val);
+        when "WRITE_X_"  =>
+              InputDecAsInt(Val);
+              writeX(Val);
+        when "WRITE_B_"  =>
+              InputHexAsInt(Val);
+              writeB(Val);
         when "FLUSH___"  =>
               flush;
         when "READ____"  =>
@@ -594,6 +715,32 @@ begin
               write(Lout, Reg );
               ReadReg(Count);
               writeline(OUTPUT, Lout);
+        when "READFIFO"  =>
+              InputDecAsInt(Count);
+              writeA(R_FIFO);
+              flush;
+              write_string(Lout, "  FIFO read (");
+              write(Lout, Count );
+              write_string(Lout, ")");
+              readFifo(Count);
+              writeline(OUTPUT, Lout);
+        when "BURST___"  =>
+              InputDecAsInt(Reg);
+              InputDecAsInt(Count);
+              write_string(Lout, "  Burst write (");
+              write(Lout, Count );
+              write_string(Lout, ") of register ");
+              write(Lout, Reg );
+              burstWrite(Reg, Count);
+              writeline(OUTPUT, Lout);
+        when "ATTN____"  =>
+              write_string(Lout, "  Attention is ");
+              write(Lout, to_x01(Attn));
+              writeline(OUTPUT, Lout);
+        when "I2CCLOCK"  =>
+              InputDecAsInt(Val);
+              x1 := 1 ms / Val;
+              x2 := x1 / 2;
         when "ECHO____"  =>
               SkipSpaces;
               write_string(Lout, Ibuff(Ibuffstrt to Ibuffend));
@@ -13,28 +13,99 @@ entity pifctl is
   port (xclk            : in    std_logic;
         XI              : in    XIrec;
         XO              : out   slv8;
-        MiscReg         : out   TMisc  );
+        MiscReg         : out   TMisc;
+        Attn            : out   std_logic );
 end pifctl;
 
 architecture rtl of pifctl is
 
+  -----------------------------------------------
+  component piffifo is
+    generic ( ABITS : integer := FIFO_ABITS );
+    port (
+      xclk          : in    std_logic;
+      clr           : in    boolean;
+      wr            : in    boolean;
+      din           : in    slv8;
+      rd            : in    boolean;
+      dout          : out   slv8;
+      level         : out   unsigned(ABITS downto 0);
+      ovf           : out   boolean         );
+  end component piffifo;
+  -----------------------------------------------
+
   signal  ScratchReg    : TwrData := n2slv(21, I2C_DATA_BITS);  -- 15h
   signal  MiscRegLocal  : TMisc   := LED_SYNC;
 
+  signal  FifoRun
+        , FifoClr
+        , FifoWr
+        , FifoRd
+        , FifoOvf       : boolean := false;
+  signal  FifoRate      : integer range 0 to 15 := 0;
+  signal  FifoSrc
+        , FifoDout      : slv8    := (others=>'0');
+  signal  FifoLevel
+        , FifoSnap
+        , FifoBudget    : unsigned(FIFO_ABITS downto 0) := (others=>'0');
+  signal  FifoHdr       : integer range 0 to FIFO_HDR_BYTES := 0;
+
+  type    TperfCounts is array (0 to PERF_NUM-1) of unsigned(PERF_BITS-1 downto 0);
+  signal  PerfCount
+        , PerfSnap      : TperfCounts := (others=>(others=>'0'));
+  signal  PerfClr       : boolean := false;
+
+  type    TwideRam is array (0 to WIDE_BYTES-1) of slv8;
+  signal  WideRam       : TwideRam := (others=>(others=>'0'));
+
+  type    TloopRam is array (0 to LOOP_BYTES-1) of slv8;
+  signal  LoopRam       : TloopRam := (others=>(others=>'0'));
+  signal  LoopWrA       : integer range 0 to LOOP_BYTES := 0;
+
+  signal  StreamCount   : unsigned(15 downto 0) := (others=>'0');
+  signal  StreamSum     : unsigned( 7 downto 0) := (others=>'0');
+
+  signal  AttnFlags
+        , AttnSnap
+        , AttnMask
+        , AttnSet       : Tattn   := (others=>'0');
+  signal  AttnPin       : std_logic := '0';
+
 begin
   ---------------------------------------------------------------------
   -- the inner case statement can be extended to write to many registers
   process (xclk)
   begin
     if rising_edge(xclk) then
+      FifoClr <= false;
+      PerfClr <= false;
+      AttnSet <= (others=>'0');
       if XI.PWr then
         case XI.PRWA is
 
           when W_SCRATCH_REG =>
-            ScratchReg <= XI.PD;
+            ScratchReg <= XI.PD(TincomingDataRange);
 
           when W_MISC_REG =>
-            MiscRegLocal <= ToInteger(XI.PD);
+            MiscRegLocal <= ToInteger(XI.PD(TincomingDataRange));
+
+          when W_FIFO_CTL =>
+            FifoRun  <= (XI.PD(FIFO_CTL_RUN)   = '1');
+            FifoClr  <= (XI.PD(FIFO_CTL_CLEAR) = '1');
+            FifoRate <= ToInteger(XI.PD(TfifoRateRange));
+
+          when W_WIDE_REG =>
+            WideRam(XI.PWrSubA mod WIDE_BYTES) <= XI.PD;
+
+          when W_PERF_CTL =>
+            PerfClr  <= (XI.PD(PERF_CTL_CLEAR) = '1');
+
+          when W_ATTN_CTL =>
+            if XI.PWrSubA = W_ATTN_SET then
+              AttnSet  <= XI.PD(Tattn'range);
+            elsif XI.PWrSubA = W_ATTN_MASK then
+              AttnMask <= XI.PD(Tattn'range);
+            end if;
 
           when others => null;
         end case;
@@ -42,6 +113,143 @@ begin
     end if;
   end process;
 
+  ---------------------------------------------------------------------
+  -- stream sink, bytes unpacked by pifwb. Counted and summed so the
+  -- host can check what arrived; a real design would consume them here.
+  -- The first LOOP_BYTES after a select of the register are kept for
+  -- R_STREAM_LOOP to send back.
+  process (xclk)
+  begin
+    if rising_edge(xclk) then
+      if XI.PStreamWr then
+        StreamCount <= StreamCount +1;
+        StreamSum   <= StreamSum + unsigned(XI.PStreamD);
+      end if;
+      if XI.PSel and (XI.PRWA = W_STREAM_REG) then
+        LoopWrA <= 0;
+      elsif XI.PStreamWr and (LoopWrA < LOOP_BYTES) then
+        LoopRam(LoopWrA) <= XI.PStreamD;
+        LoopWrA <= LoopWrA +1;
+      end if;
+    end if;
+  end process;
+
+  ---------------------------------------------------------------------
+  -- FIFO to the host. The test source stands in for sampled data, a
+  -- counting byte every 2**FifoRate clocks while running.
+  FIFO_B: block
+    signal tick : unsigned(15 downto 0) := (others=>'0');
+  begin
+    FIFO: piffifo port map ( xclk   => xclk,
+                             clr    => FifoClr,
+                             wr     => FifoWr,
+                             din    => FifoSrc,
+                             rd     => FifoRd,
+                             dout   => FifoDout,
+                             level  => FifoLevel,
+                             ovf    => FifoOvf      );
+
+    process (xclk)
+      variable mask : unsigned(15 downto 0);
+    begin
+      if rising_edge(xclk) then
+        mask   := shift_left(to_unsigned(1, 16), FifoRate) -1;
+        FifoWr <= false;
+        if FifoClr then
+          tick    <= (others=>'0');
+          FifoSrc <= (others=>'0');
+        elsif FifoRun then
+          tick <= tick +1;
+          if (tick and mask) = 0 then
+            FifoWr  <= true;
+            FifoSrc <= std_logic_vector(unsigned(FifoSrc) +1);
+          end if;
+        end if;
+      end if;
+    end process;
+
+    -- an address byte snapshots the level. A read then drains that
+    -- many bytes after the header; pifwb's PRdFinished pops each one
+    -- once it is in the EFB's shift register, the same clock the
+    -- sub-address moves. The byte waiting in TXDR when the master
+    -- stops early stays in the FIFO for the next read.
+    process (xclk)
+    begin
+      if rising_edge(xclk) then
+        if XI.PSel then
+          FifoHdr    <= 0;
+          FifoSnap   <= FifoLevel;
+          FifoBudget <= FifoLevel;
+        elsif XI.PRdFinished and (XI.PRWA = R_FIFO) then
+          if FifoHdr < FIFO_HDR_BYTES then
+            FifoHdr <= FifoHdr +1;
+          elsif FifoBudget /= 0 then
+            FifoBudget <= FifoBudget -1;
+          end if;
+        end if;
+      end if;
+    end process;
+
+    FifoRd <= XI.PRdFinished and (XI.PRWA = R_FIFO)
+          and (FifoHdr = FIFO_HDR_BYTES) and (FifoBudget /= 0);
+  end block FIFO_B;
+
+  ---------------------------------------------------------------------
+  -- performance counters, a snapshot when R_PERF is selected so that a
+  -- multi-byte read is consistent
+  process (xclk)
+  begin
+    if rising_edge(xclk) then
+      for i in 0 to PERF_NUM-1 loop
+        if PerfClr then
+          PerfCount(i) <= (others=>'0');
+        elsif XI.PEv(i) = '1' then
+          PerfCount(i) <= PerfCount(i) +1;
+        end if;
+      end loop;
+      if XI.PSel and (XI.PRWA = R_PERF) then
+        PerfSnap <= PerfCount;
+      end if;
+    end if;
+  end process;
+
+  ---------------------------------------------------------------------
+  -- attention flags. The select snapshots them and reading the flags
+  -- byte clears what the snapshot holds, so an event after the select
+  -- is kept for the next read. A select for a write clears nothing.
+  process (xclk)
+    variable ev   : Tattn;
+    variable ovfQ : boolean := false;
+  begin
+    if rising_edge(xclk) then
+      ev := AttnSet;
+      if FifoWr then
+        ev(ATTN_FIFO) := '1';
+      end if;
+      if FifoOvf and not ovfQ then
+        ev(ATTN_FIFO_OVF) := '1';
+      end if;
+      if XI.PStreamWr then
+        ev(ATTN_STREAM) := '1';
+      end if;
+      ovfQ := FifoOvf;
+
+      if XI.PSel and (XI.PRWA = R_ATTN) then
+        AttnSnap  <= AttnFlags;
+      end if;
+      if XI.PRdFinished and (XI.PRWA = R_ATTN)
+                        and (XI.PRdSubA = R_ATTN_FLAGS) then
+        AttnFlags <= (AttnFlags and not AttnSnap) or ev;
+      else
+        AttnFlags <= AttnFlags or ev;
+      end if;
+
+      AttnPin <= to_sl(unsigned(AttnFlags and AttnMask) /= 0);
+    end if;
+  end process;
+
+  Attn <= AttnPin;
+
   ---------------------------------------------------------------------
   -- readout to the wishbone controller
   READBACK: block
@@ -54,7 +262,17 @@ begin
       variable IDscratch
              , IDletter
              , subOut
+             , streamOut
+             , fifoOut
+             , wideOut
+             , perfOut
+             , attnOut
+             , loopOut
+             , loopCur
+             , loopPrev
              , regOut     : slv8;
+      variable  perfWord  : unsigned(PERF_BITS-1 downto 0);
+      variable  loopA     : integer range 0 to 3*(XSUBA_MAX/4) +2;
     begin
       if rising_edge(xclk) then
         IDscratch := "01" & ScratchReg;
@@ -73,11 +291,99 @@ begin
         if (subAddr = R_ID_MISC) then
           subOut := n2slv(5, 4) & n2slv(MiscRegLocal, 4);  -- 50h='P'...
         end if;
+        if (subAddr = R_ID_CAPS) then
+          subOut := CAPS;
+        end if;
+        if (subAddr = R_ID_CAPS2) then
+          subOut := CAPS2;
+        end if;
+
+        case XI.PRdSubA is
+          when R_STREAM_CNT_LO => streamOut := std_logic_vector(StreamCount( 7 downto 0));
+          when R_STREAM_CNT_HI => streamOut := std_logic_vector(StreamCount(15 downto 8));
+          when R_STREAM_SUM    => streamOut := std_logic_vector(StreamSum);
+          when others          => streamOut := (others=>'0');
+        end case;
+
+        if FifoHdr = 0 then
+          fifoOut := std_logic_vector(FifoSnap(7 downto 0));
+        elsif FifoHdr = 1 then
+          fifoOut := to_sl(FifoOvf) & "0000"
+                   & std_logic_vector(FifoSnap(FIFO_ABITS downto 8));
+        elsif FifoBudget /= 0 then
+          fifoOut := FifoDout;
+        else
+          fifoOut := (others=>'0');
+        end if;
+
+        wideOut := WideRam(XI.PRdSubA mod WIDE_BYTES);
+
+        perfOut := (others=>'0');
+        if XI.PRdSubA < 3*PERF_NUM then
+          perfWord := PerfSnap(XI.PRdSubA / 3);
+          case XI.PRdSubA mod 3 is
+            when 0      => perfOut := std_logic_vector(perfWord( 7 downto  0));
+            when 1      => perfOut := std_logic_vector(perfWord(15 downto  8));
+            when others => perfOut := std_logic_vector(perfWord(23 downto 16));
+          end case;
+        end if;
+
+        case XI.PRdSubA is
+          when R_ATTN_FLAGS   => attnOut := "00" & AttnSnap;
+          when R_ATTN_MASK    => attnOut := "00" & AttnMask;
+          when R_ATTN_FIFO_LO => attnOut := std_logic_vector(FifoSnap(7 downto 0));
+          when R_ATTN_FIFO_HI => attnOut := to_sl(FifoOvf) & "0000"
+                                          & std_logic_vector(FifoSnap(FIFO_ABITS downto 8));
+          when R_ATTN_CNT_LO  => attnOut := std_logic_vector(StreamCount( 7 downto 0));
+          when R_ATTN_CNT_HI  => attnOut := std_logic_vector(StreamCount(15 downto 8));
+          when others         => attnOut := (others=>'0');
+        end case;
+
+        -- symbol n of a group of 4 ends in byte 3*group + n and the
+        -- byte before gives its first bits; symbol 3 is all of byte
+        -- 3*group +2. See R_STREAM_LOOP.
+        if XI.PRdSubA mod 4 = 3 then
+          loopA := 3 * (XI.PRdSubA / 4) + 2;
+        else
+          loopA := 3 * (XI.PRdSubA / 4) + XI.PRdSubA mod 4;
+        end if;
+        loopCur  := (others=>'0');
+        loopPrev := (others=>'0');
+        if loopA < LOOP_BYTES then
+          loopCur := LoopRam(loopA);
+        end if;
+        if (loopA > 0) and (loopA <= LOOP_BYTES) then
+          loopPrev := LoopRam(loopA -1);
+        end if;
+        case XI.PRdSubA mod 4 is
+          when 0      => loopOut := D_ADDR & loopCur(7 downto 2);
+          when 1      => loopOut := D_ADDR & loopPrev(1 downto 0) & loopCur(7 downto 4);
+          when 2      => loopOut := D_ADDR & loopPrev(3 downto 0) & loopCur(7 downto 6);
+          when others => loopOut := D_ADDR & loopCur(5 downto 0);
+        end case;
 
         regOut := (others=>'0');
         if (XI.PRWA = R_ID) then
           regOut := subOut;
         end if;
+        if (XI.PRWA = R_STREAM) then
+          regOut := streamOut;
+        end if;
+        if (XI.PRWA = R_FIFO) then
+          regOut := fifoOut;
+        end if;
+        if (XI.PRWA = R_WIDE) then
+          regOut := wideOut;
+        end if;
+        if (XI.PRWA = R_PERF) then
+          regOut := perfOut;
+        end if;
+        if (XI.PRWA = R_ATTN) then
+          regOut := attnOut;
+        end if;
+        if (XI.PRWA = R_STREAM_LOOP) then
+          regOut := loopOut;
+        end if;
 
         IdReadback <= regOut;
       end if;
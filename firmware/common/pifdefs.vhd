@@ -31,6 +31,7 @@ package defs is
 
   constant A_ADDR         : slv2 := "00";
   constant D_ADDR         : slv2 := "01";
+  constant X_ADDR         : slv2 := "11";   -- 8-bit data follows, see below
 
   constant I2C_TYPE_BITS  : integer := 2;
   constant I2C_DATA_BITS  : integer := 6;
@@ -41,23 +42,53 @@ package defs is
   subtype TwrData   is std_logic_vector(TincomingDataRange);
   subtype TbyteType is std_logic_vector(TincomingTypeRange);
 
-  constant XA_BITS        : integer := 4;                 -- 16 registers
+  -- an A byte or an SPI command reaches the first 16 registers, an X
+  -- byte all 64. After an X byte the rest of the I2C write is untagged
+  -- 8-bit data for that register, until the stop or repeated start.
+  constant XA_BITS        : integer := 6;                 -- 64 registers
+  constant XA_TAG_BITS    : integer := 4;                 -- 16 from A bytes
   constant XSUBA_BITS     : integer := 7;                 -- 128 sub-addresses
   constant XSUBA_MAX      : integer := 2**XSUBA_BITS -1;
 
   subtype TXARange is integer range XA_BITS-1 downto 0;
+  subtype TXATagRange is integer range XA_TAG_BITS-1 downto 0;
   subtype TXA      is integer range 0 to 2**XA_BITS -1;
   subtype TXSubA   is integer range 0 to XSUBA_MAX;
 
   subtype TXDRange is integer range 0 to (2**I2C_DATA_BITS) -1;
 
+  -- SPI interface --------------------------------------------
+  -- EFB SPI slave, selected by CE1. A transaction starts with a
+  -- command byte, bit 7 set for a write, bits 5..0 the register.
+  -- Write data follows as full bytes; a read has one turnaround
+  -- byte before the data.
+  constant SPI_CMD_WRITE  : integer := 7;
+
+  -- performance counter events, single-clock strobes from pifwb
+  constant PERF_RX        : integer := 0;   -- I2C byte received
+  constant PERF_TX        : integer := 1;   -- I2C byte sent
+  constant PERF_ADDR      : integer := 2;   -- A or X byte
+  constant PERF_DATA      : integer := 3;   -- D byte or X data byte
+  constant PERF_NAK       : integer := 4;   -- read ended by the master
+  constant PERF_WB        : integer := 5;   -- Wishbone cycle for I2C
+  constant PERF_RESTART   : integer := 6;   -- state machine to WBstart
+  constant PERF_SVC       : integer := 7;   -- clock spent on I2C bytes
+  constant PERF_NUM       : integer := 8;
+  subtype  TperfEv is std_logic_vector(PERF_NUM-1 downto 0);
+
   -------------------------------------------------------------
   type XIrec is record          -- write data for regs
     PWr         : boolean;      -- registered single-clock write strobe
     PRWA        : TXA;          -- registered incoming addr bus
     PRdFinished : boolean;      -- registered in clock PRDn goes off
     PRdSubA     : TXSubA;       -- read sub-address
-    PD          : TwrData;      -- registered incoming data bus
+    PD          : slv8;         -- registered incoming data bus, a
+                                --  tagged write sets the low 6 bits
+    PWrSubA     : TXSubA;       -- write sub-address
+    PStreamWr   : boolean;      -- single-clock strobe, unpacked byte
+    PStreamD    : slv8;         -- unpacked stream byte
+    PSel        : boolean;      -- single-clock strobe, address byte seen
+    PEv         : TperfEv;      -- performance counter events
   end record XIrec;
 
   -------------------------------------------------------------
@@ -68,12 +99,27 @@ package defs is
   --  0     ID                        BX4/8/16 = G/L/A
   --  1     Scratch
   --  2     Misc                      plus 30h -> 0/1/2/3
-  --  3..31 ID letter                 abcdefghij...
+  --  3     capabilities              Ah in bits 7..4, older builds
+  --                                  give the letter 'c' here
+  --  4     more capabilities         the same, 'd' from older builds
+  --  5..31 ID letter                 efghij...
   --
   constant R_ID_NUM_SUBS    : integer := 32;
   constant R_ID_ID          : integer := 0;
   constant R_ID_SCRATCH     : integer := 1;
   constant R_ID_MISC        : integer := 2;
+  constant R_ID_CAPS        : integer := 3;
+  constant R_ID_CAPS2       : integer := 4;
+  -- capability bits
+  --  0     X bytes and registers 16..63
+  --  1     FIFO register
+  --  2     SPI app port
+  --  3     performance counters
+  constant CAPS             : slv8 := x"AF";
+  -- and in the second byte
+  --  0     attention register and output
+  --  1     stream loop register, packed read
+  constant CAPS2            : slv8 := x"A3";
 
   -- Scratch register, write here, read via R_ID, subaddr 1
   constant W_SCRATCH_REG    : TXA := 1;
@@ -86,6 +132,98 @@ package defs is
   constant  LED_SYNC        : TMisc := 1;
   constant  LED_OFF         : TMisc := 2;
 
+  -- Stream register, 8-bit data packed into 6-bit symbols
+  --   3 bytes -> 4 symbols, msb first:
+  --     aaaaaa aabbbb bbbbcc cccccc
+  --   an address byte restarts the packing
+  -- write here, read the sink status via the same address
+  --  0     bytes received, bits 7..0
+  --  1     bytes received, bits 15..8
+  --  2     sum of the bytes received, mod 256
+  constant W_STREAM_REG     : TXA := 3;
+  constant R_STREAM         : TXA := 3;
+  constant R_STREAM_CNT_LO  : integer := 0;
+  constant R_STREAM_CNT_HI  : integer := 1;
+  constant R_STREAM_SUM     : integer := 2;
+
+  -- Stream loop, read only. The first LOOP_BYTES bytes the stream sink
+  -- took in since register 3 was last selected, sent back packed as
+  -- above, each symbol tagged 01, from sub-address 0. 128 symbols carry
+  -- all of them and the sub-address wraps there, so a longer read goes
+  -- round again. Bytes not written since read as before.
+  constant R_STREAM_LOOP    : TXA := 7;
+  constant LOOP_BYTES       : integer := 96;
+
+  -- FIFO register, FPGA to host bytes in block RAM
+  -- a read returns a two byte header, then the data
+  --  0     fill level when the address byte came, bits 7..0
+  --  1     bit 7 overflow, bits 2..0 fill level bits 10..8
+  --  2..   that many bytes, oldest first, then zeros
+  --   bytes arriving during the read are left for the next one
+  -- write here to control the test source
+  --  bit 0     run
+  --  bits 4..1 a byte every 2**n clocks
+  --  bit 5     clear the FIFO and the overflow flag
+  constant R_FIFO           : TXA := 4;
+  constant W_FIFO_CTL       : TXA := 4;
+  constant FIFO_ABITS       : integer := 10;        -- 1024 bytes, one EBR
+  constant FIFO_HDR_BYTES   : integer := 2;
+  constant FIFO_CTL_RUN     : integer := 0;
+  constant FIFO_CTL_CLEAR   : integer := 5;
+  subtype  TfifoRateRange is integer range 4 downto 1;
+
+  -- Wide register, 16 bytes of 8-bit scratch RAM at the sub-address.
+  -- Above 15, so only X bytes and SPI commands reach it.
+  constant W_WIDE_REG       : TXA := 16;
+  constant R_WIDE           : TXA := 16;
+  constant WIDE_BYTES       : integer := 16;
+
+  -- Performance counters, PERF_NUM of them, 24 bits each, counting
+  -- pifwb events since power up or the last clear. Selecting the
+  -- register snapshots them all, a read returns the snapshot
+  --  3n+0  counter n, bits 7..0
+  --  3n+1  counter n, bits 15..8
+  --  3n+2  counter n, bits 23..16
+  -- write here, bit 0 set clears the counters
+  constant R_PERF           : TXA := 5;
+  constant W_PERF_CTL       : TXA := 5;
+  constant PERF_BITS        : integer := 24;
+  constant PERF_CTL_CLEAR   : integer := 0;
+
+  -- Attention register. Events latch flags here and the ATTN output,
+  -- a spare Pi GPIO, is high while an enabled flag is set. Selecting
+  -- the register snapshots the flags; reading sub-address 0 clears the
+  -- ones in the snapshot, so one read collects the lot, an event after
+  -- the select raises ATTN again and a write never loses a flag.
+  --  0     flags at the select, cleared once read
+  --  1     enable mask
+  --  2     FIFO fill level at the select, bits 7..0
+  --  3     bit 7 FIFO overflow, bits 2..0 fill level bits 10..8
+  --  4     stream bytes received, bits 7..0
+  --  5     stream bytes received, bits 15..8
+  -- write here
+  --  0     flags to set, as if the events had happened
+  --  1     enable mask
+  -- flags, 3..5 have no source in this design
+  --  0     a byte went into the FIFO
+  --  1     the FIFO overflowed
+  --  2     a stream byte arrived
+  constant R_ATTN           : TXA := 6;
+  constant W_ATTN_CTL       : TXA := 6;
+  constant ATTN_BITS        : integer := I2C_DATA_BITS;
+  constant ATTN_FIFO        : integer := 0;
+  constant ATTN_FIFO_OVF    : integer := 1;
+  constant ATTN_STREAM      : integer := 2;
+  constant R_ATTN_FLAGS     : integer := 0;
+  constant R_ATTN_MASK      : integer := 1;
+  constant R_ATTN_FIFO_LO   : integer := 2;
+  constant R_ATTN_FIFO_HI   : integer := 3;
+  constant R_ATTN_CNT_LO    : integer := 4;
+  constant R_ATTN_CNT_HI    : integer := 5;
+  constant W_ATTN_SET       : integer := 0;
+  constant W_ATTN_MASK      : integer := 1;
+  subtype  Tattn is std_logic_vector(ATTN_BITS-1 downto 0);
+
   -------------------------------------------------------------
   -- intercept calls to conv_integer and to_integer
   function ToInteger(arg: std_logic_vector) return integer;
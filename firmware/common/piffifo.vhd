@@ -0,0 +1,88 @@
+-----------------------------------------------------------------------
+-- piffifo.vhd    Bugblat pif byte FIFO in block RAM
+--
+-- Initial entry: 18-Oct-26 te
+-- Copyright (c) 2001 to 2013  te
+--
+-----------------------------------------------------------------------
+-- first word fall through: dout is the oldest byte whenever level is
+-- non-zero. A rd strobe drops it and the next one shows a clock after
+-- the pointer moves. The RAM read is registered so that the array maps
+-- onto an EBR. Writes when full are dropped and set ovf until clr.
+-----------------------------------------------------------------------
+library ieee;           use ieee.std_logic_1164.all;
+                        use ieee.numeric_std.all;
+library work;           use work.defs.all;
+
+entity piffifo is
+  generic ( ABITS : integer := FIFO_ABITS );
+  port (
+    xclk          : in    std_logic;
+    clr           : in    boolean;
+    wr            : in    boolean;
+    din           : in    slv8;
+    rd            : in    boolean;
+    dout          : out   slv8;
+    level         : out   unsigned(ABITS downto 0);
+    ovf           : out   boolean         );
+end piffifo;
+
+architecture rtl of piffifo is
+
+  type TfifoRam is array (0 to 2**ABITS -1) of slv8;
+
+  signal  ram           : TfifoRam;
+  signal  wrPtr
+        , rdPtr         : unsigned(ABITS-1 downto 0) := (others=>'0');
+  signal  count         : unsigned(ABITS   downto 0) := (others=>'0');
+  signal  full
+        , empty
+        , ovfLoc        : boolean := false;
+
+begin
+  full  <= (count(ABITS) = '1');
+  empty <= (count = 0);
+
+  process (xclk)
+    variable vWr, vRd : boolean;
+  begin
+    if rising_edge(xclk) then
+      vWr := wr and not full;
+      vRd := rd and not empty;
+
+      if vWr then
+        ram(ToInteger(wrPtr)) <= din;
+      end if;
+      dout <= ram(ToInteger(rdPtr));
+
+      if clr then
+        wrPtr  <= (others=>'0');
+        rdPtr  <= (others=>'0');
+        count  <= (others=>'0');
+        ovfLoc <= false;
+      else
+        if vWr then
+          wrPtr <= wrPtr +1;
+        end if;
+        if vRd then
+          rdPtr <= rdPtr +1;
+        end if;
+        if vWr and not vRd then
+          count <= count +1;
+        elsif vRd and not vWr then
+          count <= count -1;
+        end if;
+        if wr and full then
+          ovfLoc <= true;
+        end if;
+      end if;
+    end if;
+  end process;
+
+  level <= count;
+  ovf   <= ovfLoc;
+
+end rtl;
+
+-----------------------------------------------------------------------
+-- EOF piffifo.vhd
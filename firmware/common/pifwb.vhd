@@ -8,17 +8,61 @@
 -- read sequence via i2c
 --  i2c transaction : addr, rd_data, rd_data, rd_data, ...
 --
+-- combined read, one transaction with a repeated start
+--  S, slave+W, addr, Sr, slave+R, rd_data, rd_data, ..., P
+--  the bus stays busy across the Sr, so the address byte is followed
+--  straight into the read; the EFB stretches the clock until the first
+--  TXDR write
+--
+-- TXDR is a holding register in front of the shift register, so the
+-- next byte is written while the current one is on the wire. A byte
+-- only counts as read (PRdFinished, which moves the sub-address and
+-- pops the FIFO) once TRRDY shows it went into the shift register,
+-- that is once the master acknowledged the byte before it. The byte
+-- held when the master NACKs is never sent and never counted.
+--
 -----------------------------------------------------------------------
 -- write sequence via i2c
 --  i2c transaction is : addr, wr_data, wr_data, wr_data, ...
 --
+-- I2C is interrupt driven: i2c1_irqo raised by TRRDY or TROE moves the
+-- state machine from idle straight to a status read, the interrupt
+-- clear, then the RXDR read or TXDR write that releases the clock
+-- stretch. Clearing first means a TRRDY that comes back after the data
+-- access latches again. While a transaction is in progress the status
+-- is also re-read from idle, and a TRRDY or TROE seen there is acted on
+-- the same way, so an edge that was missed cannot hang the bus.
+--
+-----------------------------------------------------------------------
 -- wr_data is
---   bits 7..6 : 00 - load address register - 64 registers, 16 used
+--   bits 7..6 : 00 - load address register - registers 0..15
 --               01 - load data register
+--                    (a 6-bit symbol when the register is W_STREAM_REG)
 --               10 - reserved (was tx count)
---               11 - reserved
+--               11 - load address register - registers 0..63, the
+--                    rest of the transaction is untagged 8-bit data
 --   bits 5..0 : data value
 --
+-- X bytes are advertised in the R_ID capabilities byte. The untagged
+-- data runs to the next start or stop, a repeated start included, and
+-- the byte after a start is tagged again. W_STREAM_REG takes X data
+-- bytes as they are, without unpacking.
+--
+-----------------------------------------------------------------------
+-- sequences via spi, CE1 low for the whole transaction
+--  write : cmd (10aaaaaa), wr_data, wr_data, ...
+--  read  : cmd (00aaaaaa), turnaround, rd_data, rd_data, ...
+--
+-- the data bytes are full 8-bit; the 6-bit registers take the low
+-- bits and W_STREAM_REG takes the byte as is, without unpacking.
+-- The EFB holds one byte each way, so the next read byte is loaded
+-- while the current one shifts out. As on I2C a read byte only counts
+-- once TRDY shows it went to the shift register; the one still held
+-- when CE1 rises is dropped uncounted and shifts out under the next
+-- command byte. The zero loaded during the command byte is what the
+-- turnaround byte carries. An I2C transaction in progress holds off
+-- the SPI side until it ends.
+--
 -----------------------------------------------------------------------
 library ieee;           use ieee.std_logic_1164.all;
                         use ieee.numeric_std.all;
@@ -29,6 +73,10 @@ entity pifwb is
   port (
     i2c_SCL       : inout std_logic;
     i2c_SDA       : inout std_logic;
+    spi_SCK       : inout std_logic;
+    spi_MOSI      : inout std_logic;
+    spi_MISO      : inout std_logic;
+    spi_CSn       : in    std_logic;
     xclk          : in    std_logic;
     XI            : out   XIrec;
     XO            : in    slv8            );
@@ -49,7 +97,12 @@ architecture rtl of pifwb is
         wb_ack_o    : out   std_logic;
         i2c1_scl    : inout std_logic;
         i2c1_sda    : inout std_logic;
-        i2c1_irqo   : out   std_logic       );
+        i2c1_irqo   : out   std_logic;
+        spi_clk     : inout std_logic;
+        spi_miso    : inout std_logic;
+        spi_mosi    : inout std_logic;
+        spi_scsn    : in    std_logic;
+        spi_irq     : out   std_logic       );
   end component efbx;
   ---------------------------------------------------------------------
   signal  wbCyc
@@ -90,14 +143,17 @@ begin
 
     type TWBstate is ( WBstart,
                        WBinit1, WBinit2, WBinit3, WBinit4,
+                       WBinit5, WBinit6, WBinit7, WBinit8,
                        WBidle,
                        WBwaitTR,
-                       WBin0, WBout0, WBout1,
+                       WBtr, WBin0, WBout0,
+                       WBspi, WBspiIn, WBspiOut,
                        WBwr, WBrd               );
 
     signal WBstate, rwReturn : TWBstate;
 
-    signal busy, txReady, rxReady, lastTxNak, wbAck, isAddr, isData : boolean;
+    signal busy, txReady, rxReady, lastTxNak, wbAck : boolean;
+    signal isAddr, isData, isX : boolean;
 
     -- wishbone/EFB addresses
     constant  I2C1_CR     : slv8 := x"40";
@@ -110,6 +166,7 @@ begin
     constant  I2C1_RXDR   : slv8 := x"47";
     constant  I2C1_IRQ    : slv8 := x"48";
     constant  I2C1_IRQEN  : slv8 := x"49";
+    constant  I2C_IRQS    : slv8 := x"06";  -- TRRDY and TROE, IRQ and IRQEN
 
     constant  I2C2_CR     : slv8 := x"4A";
     constant  I2C2_CMDR   : slv8 := x"4B";
@@ -122,6 +179,17 @@ begin
     constant  I2C2_IRQ    : slv8 := x"52";
     constant  I2C2_IRQEN  : slv8 := x"53";
 
+    constant  SPICR0      : slv8 := x"54";
+    constant  SPICR1      : slv8 := x"55";
+    constant  SPICR2      : slv8 := x"56";
+    constant  SPIBR       : slv8 := x"57";
+    constant  SPICSR      : slv8 := x"58";
+    constant  SPITXDR     : slv8 := x"59";
+    constant  SPISR       : slv8 := x"5A";
+    constant  SPIRXDR     : slv8 := x"5B";
+    constant  SPIIRQ      : slv8 := x"5C";
+    constant  SPIIRQEN    : slv8 := x"5D";
+
     constant  CFG_CR      : slv8 := x"70";
     constant  CFG_TXDR    : slv8 := x"71";
     constant  CFG_SR      : slv8 := x"72";
@@ -132,12 +200,32 @@ begin
     signal  hitI2CSR
           , hitI2CRXDR
           , hitCFGRXDR
+          , hitSPISR
+          , hitSPIRXDR
           , cfgBusy       : boolean;
+
+    -- SPI slave side
+    signal  spiTrdy
+          , spiRrdy
+          , spiCmd                      -- next byte in is a command
+          , spiReading
+          , xWr                         -- I2C write after an X byte
+          , txHeld                      -- TXDR loaded, not yet shifting
+          , spiHeld                     -- SPITXDR the same, read data only
+          , byteWr        : boolean := false; -- PD is a whole byte
+    signal  spiIn
+          , inByte        : slv8;
+    signal  spiCsnQ       : std_logic_vector(2 downto 0) := (others=>'1');
+    signal  sclQ
+          , sdaQ          : std_logic_vector(2 downto 0) := (others=>'1');
     signal  RdSubAddr
           , WrSubAddr     : TXSubA;       -- sub-addresses
     signal  rwAddr        : TXA;
     signal  inData        : TwrData;
     signal  wbRst         : std_logic;
+    signal  i2cIrq        : std_logic;
+    signal  i2cIrqQ       : boolean := false;
+    signal  i2cSvc        : boolean := false;   -- from interrupt to idle
 
   begin
     -- used in debug mode to reset the internal 16-bit counters
@@ -157,7 +245,12 @@ begin
                            wb_ack_o  => wbAck_o,
                            i2c1_scl  => i2c_SCL,
                            i2c1_sda  => i2c_SDA,
-                           i2c1_irqo => open         );
+                           i2c1_irqo => i2cIrq,
+                           spi_clk   => spi_SCK,
+                           spi_miso  => spi_MISO,
+                           spi_mosi  => spi_MOSI,
+                           spi_scsn  => spi_CSn,
+                           spi_irq   => open         );
 
     wbAck <= (wbAck_o = '1');
 
@@ -168,7 +261,10 @@ begin
               , vBusy
               , vTIP
               , vRARC
-              , vTROE     : boolean;
+              , vTROE
+              , vTxSent
+              , vSpiSent
+              , vNewAddr  : boolean;
       variable  vInst     : slv8;
 
       -----------------------------------------------------
@@ -203,6 +299,9 @@ begin
         hitI2CSR   <= (wbAddr = I2C1_SR  );
         hitI2CRXDR <= (wbAddr = I2C1_RXDR);
         hitCFGRXDR <= (wbAddr = CFG_RXDR);
+        hitSPISR   <= (wbAddr = SPISR    );
+        hitSPIRXDR <= (wbAddr = SPIRXDR  );
+        i2cIrqQ    <= (i2cIrq = '1');
 
         if rst then
           nextState     := WBstart;
@@ -214,6 +313,9 @@ begin
           txReady       <= false;
           rxReady       <= false;
           lastTxNak     <= false;
+          xWr           <= false;
+          txHeld        <= false;
+          spiHeld       <= false;
           rwAddr        <= 0;
           RdSubAddr     <= 0;
           WrSubAddr     <= 0;
@@ -222,6 +324,8 @@ begin
             -----------------------------------
             -- initialise
             when WBstart =>
+              txHeld  <= false;
+              spiHeld <= false;               -- WBinit6 overwrites it
               Wr(I2C1_CMDR, x"04", WBinit1);  -- clock stretch disable
 
             when WBinit1 =>
@@ -238,44 +342,97 @@ begin
               Rd(I2C1_RXDR, WBinit4);         -- read and discard RXDR, #2
 
             when WBinit4 =>
-              Wr(I2C1_CMDR, x"00", WBidle);   -- clock stretch enable
+              Wr(I2C1_CMDR, x"00", WBinit5);  -- clock stretch enable
+
+            when WBinit5 =>
+              Wr(SPICR1, x"80", WBinit6);     -- SPI slave enable
+
+            when WBinit6 =>
+              Wr(SPITXDR, x"00", WBinit7);    -- something to shift out
+
+            when WBinit7 =>
+              Wr(I2C1_IRQEN, I2C_IRQS, WBinit8);
+
+            when WBinit8 =>
+              Wr(I2C1_IRQ, I2C_IRQS, WBidle); -- drop anything latched
 
             -----------------------------------
-            -- wait for I2C activity - "busy" is signalled
+            -- an I2C interrupt goes straight to the status read. While
+            -- a transaction is in progress the status is read again to
+            -- see it end or to catch a byte, otherwise the SPI slave is
+            -- looked at.
             when WBidle =>
-              if busy then                    -- I2C bus active?
+              if i2cIrqQ then
                 Rd(I2C1_SR, WBwaitTR);
-              else
+              elsif busy and (txReady or rxReady or lastTxNak) then
+                nextState := WBwaitTR;
+              elsif busy then
                 Rd(I2C1_SR, WBidle);
+              else
+                Rd(SPISR, WBspi);
+              end if;
+
+            -----------------------------------
+            -- SPI: a byte in takes priority, so that a command has
+            -- selected the register before the TXDR is reloaded. A held
+            -- byte that went to the shift register is counted first.
+            when WBspi =>
+              if spiRrdy then
+                Rd(SPIRXDR, WBspiIn);
+              elsif spiTrdy and spiHeld then
+                spiHeld <= false;
+                Rd(SPISR, WBspi);             -- gives XO time to follow
+              elsif spiTrdy and spiReading then
+                spiHeld <= true;
+                Wr(SPITXDR, XO, WBspiOut);
+              elsif spiTrdy then
+                Wr(SPITXDR, x"00", WBspiOut);
+              else
+                Rd(I2C1_SR, WBidle);          -- catches an I2C start
               end if;
 
+            when WBspiIn =>
+              Rd(SPISR, WBspi);               -- gives XO time to follow
+
+            when WBspiOut =>
+              nextState := WBidle;
+
             -----------------------------------
-            -- wait for TRRDY
+            -- the status has been read once. The interrupt is cleared
+            -- before RXDR or TXDR is touched, a TRRDY from then on is a
+            -- new one.
             when WBwaitTR =>
               if lastTxNak then               -- last read?
                 nextState := WBstart;
-              elsif txReady then
-                Wr(I2C1_TXDR, XO, WBout0);
-              elsif rxReady then
-                Rd(I2C1_RXDR, WBin0);
               elsif not busy then
                 nextState := WBstart;
               else
-                ReadRegAgain;
+                Wr(I2C1_IRQ, I2C_IRQS, WBtr);
+              end if;
+
+            -- the flags are used up here, idle reads them again
+            when WBtr =>
+              txReady <= false;
+              rxReady <= false;
+              if txReady then
+                nextState := WBout0;
+              elsif rxReady then
+                Rd(I2C1_RXDR, WBin0);
+              else
+                nextState := WBidle;          -- nothing to do after all
               end if;
 
             -----------------------------------
-            -- incoming data
+            -- incoming data, the clock is already released
             when WBin0 =>
               nextState := WBidle;
 
             -----------------------------------
-            -- outgoing data
+            -- outgoing data. A held byte that went to the shift register
+            -- was counted in WBwaitTR, XO has followed by now.
             when WBout0 =>
-              nextState := WBout1;
-
-            when WBout1 =>
-              nextState := WBidle;
+              txHeld <= true;
+              Wr(I2C1_TXDR, XO, WBidle);
 
             -----------------------------------
             -- read cycle
@@ -290,19 +447,32 @@ begin
                   vSlaveTransmitting := (wbDat_o(4) = '1');
                   vTxRxRdy           := (wbDat_o(2) = '1');
                   vTROE              := (wbDat_o(1) = '1');
-      txReady   <= vBusy and (vTxRxRdy and vSlaveTransmitting and not vTIP );
+      txReady   <= vBusy and (vTxRxRdy and vSlaveTransmitting          );
       rxReady   <= vBusy and (vTxRxRdy and not vSlaveTransmitting          );
       lastTxNak <= vBusy and (vRARC    and     vSlaveTransmitting and vTROE);
       busy      <= vBusy;
+                  -- a stop or the turn to a read ends the 8-bit data
+                  if (not vBusy) or vSlaveTransmitting then
+                    xWr <= false;
+                  end if;
                 end if;
                 if hitI2CRXDR then
                   isAddr  <= (wbDat_o(TincomingTypeRange) = A_ADDR);
                   isData  <= (wbDat_o(TincomingTypeRange) = D_ADDR);
+                  isX     <= (wbDat_o(TincomingTypeRange) = X_ADDR);
                   inData  <= wbDat_o(TincomingDataRange);
+                  inByte  <= wbDat_o;
                 end if;
                 if hitCFGRXDR then
                   cfgBusy <= (wbDat_o(7) = '1');
                 end if;
+                if hitSPISR then
+                  spiTrdy <= (wbDat_o(4) = '1');
+                  spiRrdy <= (wbDat_o(3) = '1');
+                end if;
+                if hitSPIRXDR then
+                  spiIn   <= wbDat_o;
+                end if;
 
                 wbOutBuff <= wbDat_o;
                 nextState := rwReturn;
@@ -332,37 +502,136 @@ begin
           end case;
         end if;
 
-        XiLoc.PRdFinished <= (WBstate = WBout0);
+        vTxSent  := (WBstate = WBwaitTR) and txReady and txHeld and not lastTxNak;
+        vSpiSent := (WBstate = WBspi) and spiTrdy and spiHeld and not spiRrdy;
+        XiLoc.PRdFinished <= vTxSent or vSpiSent;
+
+        -- CE1 falling edge starts an SPI transaction. The rising edge
+        -- can come before the last byte has been read out of the EFB;
+        -- the byte held then was never clocked out.
+        spiCsnQ <= spiCsnQ(1 downto 0) & spi_CSn;
+        if spiCsnQ(2 downto 1) = "01" then
+          spiHeld <= false;
+        end if;
+        if spiCsnQ(2 downto 1) = "10" then
+          spiCmd     <= true;
+          spiReading <= false;
+        elsif (WBstate = WBspiIn) and spiCmd then
+          spiCmd     <= false;
+          spiReading <= (spiIn(SPI_CMD_WRITE) = '0');
+        end if;
 
-        if (WBstate = WBin0) and isAddr then
+        -- any start, repeated or not, ends the 8-bit data of an X byte.
+        -- The EFB does not report one, so SDA falling while SCL is high
+        -- is watched on the pins.
+        sclQ <= sclQ(1 downto 0) & to_x01(i2c_SCL);
+        sdaQ <= sdaQ(1 downto 0) & to_x01(i2c_SDA);
+        if (sclQ(2 downto 1) = "11") and (sdaQ(2 downto 1) = "10") then
+          xWr <= false;
+        end if;
+
+        vNewAddr := ((WBstate = WBin0) and (isAddr or isX) and not xWr)
+                 or ((WBstate = WBspiIn) and spiCmd);
+        XiLoc.PSel <= vNewAddr;
+
+        if (WBstate = WBin0) and isAddr and not xWr then
+          rwAddr <= ToInteger(inData(TXATagRange));
+        elsif (WBstate = WBin0) and isX and not xWr then
           rwAddr <= ToInteger(inData(TXARange));
+          xWr    <= true;
+        elsif (WBstate = WBspiIn) and spiCmd then
+          rwAddr <= ToInteger(spiIn(TXARange));
         end if;
 
-        if (WBstate = WBin0) and isAddr then
+        if vNewAddr then
           RdSubAddr <= 0;
         elsif XiLoc.PRdFinished then
           RdSubAddr <= (RdSubAddr +1) mod (XSUBA_MAX+1);
         end if;
 
-        if (WBstate = WBin0) and isAddr then
+        if vNewAddr then
           WrSubAddr <= 0;
         elsif XiLoc.PWr then
           WrSubAddr <= (WrSubAddr +1) mod (XSUBA_MAX+1);
         end if;
 
-        if (WBstate = WBin0) and isData then
-          XiLoc.PD  <= inData;
+        byteWr <= false;
+        if (WBstate = WBin0) and xWr then
+          XiLoc.PD  <= inByte;
           XiLoc.PWr <= true;
+          byteWr    <= true;
+        elsif (WBstate = WBin0) and isData then
+          XiLoc.PD  <= "00" & inData;
+          XiLoc.PWr <= true;
+        elsif (WBstate = WBspiIn) and not (spiCmd or spiReading) then
+          XiLoc.PD  <= spiIn;
+          XiLoc.PWr <= true;
+          byteWr    <= true;
         else
           XiLoc.PWr <= false;
         end if;
 
+        -- performance counter events, see pifctl.vhd
+        if (WBstate = WBidle) and (i2cIrqQ or
+                  (busy and (txReady or rxReady or lastTxNak))) then
+          i2cSvc <= true;
+        elsif (WBstate = WBidle) or (WBstate = WBstart) then
+          i2cSvc <= false;
+        end if;
+        XiLoc.PEv(PERF_RX)      <= to_sl(WBstate = WBin0);
+        XiLoc.PEv(PERF_TX)      <= to_sl(vTxSent);
+        XiLoc.PEv(PERF_ADDR)    <= to_sl((WBstate = WBin0) and (isAddr or isX)
+                                                           and not xWr);
+        XiLoc.PEv(PERF_DATA)    <= to_sl((WBstate = WBin0) and (isData or xWr));
+        XiLoc.PEv(PERF_NAK)     <= to_sl((WBstate = WBwaitTR) and lastTxNak);
+        XiLoc.PEv(PERF_WB)      <= to_sl(((WBstate = WBrd) or (WBstate = WBwr))
+                                         and wbAck and i2cSvc);
+        XiLoc.PEv(PERF_RESTART) <= to_sl(WBstate = WBstart);
+        XiLoc.PEv(PERF_SVC)     <= to_sl(i2cSvc);
+
         WBstate <= nextState;
       end if;
     end process;
 
     XiLoc.PRWA    <= rwAddr;
     XiLoc.PRdSubA <= RdSubAddr;
+    XiLoc.PWrSubA <= WrSubAddr;
+
+    ------------------------------------------------
+    -- 6-bit symbols written to W_STREAM_REG back to bytes. The write
+    -- sub-address counts symbols since the address byte, so an address
+    -- byte restarts the group of 4. Every symbol after the first of a
+    -- group completes a byte: one byte per data write at most, no
+    -- buffering needed. SPI and X writes are whole bytes already.
+    UNPACK_P: process (xclk)
+      variable acc : slv6 := (others=>'0');   -- bits carried to next byte
+    begin
+      if rising_edge(xclk) then
+        XiLoc.PStreamWr <= false;
+        if byteWr then
+          if rwAddr = W_STREAM_REG then
+            XiLoc.PStreamD  <= XiLoc.PD;
+            XiLoc.PStreamWr <= true;
+          end if;
+        elsif XiLoc.PWr and (rwAddr = W_STREAM_REG) then
+          case WrSubAddr mod 4 is
+            when 0 =>
+              acc := XiLoc.PD(5 downto 0);
+            when 1 =>
+              XiLoc.PStreamD  <= acc & XiLoc.PD(5 downto 4);
+              XiLoc.PStreamWr <= true;
+              acc(3 downto 0) := XiLoc.PD(3 downto 0);
+            when 2 =>
+              XiLoc.PStreamD  <= acc(3 downto 0) & XiLoc.PD(5 downto 2);
+              XiLoc.PStreamWr <= true;
+              acc(1 downto 0) := XiLoc.PD(1 downto 0);
+            when others =>
+              XiLoc.PStreamD  <= acc(1 downto 0) & XiLoc.PD(5 downto 0);
+              XiLoc.PStreamWr <= true;
+          end case;
+        end if;
+      end if;
+    end process UNPACK_P;
 
   end block WBSM_B;
 
@@ -0,0 +1,112 @@
+#!/bin/sh
+#----------------------------------------------------------------------
+# bench.sh    pifwb I2C throughput regression, needs GHDL
+#
+# Copyright (c) 2001 to 2013  te
+#
+#----------------------------------------------------------------------
+# Builds pifwb_tb.vhd against the behavioural EFB and runs it at a set
+# of I2C rates. Prints one line per rate and direction, then the highest
+# rate at which pifwb never stretched SCL. A run that crashes or gives
+# no write or read result fails the bench.
+#
+#   ./bench.sh             compare with baseline.txt, exit 1 if clocks
+#                          per byte got >10% worse or there is none
+#   ./bench.sh --update    write baseline.txt from this run, to commit
+#
+# BURST=n in the environment sets the bytes per burst (default 64),
+# RATES="..." the I2C rates in kHz.
+#----------------------------------------------------------------------
+
+set -e
+cd "$(dirname "$0")"
+
+RATES=${RATES:-"100 400 1000 2000 3400"}
+BURST=${BURST:-64}
+GHDL="ghdl"
+GFLAGS="--std=93c --workdir=build -Pbuild"
+
+mkdir -p build
+$GHDL -a $GFLAGS --work=machxo2 machxo2_stub.vhd
+$GHDL -a $GFLAGS ../pifcfg.vhd ../common/pifdefs.vhd efbx_model.vhd \
+                 ../common/piffifo.vhd ../common/pifctl.vhd \
+                 ../common/pifwb.vhd pifwb_tb.vhd
+$GHDL -e $GFLAGS pifwb_tb
+
+OUT=build/results.txt
+: > $OUT
+for khz in $RATES; do
+  LOG=build/run_$khz.log
+  rc=0
+  $GHDL -r $GFLAGS pifwb_tb -gI2C_KHZ=$khz -gBURST=$BURST \
+        --ieee-asserts=disable > $LOG 2>&1 || rc=$?
+  grep -E '^(RESULT|FAIL)' $LOG >> $OUT || true
+  for dir in write read; do
+    if ! grep -q "^RESULT $dir " $LOG; then
+      echo "FAIL no $dir result at ${khz}kHz, ghdl exit $rc, see $LOG" >> $OUT
+    fi
+  done
+done
+
+printf "%-6s %6s %8s %10s %10s %10s %8s\n" \
+       dir kHz bytes "B/s" "stretch" "clk/byte" "wb/byte"
+awk '/^RESULT/ {
+       for (i=3; i<=NF; i++) { split($i, kv, "="); v[kv[1]] = kv[2] }
+       printf "%-6s %6d %8d %10d %8dns %10.1f %8.1f\n", $2, v["khz"],
+              v["bytes"], v["payload_Bps"], v["stretch_ns"],
+              v["clocks_x10"]/10, v["wb_x10"]/10
+     }' $OUT
+
+if grep -q '^FAIL' $OUT; then
+  grep '^FAIL' $OUT
+  exit 1
+fi
+
+# the highest rate where neither direction stretched
+awk '/^RESULT/ {
+       for (i=3; i<=NF; i++) { split($i, kv, "="); v[kv[1]] = kv[2] }
+       if (v["stretch_ns"] > 0) bad[v["khz"]] = 1; seen[v["khz"]] = 1
+     }
+     END { max = 0
+           for (k in seen) if (!(k in bad) && (k+0 > max)) max = k+0
+           if (max) print "max sustainable I2C rate " max "kHz"
+           else     print "pifwb stretches SCL at every rate" }' $OUT
+
+# clocks per byte is the figure that should not creep up
+awk '/^RESULT/ { split($3, k, "="); split($8, c, "=")
+                 print $2, k[2], c[2] }' $OUT > build/current.txt
+
+if [ "$1" = "--update" ]; then
+  cp build/current.txt baseline.txt
+  echo "baseline.txt updated"
+elif [ ! -f baseline.txt ]; then
+  echo "no baseline.txt, run ./bench.sh --update and commit it" >&2
+  exit 1
+else
+  awk 'NR == FNR { base[$1 " " $2] = $3; next }
+       { seen[$1 " " $2] = 1 }
+       !(($1 " " $2) in base) {
+         printf "NO BASELINE %s %skHz\n", $1, $2
+         bad = 1
+         next
+       }
+       {
+         if ($3 * 10 > base[$1 " " $2] * 11) {
+           printf "REGRESSION %s %skHz: %.1f clocks/byte, was %.1f\n",
+                  $1, $2, $3/10, base[$1 " " $2]/10
+           bad = 1
+         }
+       }
+       END {
+         for (k in base)
+           if (!(k in seen)) {
+             split(k, d, " ")
+             printf "MISSING %s %skHz, in baseline.txt but not run\n", d[1], d[2]
+             bad = 1
+           }
+         exit bad
+       }' baseline.txt build/current.txt
+  echo "no regression against baseline.txt"
+fi
+
+# EOF ------------------------------------------------------------------
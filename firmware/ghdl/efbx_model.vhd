@@ -0,0 +1,289 @@
+-----------------------------------------------------------------------
+-- efbx_model.vhd    behavioural EFB for simulation with GHDL
+--
+-- Copyright (c) 2001 to 2013  te
+--
+-----------------------------------------------------------------------
+-- Stands in for efb.vhd, which needs the Lattice MACHXO2 library. Only
+-- what pifwb.vhd uses is modelled:
+--
+--  I2C1  7-bit slave at I2C1_SLAVE_ADDR. Registers CMDR (clock stretch
+--        disable, bit 2), TXDR, SR, RXDR, IRQ and IRQEN. A received byte
+--        sets TRRDY after its 8th bit; after the ACK clock SCL is held
+--        low until RXDR is read. When transmitting, TXDR is a holding
+--        register in front of the shift register and TRRDY says it is
+--        empty. Each byte starts, after the address or the master's
+--        ACK, by moving TXDR to the shift register, which sets TRRDY
+--        again; with nothing held SCL is held low until TXDR is
+--        written. A master NACK sets RARC and TROE, the byte still held
+--        is dropped at the next start. IRQ bits latch the rising edges
+--        of TRRDY (2) and TROE (1), writing 1 clears them, i2c1_irqo is
+--        IRQ and IRQEN.
+--  SPI   registers read as zero, the pins are left alone.
+--
+-- Everything runs on wb_clk_i, SCL and SDA go through a 2 clock
+-- synchroniser, as in the hard block. The Wishbone ack comes one clock
+-- after the strobe.
+-----------------------------------------------------------------------
+library ieee;           use ieee.std_logic_1164.all;
+                        use ieee.numeric_std.all;
+library work;           use work.defs.all;
+
+entity efbx is
+    port (
+        wb_clk_i  : in    std_logic;
+        wb_rst_i  : in    std_logic;
+        wb_cyc_i  : in    std_logic;
+        wb_stb_i  : in    std_logic;
+        wb_we_i   : in    std_logic;
+        wb_adr_i  : in    std_logic_vector(7 downto 0);
+        wb_dat_i  : in    std_logic_vector(7 downto 0);
+        wb_dat_o  : out   std_logic_vector(7 downto 0);
+        wb_ack_o  : out   std_logic;
+        i2c1_scl  : inout std_logic;
+        i2c1_sda  : inout std_logic;
+        i2c1_irqo : out   std_logic;
+        spi_clk   : inout std_logic;
+        spi_miso  : inout std_logic;
+        spi_mosi  : inout std_logic;
+        spi_scsn  : in    std_logic;
+        spi_irq   : out   std_logic       );
+end efbx;
+
+architecture behave of efbx is
+
+  constant  I2C1_SLAVE_ADDR : slv7 := "1000001";   -- as efb.vhd
+
+  constant  I2C1_CMDR   : slv8 := x"41";
+  constant  I2C1_TXDR   : slv8 := x"44";
+  constant  I2C1_SR     : slv8 := x"45";
+  constant  I2C1_RXDR   : slv8 := x"47";
+  constant  I2C1_IRQ    : slv8 := x"48";
+  constant  I2C1_IRQEN  : slv8 := x"49";
+
+  type Tbus is ( Idle, Ignore,                    -- not addressed
+                 Addr, AddrAck,
+                 RxData, RxAck,
+                 TxData, TxAck, TxAckEnd );
+
+  signal  phase     : Tbus := Idle;
+  signal  sclQ
+        , sdaQ      : std_logic_vector(2 downto 0) := (others=>'1');
+  signal  sclLow
+        , sdaLow    : boolean := false;
+
+  signal  busy
+        , srw                                   -- slave transmitting
+        , rarc
+        , troe
+        , trrdy
+        , trrdyQ
+        , troeQ
+        , txFull
+        , txStarted
+        , stretchOff
+        , ack       : boolean := false;
+  signal  shreg
+        , rxdr
+        , txdr
+        , txShift
+        , irq
+        , irqEn     : slv8 := (others=>'0');
+  signal  bitCnt    : integer range 0 to 8 := 0;
+
+begin
+  i2c1_scl  <= '0' when sclLow else 'Z';
+  i2c1_sda  <= '0' when sdaLow else 'Z';
+  i2c1_irqo <= '1' when (irq and irqEn) /= x"00" else '0';
+
+  spi_clk   <= 'Z';
+  spi_miso  <= 'Z';
+  spi_mosi  <= 'Z';
+  spi_irq   <= '0';
+
+  wb_ack_o  <= to_sl(ack);
+
+  process (wb_clk_i)
+    variable  sclRise, sclFall, start, stop : boolean;
+    variable  b : slv8;
+  begin
+    if rising_edge(wb_clk_i) then
+      sclQ <= sclQ(1 downto 0) & to_x01(i2c1_scl);
+      sdaQ <= sdaQ(1 downto 0) & to_x01(i2c1_sda);
+
+      sclRise := sclQ(2 downto 1) = "01";
+      sclFall := sclQ(2 downto 1) = "10";
+      start   := (sclQ(1) = '1') and (sdaQ(2 downto 1) = "10");
+      stop    := (sclQ(1) = '1') and (sdaQ(2 downto 1) = "01");
+
+      -------------------------------------------------
+      -- bus side
+      if start then
+        busy      <= true;
+        phase     <= Addr;
+        bitCnt    <= 0;
+        srw       <= false;
+        rarc      <= false;
+        troe      <= false;
+        trrdy     <= false;
+        txFull    <= false;
+        sdaLow    <= false;
+      elsif stop then
+        busy      <= false;
+        phase     <= Idle;
+        srw       <= false;
+        sdaLow    <= false;
+      elsif sclRise then
+        b := shreg(6 downto 0) & sdaQ(1);
+        case phase is
+          when Addr | RxData =>
+            shreg  <= b;
+            bitCnt <= bitCnt +1;
+            if (bitCnt = 7) and (phase = RxData) then
+              rxdr  <= b;
+              trrdy <= true;
+            end if;
+          when TxAck =>
+            if sdaQ(1) = '1' then               -- NACK, the read is over
+              rarc  <= true;
+              troe  <= true;
+              phase <= Ignore;
+            else
+              txStarted <= false;
+              phase     <= TxAckEnd;
+            end if;
+          when others => null;
+        end case;
+      elsif sclFall then
+        case phase is
+          when Addr =>
+            if bitCnt = 8 then
+              if shreg(7 downto 1) = I2C1_SLAVE_ADDR then
+                sdaLow <= true;
+                phase  <= AddrAck;
+                srw    <= (shreg(0) = '1');
+              else
+                phase  <= Ignore;
+              end if;
+            end if;
+          when AddrAck =>
+            sdaLow <= false;
+            bitCnt <= 0;
+            if srw then
+              trrdy     <= true;              -- TXDR was emptied at the start
+              txStarted <= false;
+              phase     <= TxData;
+            else
+              phase     <= RxData;
+            end if;
+          when RxData =>
+            if bitCnt = 8 then
+              sdaLow <= true;
+              phase  <= RxAck;
+            end if;
+          when RxAck =>
+            sdaLow <= false;
+            bitCnt <= 0;
+            phase  <= RxData;
+          when TxData =>
+            if bitCnt = 7 then
+              sdaLow <= false;                  -- the master's ACK next
+              phase  <= TxAck;
+            else
+              sdaLow  <= (txShift(6) = '0');
+              txShift <= txShift(6 downto 0) & '0';
+              bitCnt  <= bitCnt +1;
+            end if;
+          when TxAckEnd =>
+            bitCnt <= 0;
+            phase  <= TxData;
+          when others => null;
+        end case;
+      end if;
+
+      -- a byte starts by taking TXDR into the shift register, its first
+      -- bit goes out a clock before SCL is let go
+      if (phase = TxData) and txFull and not txStarted then
+        txShift   <= txdr;
+        txFull    <= false;
+        trrdy     <= true;
+        sdaLow    <= (txdr(7) = '0');
+        txStarted <= true;
+      end if;
+
+      -- clock stretching, SCL is held in its low phase
+      sclLow <= (not stretchOff) and (sclQ(1) = '0') and
+                (   ((phase = RxData) and (bitCnt = 0) and trrdy)
+                 or ((phase = TxData) and not txStarted)          );
+
+      -------------------------------------------------
+      -- Wishbone side
+      ack <= false;
+      if (wb_cyc_i = '1') and (wb_stb_i = '1') and not ack then
+        ack <= true;
+        if wb_we_i = '1' then
+          if wb_adr_i = I2C1_CMDR then
+            stretchOff <= (wb_dat_i(2) = '1');
+          elsif wb_adr_i = I2C1_TXDR then
+            txdr    <= wb_dat_i;
+            txFull  <= true;
+            trrdy   <= false;
+          elsif wb_adr_i = I2C1_IRQEN then
+            irqEn   <= wb_dat_i;
+          end if;
+        else
+          wb_dat_o <= (others=>'0');
+          if wb_adr_i = I2C1_SR then
+            wb_dat_o <= to_sl((phase = Addr) or ((phase = RxData) and (bitCnt /= 0))
+                              or ((phase = TxData) and txStarted))   -- TIP
+                      & to_sl(busy) & to_sl(rarc) & to_sl(srw)
+                      & '0' & to_sl(trrdy) & to_sl(troe) & '0';
+          elsif wb_adr_i = I2C1_RXDR then
+            wb_dat_o <= rxdr;
+            if not srw then
+              trrdy <= false;
+            end if;
+          elsif wb_adr_i = I2C1_IRQ then
+            wb_dat_o <= irq;
+          elsif wb_adr_i = I2C1_IRQEN then
+            wb_dat_o <= irqEn;
+          end if;
+        end if;
+      end if;
+
+      -- interrupt flags, set on the rising edges, cleared by writing 1
+      trrdyQ <= trrdy;
+      troeQ  <= troe;
+      for i in irq'range loop
+        if (ack = false) and (wb_cyc_i = '1') and (wb_stb_i = '1')
+            and (wb_we_i = '1') and (wb_adr_i = I2C1_IRQ)
+            and (wb_dat_i(i) = '1') then
+          irq(i) <= '0';
+        end if;
+      end loop;
+      if trrdy and not trrdyQ then
+        irq(2) <= '1';
+      end if;
+      if troe and not troeQ then
+        irq(1) <= '1';
+      end if;
+
+      if wb_rst_i = '1' then
+        phase      <= Idle;
+        busy       <= false;
+        srw        <= false;
+        trrdy      <= false;
+        txFull     <= false;
+        txStarted  <= false;
+        stretchOff <= false;
+        sdaLow     <= false;
+        irq        <= (others=>'0');
+        irqEn      <= (others=>'0');
+      end if;
+    end if;
+  end process;
+
+end behave;
+
+-----------------------------------------------------------------------
+-- EOF efbx_model.vhd
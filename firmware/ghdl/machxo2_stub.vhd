@@ -0,0 +1,16 @@
+-----------------------------------------------------------------------
+-- machxo2_stub.vhd    empty MACHXO2 components package
+--
+-- Copyright (c) 2001 to 2013  te
+--
+-----------------------------------------------------------------------
+-- pifwb.vhd names machxo2.components but uses nothing from it once
+-- efbx_model.vhd replaces efb.vhd. Analysed into library machxo2.
+-----------------------------------------------------------------------
+library ieee;           use ieee.std_logic_1164.all;
+
+package components is
+end package components;
+
+-----------------------------------------------------------------------
+-- EOF machxo2_stub.vhd
@@ -0,0 +1,356 @@
+-----------------------------------------------------------------------
+-- pifwb_tb.vhd    I2C throughput bench for pifwb, for GHDL
+--
+-- Copyright (c) 2001 to 2013  te
+--
+-----------------------------------------------------------------------
+-- pifwb and pifctl on the behavioural EFB (efbx_model.vhd), driven by
+-- an I2C master that waits out clock stretching. Two bursts per run:
+--
+--  write  A(W_STREAM_REG) and BURST D symbols in one transaction, the
+--         stream count and the packed loop read back afterwards as a
+--         check
+--  read   A(R_ID), a repeated start and BURST bytes read
+--
+-- then a check that a FIFO read stopped short of the level leaves the
+-- byte pifwb had loaded ahead in TXDR for the next read, and one that
+-- an attention flag pending while masked survives the mask write.
+--
+-- Each prints one line for bench.sh to pick up
+--   RESULT <dir> khz=.. bytes=.. ns=.. payload_Bps=.. stretch_ns=..
+--          clocks_x10=.. wb_x10=..
+-- bytes are all the bytes on the bus including slave addresses,
+-- stretch_ns is the SCL hold per byte, clocks_x10 and wb_x10 are the
+-- xclk cycles and Wishbone cycles pifwb spends per byte, times ten,
+-- from its PERF_SVC and PERF_WB events. A failed check prints FAIL.
+-----------------------------------------------------------------------
+library ieee;           use ieee.std_logic_1164.all;
+                        use ieee.numeric_std.all;
+                        use std.textio.all;
+library work;           use work.defs.all;
+
+entity pifwb_tb is
+  generic ( I2C_KHZ   : integer := 400;
+            BURST     : integer := 64   );
+end pifwb_tb;
+
+architecture bench of pifwb_tb is
+
+  ---------------------------------------------------------------------
+  component pifwb is port (
+      i2c_SCL       : inout std_logic;
+      i2c_SDA       : inout std_logic;
+      spi_SCK       : inout std_logic;
+      spi_MOSI      : inout std_logic;
+      spi_MISO      : inout std_logic;
+      spi_CSn       : in    std_logic;
+      xclk          : in    std_logic;
+      XI            : out   XIrec;
+      XO            : in    slv8            );
+  end component pifwb;
+  ---------------------------------------------------------------------
+  component pifctl is port (
+      xclk          : in    std_logic;
+      XI            : in    XIrec;
+      XO            : out   slv8;
+      MiscReg       : out   TMisc;
+      Attn          : out   std_logic       );
+  end component pifctl;
+  ---------------------------------------------------------------------
+
+  constant  XCLK_PERIOD : time    := 37594 ps;            -- 26.60MHz, piffla.vhd
+  constant  X1          : time    := 1 ms / I2C_KHZ;      -- SCL period
+  constant  X2          : time    := X1 / 2;
+  constant  SLAVE       : slv7    := "1000001";
+
+  signal  xclk          : std_logic := '0';
+  signal  done          : boolean   := false;
+  signal  scl, sda      : std_logic;
+  signal  sclOut
+        , sdaOut        : std_logic := '1';
+  signal  spiSCK
+        , spiMOSI
+        , spiMISO       : std_logic := 'Z';
+  signal  XI            : XIrec;
+  signal  XO            : slv8;
+  signal  MiscReg       : TMisc;
+  signal  Attn          : std_logic;
+
+  -- pifwb's performance events, counted here
+  signal  nRx, nTx
+        , nWb, nSvc     : integer := 0;
+
+begin
+  UWB: pifwb  port map ( i2c_SCL  => scl,
+                         i2c_SDA  => sda,
+                         spi_SCK  => spiSCK,
+                         spi_MOSI => spiMOSI,
+                         spi_MISO => spiMISO,
+                         spi_CSn  => '1',
+                         xclk     => xclk,
+                         XI       => XI,
+                         XO       => XO         );
+
+  UCTL: pifctl port map ( xclk    => xclk,
+                          XI      => XI,
+                          XO      => XO,
+                          MiscReg => MiscReg,
+                          Attn    => Attn       );
+
+  scl <= 'H';
+  sda <= 'H';
+  scl <= '0' when sclOut = '0' else 'Z';
+  sda <= '0' when sdaOut = '0' else 'Z';
+
+  CLK: process
+  begin
+    xclk <= '0';  wait for XCLK_PERIOD/2;
+    xclk <= '1';  wait for XCLK_PERIOD/2;
+    if done then wait; end if;
+  end process CLK;
+
+  COUNT: process (xclk)
+  begin
+    if rising_edge(xclk) then
+      if XI.PEv(PERF_RX)  = '1' then nRx  <= nRx  +1; end if;
+      if XI.PEv(PERF_TX)  = '1' then nTx  <= nTx  +1; end if;
+      if XI.PEv(PERF_WB)  = '1' then nWb  <= nWb  +1; end if;
+      if XI.PEv(PERF_SVC) = '1' then nSvc <= nSvc +1; end if;
+    end if;
+  end process COUNT;
+
+  -- ==================================================================
+  STIMULUS: process
+    variable  L           : line;
+    variable  stretch     : time := 0 ns;
+    variable  t0          : time;
+    variable  c0Rx, c0Tx
+            , c0Wb, c0Svc : integer;
+    variable  v, id       : slv8;
+    variable  ackn        : std_logic;
+    variable  cnt, expect : integer;
+    variable  prev        : integer;
+
+    -------------------------------------------------
+    -- the slave may hold SCL low after the master lets it go. Called
+    -- straight after the release, so X2 of high time follows it.
+    procedure sclHigh is
+      variable t : time;
+    begin
+      if to_x01(scl) /= '1' then
+        t := now;
+        wait until to_x01(scl) = '1';
+        stretch := stretch + (now - t);
+      end if;
+    end procedure sclHigh;
+
+    procedure i2cStart is
+    begin
+      sdaOut <= '1';  wait for X2;
+      sclOut <= '1';  sclHigh;  wait for X2;
+      sdaOut <= '0';  wait for X2;
+      sclOut <= '0';  wait for X2;
+    end procedure i2cStart;
+
+    procedure i2cStop is
+    begin
+      sdaOut <= '0';  wait for X2;
+      sclOut <= '1';  sclHigh;  wait for X2;
+      sdaOut <= '1';  wait for X2;
+    end procedure i2cStop;
+
+    procedure i2cBit(b : in std_logic; r : out std_logic) is
+    begin
+      sdaOut <= b;    wait for X2;
+      sclOut <= '1';  sclHigh;  wait for X2;
+      r := to_x01(sda);
+      sclOut <= '0';
+    end procedure i2cBit;
+
+    procedure i2cSend(x : in slv8) is
+      variable r : std_logic;
+    begin
+      for i in 7 downto 0 loop
+        i2cBit(x(i), r);
+      end loop;
+      i2cBit('1', ackn);
+    end procedure i2cSend;
+
+    procedure i2cRecv(x : out slv8; last : in boolean) is
+      variable r : std_logic;
+    begin
+      for i in 7 downto 0 loop
+        i2cBit('1', r);
+        x(i) := r;
+      end loop;
+      i2cBit(to_sl(last), r);
+    end procedure i2cRecv;
+
+    -------------------------------------------------
+    procedure mark is
+    begin
+      stretch := 0 ns;
+      t0      := now;
+      c0Rx := nRx;  c0Tx := nTx;  c0Wb := nWb;  c0Svc := nSvc;
+    end procedure mark;
+
+    procedure result(dir : in string; busBytes : in integer) is
+      variable ns, n : integer;
+    begin
+      wait for X1;                              -- let the counters settle
+      ns := (now - t0 - X1) / 1 ns;
+      n  := (nRx - c0Rx) + (nTx - c0Tx);
+      if n = 0 then                             -- no events, pifwb is stuck
+        n := 1;
+      end if;
+      write(L, "RESULT " & dir);
+      write(L, string'(" khz="));          write(L, I2C_KHZ);
+      write(L, string'(" bytes="));        write(L, busBytes);
+      write(L, string'(" ns="));           write(L, ns);
+      write(L, string'(" payload_Bps="));  write(L, (BURST * 1000000) / (ns / 1000 + 1));
+      write(L, string'(" stretch_ns="));   write(L, (stretch / 1 ns) / busBytes);
+      write(L, string'(" clocks_x10="));   write(L, (10 * (nSvc - c0Svc)) / n);
+      write(L, string'(" wb_x10="));       write(L, (10 * (nWb  - c0Wb )) / n);
+      writeline(OUTPUT, L);
+    end procedure result;
+
+    procedure check(ok : in boolean; what : in string) is
+    begin
+      if not ok then
+        write(L, "FAIL " & what);
+        writeline(OUTPUT, L);
+      end if;
+    end procedure check;
+
+  begin
+    wait for 5 us;                              -- reset and EFB set-up
+
+    -- write burst, 6-bit symbols to the stream sink
+    mark;
+    i2cStart;
+    i2cSend(SLAVE & '0');
+    check(ackn = '0', "write address not acknowledged");
+    i2cSend(A_ADDR & n2slv(W_STREAM_REG, I2C_DATA_BITS));
+    for i in 0 to BURST-1 loop
+      i2cSend(D_ADDR & n2slv(i mod 64, I2C_DATA_BITS));
+    end loop;
+    i2cStop;
+    result("write", BURST + 2);
+
+    i2cStart;
+    i2cSend(SLAVE & '0');
+    i2cSend(A_ADDR & n2slv(R_STREAM, I2C_DATA_BITS));
+    i2cStart;
+    i2cSend(SLAVE & '1');
+    i2cRecv(v, false);
+    cnt := ToInteger(v);
+    i2cRecv(v, true);
+    cnt := cnt + 256 * ToInteger(v);
+    i2cStop;
+    expect := 3 * (BURST/4);
+    if (BURST mod 4) > 1 then
+      expect := expect + (BURST mod 4) -1;
+    end if;
+    check(cnt = expect, "stream count" & integer'image(cnt));
+
+    -- the loop packs the bytes again, whole groups give the symbols back
+    expect := BURST - (BURST mod 4);
+    if expect > 4 * (LOOP_BYTES / 3) then
+      expect := 4 * (LOOP_BYTES / 3);
+    end if;
+    if expect > 0 then
+      i2cStart;
+      i2cSend(SLAVE & '0');
+      i2cSend(A_ADDR & n2slv(R_STREAM_LOOP, I2C_DATA_BITS));
+      i2cStart;
+      i2cSend(SLAVE & '1');
+      for i in 0 to expect-1 loop
+        i2cRecv(v, i = expect-1);
+        check(v = D_ADDR & n2slv(i mod 64, I2C_DATA_BITS),
+              "loop symbol" & integer'image(i));
+      end loop;
+      i2cStop;
+    end if;
+
+    -- read burst, ID register through a repeated start
+    wait for 10 * X1;
+    mark;
+    i2cStart;
+    i2cSend(SLAVE & '0');
+    i2cSend(A_ADDR & n2slv(R_ID, I2C_DATA_BITS));
+    i2cStart;
+    i2cSend(SLAVE & '1');
+    for i in 0 to BURST-1 loop
+      i2cRecv(v, i = BURST-1);
+      if i = 0 then
+        id := v;
+      end if;
+    end loop;
+    i2cStop;
+    result("read", BURST + 3);
+    check(id = ID, "ID byte");
+
+    -- fill the FIFO from the counting source, then two short reads
+    i2cStart;
+    i2cSend(SLAVE & '0');
+    i2cSend(A_ADDR & n2slv(W_FIFO_CTL, I2C_DATA_BITS));
+    i2cSend(D_ADDR & "100000");                 -- clear
+    i2cSend(D_ADDR & "000001");                 -- run, a byte a clock
+    i2cSend(D_ADDR & "000000");                 -- stop
+    i2cStop;
+
+    prev := 0;
+    for pass in 0 to 1 loop
+      i2cStart;
+      i2cSend(SLAVE & '0');
+      i2cSend(A_ADDR & n2slv(R_FIFO, I2C_DATA_BITS));
+      i2cStart;
+      i2cSend(SLAVE & '1');
+      i2cRecv(v, false);
+      cnt := ToInteger(v);
+      i2cRecv(v, false);
+      cnt := cnt + 256 * ToInteger(v(2 downto 0));
+      check(cnt > 4, "FIFO level" & integer'image(cnt));
+      for i in 0 to 3 loop
+        i2cRecv(v, i = 3);
+        check(ToInteger(v) = prev + 1, "FIFO byte" & integer'image(ToInteger(v))
+                                     & " after" & integer'image(prev));
+        prev := ToInteger(v);
+      end loop;
+      i2cStop;
+      wait for 10 * X1;
+    end loop;
+
+    -- attention event while masked, then the mask write selects R_ATTN
+    i2cStart;
+    i2cSend(SLAVE & '0');
+    i2cSend(A_ADDR & n2slv(W_ATTN_CTL, I2C_DATA_BITS));
+    i2cSend(D_ADDR & n2slv(2**ATTN_STREAM, I2C_DATA_BITS));
+    i2cStop;
+    i2cStart;
+    i2cSend(SLAVE & '0');
+    i2cSend(A_ADDR & n2slv(W_ATTN_CTL, I2C_DATA_BITS));
+    i2cSend(D_ADDR & "000000");
+    i2cSend(D_ADDR & n2slv(2**ATTN_STREAM, I2C_DATA_BITS));
+    i2cStop;
+    wait for X1;
+    check(Attn = '1', "attention lost by the mask write");
+    i2cStart;
+    i2cSend(SLAVE & '0');
+    i2cSend(A_ADDR & n2slv(R_ATTN, I2C_DATA_BITS));
+    i2cStart;
+    i2cSend(SLAVE & '1');
+    i2cRecv(v, true);
+    i2cStop;
+    wait for X1;
+    check(v(ATTN_STREAM) = '1', "attention flag not read");
+    check(Attn = '0', "attention not cleared by the read");
+
+    done <= true;
+    wait;
+  end process STIMULUS;
+
+end bench;
+
+-----------------------------------------------------------------------
+-- EOF pifwb_tb.vhd
@@ -42,6 +42,11 @@ UFM_PAGE_COUNT_4000     = 768
 CFG_PAGE_COUNT_7000     = 9212
 UFM_PAGE_COUNT_7000     = 2048
 
+## erase masks, match pif.h
+FEATURE_ERASE           = (1<<1)
+CFG_ERASE               = (1<<2)
+UFM_ERASE               = (1<<3)
+
 UNRECOGNIZED = 'unrecognized'
 
 ##---------------------------------------------------------
@@ -55,6 +60,59 @@ R_ID                = 0
 W_SCRATCH_REG       = 1
 W_MISC_REG          = 2
 
+# 8-bit stream, 3 bytes packed into 4 data symbols (see appcodec.h),
+# read back the sink's byte count and sum
+W_STREAM_REG        = 3
+R_STREAM            = 3
+
+# the first LOOP_BYTES bytes of the latest stream write, read back
+# packed the same way, 4 symbols per 3 bytes
+R_STREAM_LOOP       = 7
+LOOP_BYTES          = 96
+
+# FPGA to host FIFO, a read gives 2 level bytes then the data. The
+# control bits run the counting test source and clear the FIFO
+R_FIFO              = 4
+W_FIFO_CTL          = 4
+FIFO_CTL_RUN        = 0x01
+FIFO_CTL_CLEAR      = 0x20
+
+# 16 bytes of 8-bit scratch, only reachable by X bytes (11aaaaaa)
+W_WIDE_REG          = 16
+R_WIDE              = 16
+
+# I2C performance counters, 3 bytes each LSB first, snapshotted when
+# the register is selected. Write PERF_CLEAR to zero them
+R_PERF              = 5
+W_PERF_CTL          = 5
+PERF_CLEAR          = 0x01
+PERF_NAMES          = ('rx', 'tx', 'addr', 'data', 'nak', 'wb', 'restart', 'svc')
+
+# attention flags, the ATTN output on GPIO25 is high while an enabled
+# one is set. Selecting R_ATTN snapshots them and reading the flags
+# byte clears the snapshot, a write clears nothing; the read gives
+# flags, mask, FIFO level (2 bytes, bit 7 of the second is overflow)
+# and stream count (2 bytes). Write the flags to set at sub-address 0,
+# the enable mask at 1
+R_ATTN              = 6
+W_ATTN_CTL          = 6
+ATTN_GPIO           = 25
+ATTN_FIFO           = 0x01
+ATTN_FIFO_OVF       = 0x02
+ATTN_STREAM         = 0x04
+
+# R_ID sub-address 3, capabilities when bits 7..4 are CAPS_MARK
+R_ID_CAPS           = 3
+CAPS_MARK           = 0xA0
+CAP_XADDR           = 0x01
+CAP_FIFO            = 0x02
+CAP_SPI             = 0x04
+CAP_PERF            = 0x08
+# and sub-address 4, shifted up by 4 as the library reports it
+R_ID_CAPS2          = 4
+CAP_ATTN            = 0x10
+CAP_LOOP            = 0x20
+
 # misc register LED control values
 LED_ALTERNATING     = 0
 LED_SYNC            = 1
@@ -68,9 +126,11 @@ LED_OFF             = 2
 #   bit number      76543210
 #   address format  00aaaaaa    aaaaaa is the register address
 #   data format     01dddddd    dddddd is the data for the register
+#   extended        11aaaaaa    any of 64 registers, 8-bit data follows
 
 ADDRESS_MASK        = 0
 DATA_MASK           = 0x40
+XADDRESS_MASK       = 0xC0
 
 ##---------------------------------------------------------
 STR_LEDS_ALT        = 'alternating'
@@ -19,6 +19,7 @@ from pifglobs import *
 
 traceFile = None
 DEVICE_NAME_TAG = 'NOTE DEVICE NAME:'
+UFM_DATA_TAG = 'NOTE TAG DATA'
 PACKAGE_TAG = 'TQFP144'
 
 ##---------------------------------------------------------
@@ -142,12 +143,24 @@ def processLine(line):
     traceFile.write('\n')
   return v
 
+##---------------------------------------------------------
+## the UFM block follows 'NOTE TAG DATA', an L line gives the fuse
+## address of the rows after it, relative to the first one
+def isBlank(page):
+  for x in page:
+    if x != 0:
+      return False
+  return True
+
 ##---------------------------------------------------------
 def readJedecFile(fname, dev):
   global traceFile
   print('JEDEC file is ' + fname)
 
   data = []
+  ufm = []
+  ufmBase = None
+  ufmPage = 0
   correctDevice = False
   jedecID = None
   f = open(fname, 'r')
@@ -184,6 +197,26 @@ def readJedecFile(fname, dev):
         data.append(v)
       else:
         print('\nlast configuration data line: %d' % (lnum-1))
+        state = 'afterData'
+    elif state == 'afterData':
+      if UFM_DATA_TAG in line:
+        state = 'ufmTag'
+    elif state in ('ufmTag', 'inUfm'):
+      if c0 == 'L':
+        a = int(line[1:].strip().rstrip('*'))
+        if ufmBase is None:
+          ufmBase = a
+        ufmPage = (a - ufmBase) // (UFM_PAGE_SIZE * 8)
+        state = 'inUfm'
+      elif valid:
+        while len(ufm) <= ufmPage:
+          ufm.append([0] * UFM_PAGE_SIZE)
+        ufm[ufmPage] = processLine(line)
+        ufmPage += 1
+        state = 'inUfm'
+      elif c0 == '*':
+        state = 'ufmTag'
+      elif ufmBase is not None:
         state = 'finished'
         break
 
@@ -196,15 +229,17 @@ def readJedecFile(fname, dev):
     print('\n  FPGA is ' + dev)
     if jedecID:
       print('\n  JEDEC identifies as "' + jedecID + '"')
-    return []
+    return [], []
 
   print('%d frames' % len(data))
+  if len(ufm) > 0:
+    print('%d UFM pages' % len(ufm))
   print('finished reading JEDEC file')
-  return data
+  return data, ufm
 
 ##---------------------------------------------------------
 def configure(handle, fname, dev):
-  jedecData = readJedecFile(fname, dev)
+  jedecData, ufmData = readJedecFile(fname, dev)
 
   if len(jedecData) == 0:
     return
@@ -219,7 +254,10 @@ def configure(handle, fname, dev):
 
   print('erasing configuration flash ... ') ,
   res = pifglobs.pif.pifInitCfgAddr(handle)
-  res = pifglobs.pif.pifEraseCfg(handle)
+  if len(ufmData) > 0:
+    res = pifglobs.pif.pifErase(handle, CFG_ERASE | UFM_ERASE)
+  else:
+    res = pifglobs.pif.pifEraseCfg(handle)
   showCfgStatus(handle)
   print('erased')
 
@@ -240,7 +278,26 @@ def configure(handle, fname, dev):
     if (pageNum % 25) == 0:
       print('.') ,
 
-  print('programmed \ntransferring ...  ')
+  print('programmed')
+
+  # same offline session, blank pages are left erased
+  if len(ufmData) > 0:
+    print('programming UFM ... '),
+    nextPage = -1
+    for pageNum in range(0, len(ufmData)) :
+      page = ufmData[pageNum]
+      if isBlank(page):
+        continue
+      if pageNum != nextPage:
+        res = pifglobs.pif.pifSetUfmPageAddr(handle, pageNum)
+      for i in range(0, UFM_PAGE_SIZE) :
+        frameData[i] = chr(page[i])
+      res = pifglobs.pif.pifProgUfmPage(handle, frameData)
+      nextPage = pageNum + 1
+    res = pifglobs.pif.pifWaitUntilNotBusy(handle, -1)
+    print('programmed')
+
+  print('transferring ...  ')
 
   res = pifglobs.pif.pifProgDone(handle)
   res = pifglobs.pif.pifRefresh(handle)
@@ -59,33 +59,35 @@ def showDeviceID(handle):
   return s;
 
 ##---------------------------------------------------------
-def sendAddressByte(handle, a):
+# the address and all the values go in one I2C transaction, the
+# library does the tagging and masking
+def writeRegister(handle, reg, values):
   try:
-    cmdLength = 1
-    buff = create_string_buffer(chr(ADDRESS_MASK | a), cmdLength)
-    numWritten = c_ulong(0)
-    res = pifglobs.pif.pifAppWrite(handle, buff, cmdLength, byref(numWritten))
+    n = len(values)
+    buff = (c_ubyte * n)(*values)
+    res = pifglobs.pif.pifRegWrite(handle, reg, buff, n)
   except:
-    print('FAILED: address byte send')
+    print('FAILED: register write')
 
 ##---------------------------------------------------------
-def sendDataByte(handle, v):
-  try:
-    cmdLength = 1
-    buff = create_string_buffer(chr(DATA_MASK | v), cmdLength)
-    numWritten = c_ulong(0)
-    res = pifglobs.pif.pifAppWrite(handle, buff, cmdLength, byref(numWritten))
-  except:
-    print('FAILED: data byte send')
+# n values from the register's read sub-addresses, in one burst
+def readRegister(handle, reg, n):
+  buff = (c_ubyte * n)()
+  res = pifglobs.pif.pifRegRead(handle, reg, buff, n)
+  return list(buff) if res else None
 
 ##---------------------------------------------------------
-# write val into the Misc register inside the FPGA
+# write val into the Misc register inside the FPGA. The library's
+# shadow copy keeps the value, so the page can show it without a
+# bus read of a write-only register.
 def setMiscRegister(val):
-  try:
-    sendAddressByte(pifglobs.handle, W_MISC_REG)
-    sendDataByte(pifglobs.handle, val)
-  except:
-    pass
+  pifglobs.pif.pifShadowSet(pifglobs.handle, W_MISC_REG, val)
+  pifglobs.pif.pifShadowFlush(pifglobs.handle)
+
+def getMiscRegister():
+  v = c_ubyte()
+  res = pifglobs.pif.pifShadowGet(pifglobs.handle, W_MISC_REG, byref(v))
+  return v.value if res else None
 
 ##---------------------------------------------------------
 urls    = ('/', 'index')
@@ -97,6 +99,9 @@ myform  = web.form.Form(
 class index:
   def GET(self):
     form = myform()
+    labels = { LED_ALTERNATING: STR_LEDS_ALT, LED_SYNC: STR_LEDS_SYNC,
+               LED_OFF: STR_LEDS_OFF }
+    pifglobs.state = labels.get(getMiscRegister(), pifglobs.state)
     return render.index(pifglobs.state, form)
 
   def POST(self):
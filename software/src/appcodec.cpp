@@ -0,0 +1,98 @@
+// appcodec.cpp -------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <string.h>
+
+#include "appcodec.h"
+
+#define APP6_TAGS       0x4040404040404040ULL
+
+//---------------------------------------------------------------------
+static inline uint64_t loadBE64(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+  }
+
+static inline void storeBE64(uint8_t *p, uint64_t v) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  memcpy(p, &v, 8);
+  }
+
+//---------------------------------------------------------------------
+// two groups per step, one in each 32-bit lane:
+//   24 data bits at 23..0  ->  6-bit fields at 29..24 21..16 13..8 5..0
+size_t app6Encode(const uint8_t *pBytes, size_t Alen, uint8_t *pSymbols) {
+  uint8_t *pOut = pSymbols;
+  size_t   i    = 0;
+
+  for (; i+6 <= Alen; i+=6) {
+    uint8_t in[8] = { 0 };
+    memcpy(in, pBytes + i, 6);
+    uint64_t g = loadBE64(in) >> 16;                // 48 bits, 2 groups
+    uint64_t y = ((g & 0xffffff000000ULL) << 8) | (g & 0xffffffULL);
+    uint64_t t = ((y & 0x00fc000000fc0000ULL) << 6) |
+                 ((y & 0x0003f0000003f000ULL) << 4) |
+                 ((y & 0x00000fc000000fc0ULL) << 2) |
+                  (y & 0x0000003f0000003fULL);
+    storeBE64(pOut, t | APP6_TAGS);
+    pOut += 8;
+    }
+
+  // at most 5 bytes left, a whole group and/or a partial one
+  for (; i<Alen; i+=3) {
+    uint32_t x = (uint32_t)pBytes[i] << 16;
+    size_t   n = Alen - i;
+    if (n > 1) x |= (uint32_t)pBytes[i+1] << 8;
+    if (n > 2) x |= pBytes[i+2];
+    int syms = (n >= 3) ? 4 : (int)n + 1;
+    for (int s=0; s<syms; s++)
+      *pOut++ = 0x40 | ((x >> (18 - 6*s)) & 0x3f);
+    }
+  return pOut - pSymbols;
+  }
+
+//---------------------------------------------------------------------
+// the reverse, 8 symbols to 6 bytes per step
+size_t app6Decode(const uint8_t *pSymbols, size_t AnumSymbols, uint8_t *pBytes) {
+  uint8_t *pOut = pBytes;
+  size_t   i    = 0;
+
+  for (; i+8 <= AnumSymbols; i+=8) {
+    uint64_t v = loadBE64(pSymbols + i);
+    uint64_t x = ((v & 0x3f0000003f000000ULL) >> 6) |
+                 ((v & 0x003f0000003f0000ULL) >> 4) |
+                 ((v & 0x00003f0000003f00ULL) >> 2) |
+                  (v & 0x0000003f0000003fULL);
+    uint64_t g = ((x >> 8) & 0xffffff000000ULL) | (x & 0xffffffULL);
+    uint8_t out[8];
+    storeBE64(out, g << 16);
+    memcpy(pOut, out, 6);
+    pOut += 6;
+    }
+
+  // a whole group and/or a partial one, 2 symbols make a byte
+  for (; i<AnumSymbols; i+=4) {
+    size_t   n = AnumSymbols - i;
+    if (n > 4)
+      n = 4;
+    uint32_t x = 0;
+    for (size_t s=0; s<n; s++)
+      x |= (uint32_t)(pSymbols[i+s] & 0x3f) << (18 - 6*s);
+    for (size_t b=0; b<app6Bytes(n); b++)
+      *pOut++ = (uint8_t)(x >> (16 - 8*b));
+    }
+  return pOut - pBytes;
+  }
+
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,34 @@
+// appcodec.h ---------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// 8-bit data over the 6-bit app channel: 3 bytes go as 4 tagged data
+// symbols, msb first
+//
+//   bytes     aaaaaaaa bbbbbbbb cccccccc
+//   symbols   01aaaaaa 01aabbbb 01bbbbcc 01cccccc
+//
+// A trailing 1 or 2 bytes take 2 or 3 symbols, the unused low bits of
+// the last symbol are zero. The firmware unpacker is in pifwb.vhd.
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef appcodecH
+#define appcodecH
+
+#include <stddef.h>
+#include <stdint.h>
+
+// symbols needed for Alen bytes, and bytes carried by AnumSymbols
+inline size_t app6Symbols(size_t Alen)       { return (Alen * 8 + 5) / 6; }
+inline size_t app6Bytes(size_t AnumSymbols)  { return AnumSymbols * 6 / 8; }
+
+// both return the number written. Whole groups are done eight bytes at
+// a time in 64-bit registers, the tail a byte at a time. The decoder
+// ignores the tag bits.
+size_t app6Encode(const uint8_t *pBytes, size_t Alen, uint8_t *pSymbols);
+size_t app6Decode(const uint8_t *pSymbols, size_t AnumSymbols, uint8_t *pBytes);
+
+#endif
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,124 @@
+// appshadow.cpp ------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <string.h>
+
+#include "appshadow.h"
+#include "llbufs.h"
+
+#define R_ID                    0         /* see pifdefs.vhd */
+#define R_ID_SCRATCH            1
+#define R_ID_MISC               2
+#define W_SCRATCH_REG           1
+#define W_MISC_REG              2
+#define W_ATTN_CTL              6
+
+// registers whose data bytes go to successive sub-addresses, the last
+// one written is no value of theirs
+#define SUBADDR_REGS            (1 << W_ATTN_CTL)
+
+//---------------------------------------------------------------------
+bool TappShadow::set(int Areg, uint8_t Avalue) {
+  if ((Areg < 0) || (Areg >= APP_NUM_REGS))
+    return false;
+
+  uint16_t bit = 1 << Areg;
+  if (Fdirty & bit)
+    Fcombined++;
+  Fvalue[Areg] = Avalue & APP_DATA_MASK;
+  Fvalid |= bit;
+  Fdirty |= bit;
+  Fsets++;
+  return true;
+  }
+
+//---------------------------------------------------------------------
+bool TappShadow::get(int Areg, uint8_t *pValue) {
+  if ((Areg < 0) || (Areg >= APP_NUM_REGS) || !(Fvalid & (1 << Areg)))
+    return false;
+  *pValue = Fvalue[Areg];
+  return true;
+  }
+
+//---------------------------------------------------------------------
+bool TappShadow::flush() {
+  if (!Fdirty)
+    return true;
+
+  TllFrame<2 * APP_NUM_REGS> oBuf;
+  int n = 0;
+  for (int r=0; r<APP_NUM_REGS; r++)
+    if (Fdirty & (1 << r)) {
+      oBuf.byte(A_ADDR | r).byte(D_ADDR | Fvalue[r]);
+      n++;
+      }
+  if (!Fpif.appWrite(oBuf.data(), oBuf.length()))
+    return false;
+
+  Fdirty = 0;
+  Fflushes++;
+  FflushedRegs += n;
+  return true;
+  }
+
+//---------------------------------------------------------------------
+bool TappShadow::sync() {
+  uint8_t v[3];
+  if (!Fpif.regRead(R_ID, v, sizeof(v)))
+    return false;
+
+  if (!(Fdirty & (1 << W_SCRATCH_REG)))
+    written(W_SCRATCH_REG, v[R_ID_SCRATCH]);
+  if (!(Fdirty & (1 << W_MISC_REG)))
+    written(W_MISC_REG, v[R_ID_MISC] & 0x0f);
+  return true;
+  }
+
+//---------------------------------------------------------------------
+void TappShadow::written(int Areg, uint8_t Avalue) {
+  if ((Areg < 0) || (Areg >= APP_NUM_REGS))
+    return;
+  if (SUBADDR_REGS & (1 << Areg)) {
+    invalidate(Areg);
+    return;
+    }
+  Fvalue[Areg] = Avalue & APP_DATA_MASK;
+  Fvalid |= (1 << Areg);
+  Fdirty &= ~(1 << Areg);
+  }
+
+//---------------------------------------------------------------------
+void TappShadow::invalidate() {
+  Fvalid = 0;
+  Fdirty = 0;
+  }
+
+// a write whose value the copy cannot tell, a pending set is dropped
+void TappShadow::invalidate(int Areg) {
+  if ((Areg < 0) || (Areg >= APP_NUM_REGS))
+    return;
+  Fvalid &= ~(1 << Areg);
+  Fdirty &= ~(1 << Areg);
+  }
+
+int TappShadow::dirtyRegs() {
+  int n = 0;
+  for (int r=0; r<APP_NUM_REGS; r++)
+    if (Fdirty & (1 << r))
+      n++;
+  return n;
+  }
+
+//---------------------------------------------------------------------
+TappShadow::TappShadow(Tpif& Apif)
+      : Fpif(Apif), Fvalid(0), Fdirty(0),
+        Fsets(0), Fcombined(0), Fflushes(0), FflushedRegs(0) {
+  memset(Fvalue, 0, sizeof(Fvalue));
+  }
+
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,59 @@
+// appshadow.h --------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// host copy of the 16 app registers, held by Tpif
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef appshadowH
+#define appshadowH
+
+#include <stdint.h>
+
+#include "pif.h"
+
+#define APP_NUM_REGS            16        /* 2**XA_TAG_BITS in pifdefs.vhd */
+
+//---------------------------------------------------------------------
+// set() only records the value, so repeated sets of a register before
+// a flush() cost nothing on the bus and only the last one is sent.
+// flush() writes every dirty register, lowest first, as address/data
+// pairs in one I2C transaction. get() answers from the copy, which is
+// how the write-only registers are read back. Every Tpif write to the
+// app registers keeps the copy up to date; one it cannot follow, 8-bit
+// data over an X byte or SPI, or data for a register that spreads it
+// over sub-addresses, drops that register from the copy.
+class TappShadow {
+  private:
+    Tpif&     Fpif;
+    uint8_t   Fvalue[APP_NUM_REGS];
+    uint16_t  Fvalid;                   // a bit per register
+    uint16_t  Fdirty;
+
+  public:
+    // statistics
+    uint64_t  Fsets;
+    uint64_t  Fcombined;                // sets that replaced a dirty value
+    uint64_t  Fflushes;                 // bus transactions
+    uint64_t  FflushedRegs;
+
+    bool set(int Areg, uint8_t Avalue);
+    bool get(int Areg, uint8_t *pValue);
+    bool flush();
+
+    // reads R_ID sub-addresses 1 and 2 into the scratch and misc
+    // registers, unless they have unflushed sets
+    bool sync();
+
+    void written(int Areg, uint8_t Avalue);   // a write that went past
+    void invalidate();
+    void invalidate(int Areg);
+    int  dirtyRegs();
+
+    TappShadow(Tpif& Apif);
+  };
+
+#endif
+// EOF ----------------------------------------------------------------
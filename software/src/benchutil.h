@@ -0,0 +1,92 @@
+// benchutil.h --------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// clocks and a minimal JSON writer shared by the benchmark programs
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef benchutilH
+#define benchutilH
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+//---------------------------------------------------------------------
+static inline uint64_t benchClockNs(clockid_t Aclock) {
+  struct timespec ts;
+  clock_gettime(Aclock, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+
+static inline uint64_t benchWallNs() { return benchClockNs(CLOCK_MONOTONIC); }
+static inline uint64_t benchCpuNs()  { return benchClockNs(CLOCK_PROCESS_CPUTIME_ID); }
+
+//---------------------------------------------------------------------
+// writes one JSON document, pretty printed, to a stdio stream
+class TjsonOut {
+  private:
+    FILE *fd;
+    int   Fdepth;
+    bool  Ffirst;
+
+    void _sep(const char *key) {
+      fprintf(fd, "%s\n%*s", Ffirst ? "" : ",", Fdepth*2, "");
+      Ffirst = false;
+      if (key)
+        fprintf(fd, "\"%s\": ", key);
+      }
+    void _open(const char *key, char c) {
+      _sep(key);
+      fputc(c, fd);
+      Fdepth++;
+      Ffirst = true;
+      }
+    void _close(char c) {
+      Fdepth--;
+      fprintf(fd, "\n%*s%c", Fdepth*2, "", c);
+      Ffirst = false;
+      if (Fdepth == 0)
+        fputc('\n', fd);
+      }
+
+  public:
+    TjsonOut& object(const char *key=0) { _open(key, '{'); return *this; }
+    TjsonOut& array(const char *key=0)  { _open(key, '['); return *this; }
+    TjsonOut& endObject()               { _close('}');     return *this; }
+    TjsonOut& endArray()                { _close(']');     return *this; }
+
+    TjsonOut& str(const char *key, const char *v) {
+      _sep(key);
+      fputc('"', fd);
+      for (; *v; v++) {
+        if ((*v == '"') || (*v == '\\'))
+          fputc('\\', fd);
+        fputc(*v, fd);
+        }
+      fputc('"', fd);
+      return *this;
+      }
+    TjsonOut& num(const char *key, double v) {
+      _sep(key);
+      fprintf(fd, "%.6g", v);
+      return *this;
+      }
+    TjsonOut& integer(const char *key, uint64_t v) {
+      _sep(key);
+      fprintf(fd, "%llu", (unsigned long long)v);
+      return *this;
+      }
+    TjsonOut& boolean(const char *key, bool v) {
+      _sep(key);
+      fputs(v ? "true" : "false", fd);
+      return *this;
+      }
+
+    TjsonOut(FILE *Afd) : fd(Afd), Fdepth(0), Ffirst(true) {}
+  };
+
+#endif
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,91 @@
+// i2ctune.cpp --------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <string.h>
+
+#include "i2ctune.h"
+#include "bcm2835.h"
+
+#define R_ID                    0         /* see pifdefs.vhd */
+#define W_SCRATCH_REG           1
+#define MCP_IODIR               0
+
+static const uint32_t probeRates[] = {
+  100 * 1000, 400 * 1000, 600 * 1000, 800 * 1000, LL_I2C_MAX_HZ
+  };
+
+//---------------------------------------------------------------------
+bool i2cLoopback(Tpif& Apif, uint8_t Avalue, uint8_t AidByte, int *pReason) {
+  uint8_t wr    = Avalue & APP_DATA_MASK;
+  uint8_t rd[2] = { 0, 0 };
+
+  // the read is a repeated start transaction, so that gets tested too
+  *pReason = BCM2835_I2C_REASON_OK;
+  bool ok = Apif.regWrite(W_SCRATCH_REG, &wr, 1);
+  ok = ok && Apif.regRead(R_ID, rd, 2);
+  if (!ok) {
+    *pReason = Apif.lastI2cResult();
+    return false;
+    }
+  return (rd[0] == AidByte) && (rd[1] == (D_ADDR | (Avalue & 0x3f)));
+  }
+
+//---------------------------------------------------------------------
+uint32_t i2cProbe(Tpif& Apif, TI2cProbeResult *pResult) {
+  TI2cProbeResult res;
+  memset(&res, 0, sizeof(res));
+
+  // reference values at the slowest rate
+  uint8_t idByte = 0, iodir = 0, v;
+  bool ok = Apif.setI2cRate(probeRates[0]);
+  ok = ok && Apif.regRead(R_ID, &idByte, 1);
+  ok = ok && Apif.mcpRead(MCP_IODIR, &iodir);
+
+  int numRates = sizeof(probeRates) / sizeof(probeRates[0]);
+  for (int r=0; ok && (r<numRates); r++) {
+    TI2cRateResult& rr = res.rates[res.numRates++];
+    rr.hz = probeRates[r];
+    bool clean = Apif.setI2cRate(rr.hz);
+    for (int i=0; clean && (i<I2C_PROBE_PASSES); i++) {
+      int reason;
+      // walking ones and their complements over the 6 data bits
+      uint8_t value = (i & 1) ? ~(1 << (i/2 % 6)) : (1 << (i/2 % 6));
+      if (i2cLoopback(Apif, value, idByte, &reason))
+        rr.passes++;
+      else if (reason == BCM2835_I2C_REASON_OK)
+        rr.mismatches++;
+      rr.reasons |= reason;
+
+      if (!Apif.mcpRead(MCP_IODIR, &v))
+        rr.reasons |= Apif.lastI2cResult();
+      else if (v != iodir)
+        rr.mismatches++;
+      clean = (rr.passes == i+1) && (rr.reasons == BCM2835_I2C_REASON_OK)
+                                 && (rr.mismatches == 0);
+      }
+    if (!clean)
+      break;
+    res.chosenHz = rr.hz;
+    }
+
+  Apif.setI2cRate(res.chosenHz ? res.chosenHz : LL_I2C_DEFAULT_HZ);
+  if (pResult)
+    *pResult = res;
+  return res.chosenHz;
+  }
+
+//---------------------------------------------------------------------
+const char *i2cReasonString(int Areasons) {
+  static const char *names[8] = {
+    "ok", "nack", "clkt", "nack+clkt",
+    "data", "nack+data", "clkt+data", "nack+clkt+data"
+    };
+  return names[Areasons & 7];
+  }
+
+// EOF ----------------------------------------------------------------
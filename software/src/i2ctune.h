@@ -0,0 +1,49 @@
+// i2ctune.h ----------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// finds the fastest I2C rate, up to Fast-mode Plus, that the app
+// channel and the MCP23008 sustain on this board
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef i2ctuneH
+#define i2ctuneH
+
+#include "pif.h"
+
+#define I2C_PROBE_PASSES        16        /* loopbacks per rate */
+#define I2C_PROBE_MAX_RATES     8
+
+//---------------------------------------------------------------------
+struct TI2cRateResult {
+  uint32_t  hz;
+  int       passes;                     // loopbacks that came back right
+  int       mismatches;                 // transferred, wrong data
+  int       reasons;                    // BCM2835_I2C_REASON_xxx bits seen
+  };
+
+struct TI2cProbeResult {
+  uint32_t        chosenHz;             // 0 if nothing worked
+  int             numRates;             // rates tried, slowest first
+  TI2cRateResult  rates[I2C_PROBE_MAX_RATES];
+  };
+
+// one scratch register loopback: Avalue (6 bits) written to
+// W_SCRATCH_REG and read back through R_ID sub-address 1 as
+// "01" & Avalue. The ID byte in front is checked against AidByte.
+// *pReason gets the bcm2835 reason code of the first failing transfer.
+bool i2cLoopback(Tpif& Apif, uint8_t Avalue, uint8_t AidByte, int *pReason);
+
+// Tries 100kHz, 400kHz, 600kHz, 800kHz and 1MHz in turn, stopping at the
+// first rate with a failed loopback or MCP23008 read. Every transfer
+// reports NACK and clock stretch timeouts, so no margin is kept: the
+// fastest clean rate is chosen and left set.
+uint32_t i2cProbe(Tpif& Apif, TI2cProbeResult *pResult=0);
+
+// "nack+clkt" etc, for reports
+const char *i2cReasonString(int Areasons);
+
+#endif
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,161 @@
+// jedec.cpp ----------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "jedec.h"
+
+#define DEVICE_NAME_TAG         "NOTE DEVICE NAME:"
+#define UFM_DATA_TAG            "NOTE TAG DATA"
+
+//---------------------------------------------------------------------
+bool jedecIsFuseRow(const char *line) {
+  return (line[0] == '0') || (line[0] == '1');
+  }
+
+//---------------------------------------------------------------------
+bool jedecDecodeRow(const char *line, uint8_t *p) {
+  for (int i=0; i<JEDEC_ROW_SIZE; i++) {
+    unsigned v = 0;
+    for (int b=0; b<8; b++) {
+      unsigned c = (unsigned)(*line++) - '0';
+      if (c > 1)                        // short line or stray character
+        return false;
+      v = (v << 1) | c;
+      }
+    *p++ = (uint8_t)v;
+    }
+  return true;
+  }
+
+//---------------------------------------------------------------------
+bool TjedecImage::stageFrames() {
+  free(pFrames);
+  pFrames    = 0;
+  FnumFrames = 0;
+
+  int n = cfgPages();
+  void *p = 0;
+  if (posix_memalign(&p, JEDEC_FRAME_ALIGN, (size_t)(n ? n : 1) * XO2_PROG_FRAME_SIZE) != 0)
+    return false;
+  pFrames = (uint8_t *)p;
+
+  static const uint8_t hdr[XO2_HDR_LEN] = { ISC_PROG_CFG_INCR, 0, 0, 1 };
+  uint8_t *f = pFrames;
+  for (int i=0; i<n; i++) {
+    memcpy(f, hdr, XO2_HDR_LEN);
+    memcpy(f + XO2_HDR_LEN, cfgPage(i), JEDEC_ROW_SIZE);
+    f += XO2_PROG_FRAME_SIZE;
+    }
+  FnumFrames = n;
+  return true;
+  }
+
+//---------------------------------------------------------------------
+bool TjedecImage::ufmPageBlank(int n) const {
+  const uint8_t *p = ufmPage(n);
+  for (int i=0; i<JEDEC_ROW_SIZE; i++)
+    if (p[i])
+      return false;
+  return true;
+  }
+
+//---------------------------------------------------------------------
+void TjedecImage::clear() {
+  Fdevice.clear();
+  Fcfg.clear();
+  Fufm.clear();
+  free(pFrames);
+  pFrames    = 0;
+  FnumFrames = 0;
+  }
+
+TjedecImage::~TjedecImage() {
+  free(pFrames);
+  }
+
+//---------------------------------------------------------------------
+// states, in file order
+enum { JS_HEADER, JS_CFG, JS_AFTER_CFG, JS_UFM_TAG, JS_UFM };
+
+bool jedecRead(FILE *fd, TjedecImage& img, int *pBadLine) {
+  char    *line = NULL;
+  size_t   len  = 0;
+  int      num  = 0;
+  bool     ok   = true;
+  int      state = JS_HEADER;
+  long     ufmBase = -1;                // fuse address of the UFM block
+  size_t   ufmAt = 0;                   // next UFM byte to fill
+  uint8_t  page[JEDEC_ROW_SIZE];
+
+  img.clear();
+  while (ok && (getline(&line, &len, fd) != -1)) {
+    num++;
+    bool row = jedecIsFuseRow(line);
+
+    if ((state == JS_CFG) && !row)
+      state = JS_AFTER_CFG;
+    if ((state == JS_AFTER_CFG) && strstr(line, UFM_DATA_TAG)) {
+      state = JS_UFM_TAG;
+      continue;
+      }
+    if ((state == JS_UFM_TAG) || (state == JS_UFM)) {
+      if (line[0] == 'L') {
+        long a = atol(line + 1);
+        if (ufmBase < 0)
+          ufmBase = a;
+        ufmAt = (size_t)((a - ufmBase) / 8);
+        state = JS_UFM;
+        continue;
+        }
+      if (!row) {
+        if (line[0] == '*')             // end of an 'L' field
+          state = JS_UFM_TAG;
+        else if (ufmBase >= 0)          // the next section
+          break;
+        continue;
+        }
+      state = JS_UFM;
+      if (!jedecDecodeRow(line, page)) {
+        ok = false;
+        break;
+        }
+      if (img.Fufm.size() < ufmAt + JEDEC_ROW_SIZE)
+        img.Fufm.resize(ufmAt + JEDEC_ROW_SIZE, 0);
+      memcpy(&img.Fufm[ufmAt], page, JEDEC_ROW_SIZE);
+      ufmAt += JEDEC_ROW_SIZE;
+      continue;
+      }
+    if (state == JS_AFTER_CFG)
+      continue;
+
+    if (!row) {
+      const char *tag = strstr(line, DEVICE_NAME_TAG);
+      if (tag) {
+        img.Fdevice = tag + strlen(DEVICE_NAME_TAG);
+        size_t e = img.Fdevice.find_last_not_of(" \t\r\n*");
+        size_t b = img.Fdevice.find_first_not_of(" \t");
+        img.Fdevice = (e == std::string::npos) ? "" : img.Fdevice.substr(b, e-b+1);
+        }
+      continue;
+      }
+    state = JS_CFG;
+    if (!jedecDecodeRow(line, page)) {
+      ok = false;
+      break;
+      }
+    img.Fcfg.insert(img.Fcfg.end(), page, page + JEDEC_ROW_SIZE);
+    }
+  if (!ok && pBadLine)
+    *pBadLine = num;
+  free(line);
+  return ok && img.stageFrames();
+  }
+
+// EOF ----------------------------------------------------------------
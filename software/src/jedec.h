@@ -0,0 +1,72 @@
+// jedec.h ------------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// JEDEC fuse file helpers
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef jedecH
+#define jedecH
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "xo2.h"
+
+#define JEDEC_ROW_SIZE          16        /* bytes, one XO2 flash page */
+#define JEDEC_FRAME_ALIGN       64        /* cache line */
+
+// a fuse row is a line of '0'/'1' characters, one bit per fuse
+bool jedecIsFuseRow(const char *line);
+
+// decode JEDEC_ROW_SIZE*8 fuse characters, MSB first, into p
+bool jedecDecodeRow(const char *line, uint8_t *p);
+
+//---------------------------------------------------------------------
+// a whole JEDEC file staged in memory before programming starts.
+// stageFrames() also lays out the SPI transmit stream, one
+// XO2_PROG_FRAME_SIZE record (ISC_PROG_CFG_INCR header + page) per
+// config page, back to back in one cache aligned block.
+class TjedecImage {
+  private:
+    uint8_t *pFrames;
+    int      FnumFrames;
+
+    TjedecImage(const TjedecImage&);              // not copyable
+    TjedecImage& operator=(const TjedecImage&);
+
+  public:
+    std::string           Fdevice;      // from 'NOTE DEVICE NAME:', if any
+    std::vector<uint8_t>  Fcfg;         // config flash pages, back to back
+    std::vector<uint8_t>  Fufm;         // UFM pages from page 0, if any
+
+    int cfgPages() const { return (int)(Fcfg.size() / JEDEC_ROW_SIZE); }
+    const uint8_t *cfgPage(int n) const { return &Fcfg[n * JEDEC_ROW_SIZE]; }
+
+    int ufmPages() const { return (int)(Fufm.size() / JEDEC_ROW_SIZE); }
+    const uint8_t *ufmPage(int n) const { return &Fufm[n * JEDEC_ROW_SIZE]; }
+    bool ufmPageBlank(int n) const;     // erased UFM reads as zeros
+
+    // NULL until stageFrames() has been called for the current Fcfg
+    bool stageFrames();
+    bool framesStaged() const { return (pFrames != 0) && (FnumFrames == cfgPages()); }
+    const uint8_t *frames(int n=0) const { return pFrames + n * XO2_PROG_FRAME_SIZE; }
+
+    void clear();
+
+    TjedecImage() : pFrames(0), FnumFrames(0) {}
+    ~TjedecImage();
+  };
+
+// reads the config fuse block and, if there is one, the UFM block that
+// follows 'NOTE TAG DATA', in one pass. An 'L' line inside the UFM
+// block moves on to the page at that fuse offset from the block start.
+// Returns false and sets *pBadLine on a malformed row.
+bool jedecRead(FILE *fd, TjedecImage& img, int *pBadLine=0);
+
+#endif
+// EOF ----------------------------------------------------------------
@@ -13,55 +13,65 @@
 #include <assert.h>
 
 //---------------------------------------------------------------------
-#define LL_WR_BUFF_SIZE       64        /* CFG_PAGE_SIZE is 16 bytes */
-class TllWrBuf {
+// command frame builder, CAP bytes held in place. Nothing is zeroed,
+// only the first length() bytes are ever sent.
+template <int CAP> class TllFrame {
   private:
-    uint8_t Fbuf[LL_WR_BUFF_SIZE];
+    uint8_t Fbuf[CAP];
     int     Flen;
 
   public:
-    TllWrBuf(int v) { clear(); byte(v); }
-    TllWrBuf()      { clear(); }
+    TllFrame(int v) : Flen(0) { byte(v); }
+    TllFrame()      : Flen(0) {}
 
-    TllWrBuf& clear() {
+    TllFrame& clear() {
       Flen = 0;
-      memset(Fbuf, 0, sizeof(Fbuf));
       return *this;
       }
-    TllWrBuf& byte(int v) {
-      assert(Flen < LL_WR_BUFF_SIZE);
+    TllFrame& byte(int v) {
+      assert(Flen < CAP);
       Fbuf[Flen] = (uint8_t)v;
       Flen++;
       return *this;
       }
-    TllWrBuf& wordLE(int v) {
+    TllFrame& bytes(const uint8_t *p, int n) {
+      assert((n >= 0) && (Flen + n <= CAP));
+      memcpy(Fbuf + Flen, p, n);
+      Flen += n;
+      return *this;
+      }
+    TllFrame& wordLE(int v) {
       uint32_t x = v;
       byte(x);
       byte(x >> 8);
       return *this;
       }
-    TllWrBuf& wordBE(int v) {
+    TllFrame& wordBE(int v) {
       uint32_t x = v;
       byte(x >> 8);
       byte(x);
       return *this;
       }
-    TllWrBuf& dwordLE(int v) {
+    TllFrame& dwordLE(int v) {
       uint32_t x = v;
       wordLE(x);
       wordLE(x >> 16);
       return *this;
       }
-    TllWrBuf& dwordBE(int v) {
+    TllFrame& dwordBE(int v) {
       uint32_t x = v;
       wordBE(x >> 16);
       wordBE(x);
       return *this;
       }
 
-    uint8_t *data() { return Fbuf; }
-    int     length(){ return Flen; }
+    uint8_t *data()    { return Fbuf; }
+    int     length()   { return Flen; }
+    int     capacity() { return CAP; }
   };
+
+#define LL_WR_BUFF_SIZE       64        /* CFG_PAGE_SIZE is 16 bytes */
+typedef TllFrame<LL_WR_BUFF_SIZE> TllWrBuf;
 #undef LL_WR_BUFF_SIZE
 
 #endif
@@ -7,6 +7,14 @@
 //---------------------------------------------------------------------
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
 
 #ifdef  _DEBUG
 # include <stdio.h>
@@ -15,8 +23,6 @@
 #include "lowlevel.h"
 #include "bcm2835.h"
 
-#define XO2_I2C_CLOCK_SPEED     (400 * 1000)
-
 #define MCP_FPGA_TDO            (1 << 0)
 #define MCP_FPGA_TDI            (1 << 1)
 #define MCP_FPGA_TCK            (1 << 2)
@@ -26,24 +32,209 @@
 #define MCP_FPGA_INITn          (1 << 6)
 #define MCP_FPGA_DONE           (1 << 7)
 
+//---------------------------------------------------------------------
+void TlowLevel::_hwI2cSetSlave(int AslaveAddr) {
+  bcm2835_i2c_setSlaveAddress(AslaveAddr);
+  }
+
+int TlowLevel::_hwI2cWrite(const uint8_t *pWrData, size_t AwrLen) {
+  return bcm2835_i2c_write((const char *)pWrData, AwrLen);
+  }
+
+int TlowLevel::_hwI2cRead(uint8_t *pRdData, size_t ArdLen) {
+  return bcm2835_i2c_read((char *)pRdData, ArdLen);
+  }
+
+int TlowLevel::_hwI2cWriteReadRs(const uint8_t *pWrData,
+                                 uint8_t *pRdData, size_t ArdLen) {
+  return bcm2835_i2c_read_register_rs((char *)pWrData,
+                                                  (char *)pRdData, ArdLen);
+  }
+
+void TlowLevel::_hwSpiWrite(const uint8_t *pWrData, size_t AwrLen) {
+  bcm2835_spi_writenb((char *)pWrData, AwrLen);
+  }
+
+void TlowLevel::_hwSpiTransfer(uint8_t *pData, size_t Alen) {
+  bcm2835_spi_transfern((char *)pData, Alen);
+  }
+
+//---------------------------------------------------------------------
+// bcm2835_spi_transfernb(), but walking the segment lists directly so
+// headers and payloads go to and from the FIFO without being copied
+void TlowLevel::_hwSpiSegs(const TspiSeg *pSegs, int AnumSegs) {
+  volatile uint32_t* paddr = bcm2835_spi0 + BCM2835_SPI0_CS/4;
+  volatile uint32_t* fifo  = bcm2835_spi0 + BCM2835_SPI0_FIFO/4;
+
+  size_t total = 0;
+  for (int i=0; i<AnumSegs; i++)
+    total += pSegs[i].len;
+
+  int    txSeg = 0, rxSeg = 0;
+  size_t txOff = 0, rxOff = 0, txCnt = 0, rxCnt = 0;
+
+  bcm2835_peri_set_bits(paddr, BCM2835_SPI0_CS_CLEAR, BCM2835_SPI0_CS_CLEAR);
+  bcm2835_peri_set_bits(paddr, BCM2835_SPI0_CS_TA, BCM2835_SPI0_CS_TA);
+
+  while ((txCnt < total) || (rxCnt < total)) {
+    while ((txCnt < total) && (bcm2835_peri_read(paddr) & BCM2835_SPI0_CS_TXD)) {
+      while (txOff == pSegs[txSeg].len) {
+        txSeg++;
+        txOff = 0;
+        }
+      const uint8_t *p = pSegs[txSeg].pWr;
+      bcm2835_peri_write_nb(fifo, p ? p[txOff] : 0);
+      txOff++;
+      txCnt++;
+      }
+    while ((rxCnt < total) && (bcm2835_peri_read(paddr) & BCM2835_SPI0_CS_RXD)) {
+      while (rxOff == pSegs[rxSeg].len) {
+        rxSeg++;
+        rxOff = 0;
+        }
+      uint8_t v = (uint8_t)bcm2835_peri_read_nb(fifo);
+      if (pSegs[rxSeg].pRd)
+        pSegs[rxSeg].pRd[rxOff] = v;
+      rxOff++;
+      rxCnt++;
+      }
+    }
+
+  while (!(bcm2835_peri_read_nb(paddr) & BCM2835_SPI0_CS_DONE))
+    ;
+  bcm2835_peri_set_bits(paddr, 0, BCM2835_SPI0_CS_TA);
+  }
+
+//---------------------------------------------------------------------
+// one chip-select per frame. The records are contiguous so a spidev
+// transport could hand them over as a single SPI_IOC_MESSAGE array.
+void TlowLevel::_hwSpiWriteFrames(const uint8_t *pFrames, size_t AframeLen,
+                                                  int AnumFrames, long AgapNs) {
+  for (int i=0; i<AnumFrames; i++) {
+    _hwSpiWrite(pFrames, AframeLen);
+    pFrames += AframeLen;
+    if (AgapNs > 0)
+      _hwSleep(AgapNs);
+    }
+  }
+
+void TlowLevel::_hwSleep(long ns) {
+  struct timespec sleeper;
+  sleeper.tv_sec  = ns / 1000000000L;
+  sleeper.tv_nsec = ns % 1000000000L;
+  nanosleep(&sleeper, NULL);
+  }
+
+//---------------------------------------------------------------------
+// version 1 of the GPIO character device ABI, in every kernel since
+// 4.8. Its timestamps are CLOCK_MONOTONIC from 5.7, CLOCK_REALTIME
+// before that.
+bool TlowLevel::_hwAttnOpen(int Agpio) {
+  int chip = open(LL_GPIO_CHIP, O_RDONLY | O_CLOEXEC);
+  if (chip < 0)
+    return false;
+
+  struct gpioevent_request req;
+  memset(&req, 0, sizeof(req));
+  req.lineoffset  = Agpio;
+  req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+  req.eventflags  = GPIOEVENT_REQUEST_RISING_EDGE;
+  strncpy(req.consumer_label, "pif-attn", sizeof(req.consumer_label) - 1);
+  int res = ioctl(chip, GPIO_GET_LINEEVENT_IOCTL, &req);
+  close(chip);
+  if (res < 0)
+    return false;
+
+  FattnFd  = req.fd;
+  FepollFd = epoll_create1(EPOLL_CLOEXEC);
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events  = EPOLLIN | EPOLLPRI;
+  ev.data.fd = FattnFd;
+  if ((FepollFd < 0) || (epoll_ctl(FepollFd, EPOLL_CTL_ADD, FattnFd, &ev) < 0)) {
+    _hwAttnClose();
+    return false;
+    }
+  return true;
+  }
+
+void TlowLevel::_hwAttnClose() {
+  if (FepollFd >= 0)
+    close(FepollFd);
+  if (FattnFd >= 0)
+    close(FattnFd);
+  FepollFd = FattnFd = -1;
+  }
+
+int TlowLevel::_hwAttnWait(int AtimeoutMs, uint64_t *pTimestampNs) {
+  struct epoll_event ev;
+  int n;
+  do
+    n = epoll_wait(FepollFd, &ev, 1, AtimeoutMs);
+  while ((n < 0) && (errno == EINTR));
+  if (n <= 0)
+    return n;
+
+  struct gpioevent_data ed;
+  if (read(FattnFd, &ed, sizeof(ed)) != (ssize_t)sizeof(ed))
+    return -1;
+  *pTimestampNs = ed.timestamp;
+  return 1;
+  }
+
+int TlowLevel::_hwAttnLevel() {
+  struct gpiohandle_data d;
+  if (ioctl(FattnFd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &d) < 0)
+    return -1;
+  return d.values[0] ? 1 : 0;
+  }
+
+//---------------------------------------------------------------------
+size_t TlowLevel::_gather(const TspiSeg *pSegs, int AnumSegs) {
+  size_t total = 0;
+  for (int i=0; i<AnumSegs; i++)
+    total += pSegs[i].len;
+  if (Fscratch.size() < total)
+    Fscratch.resize(total);
+
+  uint8_t *p = &Fscratch[0];
+  for (int i=0; i<AnumSegs; i++) {
+    if (pSegs[i].pWr)
+      memcpy(p, pSegs[i].pWr, pSegs[i].len);
+    else
+      memset(p, 0, pSegs[i].len);
+    p += pSegs[i].len;
+    }
+  return total;
+  }
+
+void TlowLevel::_scatter(const TspiSeg *pSegs, int AnumSegs) {
+  const uint8_t *p = &Fscratch[0];
+  for (int i=0; i<AnumSegs; i++) {
+    if (pSegs[i].pRd)
+      memcpy(pSegs[i].pRd, p, pSegs[i].len);
+    p += pSegs[i].len;
+    }
+  }
+
 //---------------------------------------------------------------------
 void TlowLevel::_setI2Caddr(int AslaveAddr) {
   if (Fi2cSlaveAddr != AslaveAddr)
-    bcm2835_i2c_setSlaveAddress(AslaveAddr);
+    _hwI2cSetSlave(AslaveAddr);
   Fi2cSlaveAddr = AslaveAddr;
   }
 
 //---------------------------------------------------------------------
 bool TlowLevel::i2cWrite(int AslaveAddr, const uint8_t *pWrData, size_t AwrLen) {
   _setI2Caddr(AslaveAddr);
-  FlastResult = bcm2835_i2c_write((char *)pWrData, AwrLen);
+  FlastResult = _hwI2cWrite(pWrData, AwrLen);
   return (FlastResult==BCM2835_I2C_REASON_OK);
   }
 
 //---------------------------------------------------------------------
 bool TlowLevel::i2cRead(int AslaveAddr, uint8_t *pRdData, size_t ArdLen) {
   _setI2Caddr(AslaveAddr);
-  FlastResult = bcm2835_i2c_read((char *)pRdData, ArdLen);
+  FlastResult = _hwI2cRead(pRdData, ArdLen);
   return (FlastResult==BCM2835_I2C_REASON_OK);
   }
 
@@ -53,22 +244,60 @@ bool TlowLevel::i2cWriteRead(int AslaveAddr,
                           const uint8_t *pWrData,
                           uint8_t *pRdData, size_t ArdLen) {
   _setI2Caddr(AslaveAddr);
-  FlastResult = bcm2835_i2c_read_register_rs((char *)pWrData,
-                                                  (char *)pRdData, ArdLen);
+  FlastResult = _hwI2cWriteReadRs(pWrData, pRdData, ArdLen);
 
   return (FlastResult==BCM2835_I2C_REASON_OK);
   }
 
 //---------------------------------------------------------------------
+void TlowLevel::_hwSpiSetDivider(int Adivider) {
+  bcm2835_spi_setClockDivider((uint16_t)Adivider);  // 65536 is written as 0
+  }
+
+bool TlowLevel::setSpiDivider(int Adivider) {
+  if ((Adivider < 2) || (Adivider > 65536) || (Adivider & 1))
+    return false;
+  if (FspiConfig)
+    _hwSpiSetDivider(Adivider);
+  FspiDivider = Adivider;
+  return true;
+  }
+
+//---------------------------------------------------------------------
+void TlowLevel::_hwI2cSetBaudrate(uint32_t Ahz) {
+  bcm2835_i2c_set_baudrate(Ahz);
+  }
+
+bool TlowLevel::setI2cRate(uint32_t Ahz) {
+  if ((Ahz < 10 * 1000) || (Ahz > LL_I2C_MAX_HZ))
+    return false;
+  _hwI2cSetBaudrate(Ahz);
+  Fi2cHz = Ahz;
+  return true;
+  }
+
+//---------------------------------------------------------------------
+void TlowLevel::_hwSpiChipSelect(bool Aconfig) {
+  uint8_t cs = Aconfig ? BCM2835_SPI_CS0 : BCM2835_SPI_CS1;
+  bcm2835_spi_chipSelect(cs);
+  bcm2835_spi_setChipSelectPolarity(cs, LOW);
+  }
+
+// CE0 is the sysCONFIG port, CE1 the EFB SPI slave in pifwb.vhd. Each
+// side keeps its own clock, switched only when the side changes.
 void TlowLevel::_setSpiConfig(bool Aconfig) {
-  // TODO
+  if (FspiConfig == Aconfig)
+    return;
+  _hwSpiChipSelect(Aconfig);
+  _hwSpiSetDivider(Aconfig ? FspiDivider : LL_SPI_APP_DIVIDER);
+  FspiConfig = Aconfig;
   }
 
 //---------------------------------------------------------------------
 bool TlowLevel::spiWrite(bool aConfig, const uint8_t *pWrData, size_t AwrLen) {
   _setSpiConfig(aConfig);
   FlastResult = 0;
-  bcm2835_spi_writenb((char *)pWrData, AwrLen);
+  _hwSpiWrite(pWrData, AwrLen);
   return true;
   }
 
@@ -76,7 +305,7 @@ bool TlowLevel::spiWrite(bool aConfig, const uint8_t *pWrData, size_t AwrLen) {
 bool TlowLevel::spiRead(bool aConfig, uint8_t *pRdData, size_t ArdLen) {
   _setSpiConfig(aConfig);
   FlastResult = 0;
-  bcm2835_spi_transfern((char *)pRdData, ArdLen);
+  _hwSpiTransfer(pRdData, ArdLen);
   return true;
   }
 
@@ -84,20 +313,72 @@ bool TlowLevel::spiRead(bool aConfig, uint8_t *pRdData, size_t ArdLen) {
 bool TlowLevel::spiWriteRead(bool aConfig,
                           const uint8_t *pWrData, size_t AwrLen,
                           uint8_t *pRdData, size_t ArdLen) {
+  TspiSeg segs[2];
+  segs[0].pWr = pWrData;  segs[0].pRd = 0;        segs[0].len = AwrLen;
+  segs[1].pWr = 0;        segs[1].pRd = pRdData;  segs[1].len = ArdLen;
+  return spiTransferSegs(aConfig, segs, 2);
+  }
+
+//---------------------------------------------------------------------
+bool TlowLevel::spiWriteFrames(bool aConfig, const uint8_t *pFrames,
+                          size_t AframeLen, int AnumFrames, long AgapNs) {
   _setSpiConfig(aConfig);
   FlastResult = 0;
+  _hwSpiWriteFrames(pFrames, AframeLen, AnumFrames, AgapNs);
+  return true;
+  }
 
-  uint8_t *buff = new uint8_t[AwrLen + ArdLen];
-  memcpy(buff, pWrData, AwrLen);
-  memcpy(buff+AwrLen, pRdData, ArdLen);
-  bcm2835_spi_transfern((char *)buff, AwrLen + ArdLen);
-  memcpy(pRdData, buff+AwrLen, ArdLen);
-  delete[] buff;
+//---------------------------------------------------------------------
+bool TlowLevel::spiTransferSegs(bool aConfig,
+                          const TspiSeg *pSegs, int AnumSegs) {
+  _setSpiConfig(aConfig);
+  FlastResult = 0;
+  _hwSpiSegs(pSegs, AnumSegs);
   return true;
   }
 
 //---------------------------------------------------------------------
-TlowLevel::TlowLevel() : Fi2cSlaveAddr(~I2C_APP_ADDR) {
+bool TlowLevel::attnOpen(int Agpio) {
+  attnClose();
+  FattnOpen = _hwAttnOpen(Agpio);
+  return FattnOpen;
+  }
+
+void TlowLevel::attnClose() {
+  if (FattnOpen)
+    _hwAttnClose();
+  FattnOpen = false;
+  }
+
+int TlowLevel::attnWait(int AtimeoutMs, uint64_t *pTimestampNs) {
+  uint64_t ts = 0;
+  if (!FattnOpen)
+    return -1;
+  int res = _hwAttnWait(AtimeoutMs, &ts);
+  if (pTimestampNs)
+    *pTimestampNs = ts;
+  return res;
+  }
+
+int TlowLevel::attnLevel() {
+  return FattnOpen ? _hwAttnLevel() : -1;
+  }
+
+//---------------------------------------------------------------------
+void TlowLevel::_init(bool AopenHardware) {
+  Fi2cSlaveAddr = ~I2C_APP_ADDR;
+  FlastResult   = 0;
+  FspiDivider   = LL_SPI_DEFAULT_DIVIDER;
+  FspiConfig    = RW_CONFIG;
+  Fi2cHz        = LL_I2C_DEFAULT_HZ;
+  Finitialised  = false;
+  FattnOpen     = false;
+  FattnFd       = -1;
+  FepollFd      = -1;
+  Fscratch.reserve(LL_SPI_SCRATCH_SIZE);
+  if (!AopenHardware)
+    return;
+
   int res = bcm2835_init();
   Finitialised = (res == 1);
 
@@ -105,7 +386,7 @@ TlowLevel::TlowLevel() : Fi2cSlaveAddr(~I2C_APP_ADDR) {
     // i2c initialise
     //bcm2835_set_debug(10);
     bcm2835_i2c_begin();
-    bcm2835_i2c_set_baudrate(XO2_I2C_CLOCK_SPEED);
+    bcm2835_i2c_set_baudrate(LL_I2C_DEFAULT_HZ);
 
     // MCP23008 bits
     _setI2Caddr(MCP23008_ADDR);
@@ -124,14 +405,25 @@ TlowLevel::TlowLevel() : Fi2cSlaveAddr(~I2C_APP_ADDR) {
     bcm2835_spi_setBitOrder(BCM2835_SPI_BIT_ORDER_MSBFIRST);      // default
     bcm2835_spi_setDataMode(BCM2835_SPI_MODE0);                   // default
 //  bcm2835_spi_setClockDivider(BCM2835_SPI_CLOCK_DIVIDER_65536); // default
-    bcm2835_spi_setClockDivider(BCM2835_SPI_CLOCK_DIVIDER_32);    // 8MHz
+    bcm2835_spi_setClockDivider(LL_SPI_DEFAULT_DIVIDER);          // 8MHz
     bcm2835_spi_chipSelect(BCM2835_SPI_CS0);                      // default
     bcm2835_spi_setChipSelectPolarity(BCM2835_SPI_CS0, LOW);      // default
     }
   }
 
+//---------------------------------------------------------------------
+TlowLevel::TlowLevel() {
+  _init(true);
+  }
+
+// used by simulated transports, no hardware is touched
+TlowLevel::TlowLevel(bool AopenHardware) {
+  _init(AopenHardware);
+  }
+
 //---------------------------------------------------------------------
 TlowLevel::~TlowLevel() {
+  attnClose();
   if (Finitialised) {
     bcm2835_spi_end();
     bcm2835_i2c_end();
@@ -9,6 +9,7 @@
 #define lowlevelH
 
 #include <stdint.h>
+#include <vector>
 #include "llbufs.h"
 
 #define MCP23008_ADDR       0x20
@@ -20,16 +21,75 @@
 #define RW_CONFIG           true
 #define RW_APP              (!RW_CONFIG)
 
+#define LL_SPI_SCRATCH_SIZE 4096            /* initial per-handle scratch */
+
+#define LL_SPI_CORE_HZ      250e6           /* SPI0 divides the core clock */
+#define LL_SPI_DEFAULT_DIVIDER 32           /* ~8MHz, safe on any cable */
+#define LL_SPI_APP_DIVIDER  64              /* ~3.9MHz, pifwb keeps up */
+
+#define LL_I2C_DEFAULT_HZ   (400 * 1000)    /* Fast-mode */
+#define LL_I2C_MAX_HZ       (1000 * 1000)   /* Fast-mode Plus */
+
+#define LL_GPIO_CHIP        "/dev/gpiochip0"
+#define LL_ATTN_GPIO        25              /* FPGA attention, pif2.lpf */
+
+//---------------------------------------------------------------------
+// one piece of a single chip-select SPI transaction, iovec style
+// pWr == NULL clocks out zeros, pRd == NULL discards the MISO bytes
+struct TspiSeg {
+  const uint8_t *pWr;
+  uint8_t       *pRd;
+  size_t         len;
+  };
+
 //---------------------------------------------------------------------
 class TlowLevel {
   private:
     int   Fi2cSlaveAddr;
     bool  Finitialised;
     int   FlastResult;
+    int   FspiDivider;
+    bool  FspiConfig;                       // CE0 selected, else CE1
+    uint32_t Fi2cHz;
+    bool  FattnOpen;
+    int   FattnFd;                          // line event handle
+    int   FepollFd;
 
+    void _init(bool AopenHardware);
     void _setI2Caddr(int AslaveAddr);
     void _setSpiConfig(bool Aconfig);
 
+  protected:
+    // bus primitives. The defaults drive the bcm2835 peripherals, a
+    // simulated transport (see pifsim.h) overrides them.
+    virtual void _hwI2cSetSlave(int AslaveAddr);
+    virtual int  _hwI2cWrite(const uint8_t *pWrData, size_t AwrLen);
+    virtual int  _hwI2cRead(uint8_t *pRdData, size_t ArdLen);
+    virtual int  _hwI2cWriteReadRs(const uint8_t *pWrData,
+                                            uint8_t *pRdData, size_t ArdLen);
+    virtual void _hwSpiWrite(const uint8_t *pWrData, size_t AwrLen);
+    virtual void _hwSpiTransfer(uint8_t *pData, size_t Alen);
+    virtual void _hwSpiSegs(const TspiSeg *pSegs, int AnumSegs);
+    virtual void _hwSpiWriteFrames(const uint8_t *pFrames, size_t AframeLen,
+                                                  int AnumFrames, long AgapNs);
+    virtual void _hwSpiSetDivider(int Adivider);
+    virtual void _hwSpiChipSelect(bool Aconfig);
+    virtual void _hwI2cSetBaudrate(uint32_t Ahz);
+    virtual void _hwSleep(long ns);
+    virtual bool _hwAttnOpen(int Agpio);
+    virtual void _hwAttnClose();
+    virtual int  _hwAttnWait(int AtimeoutMs, uint64_t *pTimestampNs);
+    virtual int  _hwAttnLevel();
+
+    // for transports that need the transaction in one buffer. It grows
+    // to the largest transaction seen and is then reused, no heap
+    // traffic in steady state.
+    std::vector<uint8_t> Fscratch;
+    size_t  _gather(const TspiSeg *pSegs, int AnumSegs);
+    void    _scatter(const TspiSeg *pSegs, int AnumSegs);
+
+    TlowLevel(bool AopenHardware);
+
   public:
     //-------------------------------------------
     bool i2cWrite(int AslaveAddr, const uint8_t *pWrData, size_t AwrLen);
@@ -41,11 +101,38 @@ class TlowLevel {
     bool spiRead(bool aConfig, uint8_t *pRdData, size_t ArdLen);
     bool spiWriteRead(bool aConfig, const uint8_t *pWrData, size_t AwrLen,
                                             uint8_t *pRdData, size_t ArdLen);
+    bool spiTransferSegs(bool aConfig, const TspiSeg *pSegs, int AnumSegs);
+
+    // AnumFrames write-only transactions of AframeLen bytes each, laid
+    // out back to back at pFrames, with AgapNs between them
+    bool spiWriteFrames(bool aConfig, const uint8_t *pFrames, size_t AframeLen,
+                                                  int AnumFrames, long AgapNs);
     int lastReturnCode() { return FlastResult; }
 
+    // config port SPI clock = LL_SPI_CORE_HZ / Adivider, any even
+    // number 2..65536. The app port on CE1 runs at LL_SPI_APP_DIVIDER.
+    bool setSpiDivider(int Adivider);
+    int  spiDivider() { return FspiDivider; }
+
+    // the app channel and the MCP23008 share the bus, up to LL_I2C_MAX_HZ
+    bool setI2cRate(uint32_t Ahz);
+    uint32_t i2cRate() { return Fi2cHz; }
+
+    void sleepNs(long ns) { _hwSleep(ns); }
+
+    // the FPGA's attention output on a Pi GPIO, rising edges from the
+    // GPIO character device. A wait gives 1 and the kernel's timestamp
+    // of the edge, 0 once AtimeoutMs is up (-1 waits for ever), -1 on
+    // an error. Edges queue up until waited for. The level is 1 or 0,
+    // -1 on an error.
+    bool attnOpen(int Agpio=LL_ATTN_GPIO);
+    void attnClose();
+    int  attnWait(int AtimeoutMs, uint64_t *pTimestampNs);
+    int  attnLevel();
+
     //-------------------------------------------
     TlowLevel();
-    ~TlowLevel();
+    virtual ~TlowLevel();
   };
 
 #endif
@@ -127,46 +127,41 @@ Non-Volatile Register (NVR) Commands
 
 #include <assert.h>
 #include <stdio.h>
-#include <time.h>
+#include <string.h>
 
 #include "lowlevel.h"
 #include "bcm2835.h"
 #include "pif.h"
-
-#define ISC_ERASE               0x0e
-#define ISC_DISABLE             0x26
-#define ISC_INIT_CFG_ADDR       0x46
-#define ISC_INIT_UFM_ADDR       0x47
-#define ISC_PROG_DONE           0x5e
-#define ISC_PROG_CFG_INCR       0x70
-#define ISC_READ_CFG_INCR       0x73
-#define ISC_ENABLE_X            0x74
-#define ISC_REFRESH             0x79
-#define ISC_ENABLE_PROG         0xc6
-#define ISC_PROG_UFM_INCR       0xc9
-#define ISC_READ_UFM_INCR       0xca
-#define ISC_ERASE_UFM           0xcb
-#define LSC_WRITE_ADDRESS       0xb4
-
-#define BYPASS                  0xff
-#define CHECK_BUSY_FLAG         0xf0
-
-#define READ_DEVICE_ID_CODE     0xe0
-#define READ_STATUS_REG         0x3c
-#define READ_TRACE_ID_CODE      0x19
-
-#define READ_USERCODE           0xc0
-#define ISC_PROGRAM_USERCODE    0xc2
+#include "xo2.h"
+#include "ufmcache.h"
+#include "appshadow.h"
+#include "appcodec.h"
 
 static const int MICROSEC = 1000;              // nanosecs
 static const int MILLISEC = 1000 * MICROSEC;   // nanosecs
 
+//---------------------------------------------------------------------
+// fixed command headers, built by the compiler rather than per call
+static const uint8_t hdrIdCode[]     = { READ_DEVICE_ID_CODE, 0, 0, 0 };
+static const uint8_t hdrStatus[]     = { READ_STATUS_REG,     0, 0, 0 };
+static const uint8_t hdrTraceId[]    = { READ_TRACE_ID_CODE,  0, 0, 0 };
+static const uint8_t hdrUsercode[]   = { READ_USERCODE,       0, 0, 0 };
+static const uint8_t hdrBusyFlag[]   = { CHECK_BUSY_FLAG,     0, 0, 0 };
+static const uint8_t hdrRefresh[]    = { ISC_REFRESH,         0, 0 };
+static const uint8_t hdrDisable[]    = { ISC_DISABLE,         0, 0 };
+static const uint8_t hdrBypass[]     = { BYPASS,              0xff, 0xff, 0xff };
+static const uint8_t hdrProgUser[]   = { ISC_PROGRAM_USERCODE, 0, 0, 0 };
+
+// one page per program command. A read asks for the 0x10 (no dummy)
+// format, _readPages() puts the page count in the last two bytes
+static const uint8_t hdrProgCfg[]    = { ISC_PROG_CFG_INCR,   0, 0, 1 };
+static const uint8_t hdrProgUfm[]    = { ISC_PROG_UFM_INCR,   0, 0, 1 };
+static const uint8_t hdrReadCfg[]    = { ISC_READ_CFG_INCR,   0x10, 0, 1 };
+static const uint8_t hdrReadUfm[]    = { ISC_READ_UFM_INCR,   0x10, 0, 1 };
+
 //---------------------------------------------------------------------
 void Tpif::shortSleep(int ns) {
-  struct timespec sleeper;
-  sleeper.tv_sec  = 0;
-  sleeper.tv_nsec = (long)(ns);
-  nanosleep(&sleeper, NULL);
+  pLo->sleepNs(ns);
   }
 
 //---------------------------------------------------------------------
@@ -178,29 +173,25 @@ uint32_t Tpif::_dwordBE(uint8_t *p) {
   }
 
 //---------------------------------------------------------------------
-bool Tpif::_cfgWrite(TllWrBuf& oBuf) {
-  if (oBuf.length() > 0)
-    return pLo->spiWrite(RW_CONFIG, oBuf.data(), oBuf.length());
+bool Tpif::_cfgWrite(const uint8_t *pWrData, size_t AwrLen) {
+  if (AwrLen > 0)
+    return pLo->spiWrite(RW_CONFIG, pWrData, AwrLen);
   else
     return true;
   }
 
 //---------------------------------------------------------------------
-bool Tpif::_cfgWriteRead(TllWrBuf& oBuf, uint8_t *pRdData, size_t ArdLen) {
+bool Tpif::_cfgWriteRead(const uint8_t *pWrData, size_t AwrLen,
+                                            uint8_t *pRdData, size_t ArdLen) {
   assert(pRdData);
-  memset(pRdData, 0, ArdLen);
-  return pLo->spiWriteRead(RW_CONFIG, oBuf.data(), oBuf.length(),
-                                                            pRdData, ArdLen);
+  return pLo->spiWriteRead(RW_CONFIG, pWrData, AwrLen, pRdData, ArdLen);
   }
 
 //---------------------------------------------------------------------
 bool Tpif::getDeviceIdCode(uint32_t& v) {
   v = 0;
-  TllWrBuf oBuf;
-  oBuf.byte(READ_DEVICE_ID_CODE).byte(0).byte(0).byte(0);
-
   uint8_t p[4];
-  bool ok = _cfgWriteRead(oBuf, p, 4);
+  bool ok = _cfgWriteRead(hdrIdCode, sizeof(hdrIdCode), p, 4);
   v = _dwordBE(p);
   return ok;
   }
@@ -208,20 +199,15 @@ bool Tpif::getDeviceIdCode(uint32_t& v) {
 //---------------------------------------------------------------------
 bool Tpif::getStatusReg(uint32_t& v) {
   v = 0;
-  TllWrBuf oBuf;
-  oBuf.byte(READ_STATUS_REG).byte(0).byte(0).byte(0);
-
   uint8_t p[4];
-  bool ok = _cfgWriteRead(oBuf, p, 4);
+  bool ok = _cfgWriteRead(hdrStatus, sizeof(hdrStatus), p, 4);
   v = _dwordBE(p);
   return ok;
   }
 
 //---------------------------------------------------------------------
 bool Tpif::getTraceId(uint8_t* p) {
-  TllWrBuf oBuf;
-  oBuf.byte(READ_TRACE_ID_CODE).byte(0).byte(0).byte(0);
-  return _cfgWriteRead(oBuf, p, 8);
+  return _cfgWriteRead(hdrTraceId, sizeof(hdrTraceId), p, 8);
   }
 
 //---------------------------------------------------------------------
@@ -238,19 +224,28 @@ bool Tpif::initCfgAddr() {
   }
 
 //---------------------------------------------------------------------
-bool Tpif::_initUfmAddr() {
+bool Tpif::initUfmAddr() {
   return _doSimple(ISC_INIT_UFM_ADDR);
   }
 
-bool Tpif::_setUfmPageAddr(int pageNumber) {
+// operand byte 0 selects the sector, 0x40 is the UFM
+bool Tpif::_setPageAddr(int Asector, int pageNumber) {
   TllWrBuf oBuf;
   int hi = (pageNumber >> 8) & 0xff;
   int lo = (pageNumber >> 0) & 0xff;
-  oBuf.byte(LSC_WRITE_ADDRESS).byte(0).byte(0).byte(0).byte(0x40).byte(0)
+  oBuf.byte(LSC_WRITE_ADDRESS).byte(0).byte(0).byte(0).byte(Asector).byte(0)
                                                           .byte(hi).byte(lo);
   return _cfgWrite(oBuf);
   }
 
+bool Tpif::setUfmPageAddr(int pageNumber) {
+  return _setPageAddr(0x40, pageNumber);
+  }
+
+bool Tpif::setCfgPageAddr(int pageNumber) {
+  return _setPageAddr(0x00, pageNumber);
+  }
+
 bool Tpif::progDone() {
   bool ok = _doSimple(ISC_PROG_DONE);
   // sleep for 200us
@@ -259,15 +254,15 @@ bool Tpif::progDone() {
   }
 
 bool Tpif::refresh() {
-  TllWrBuf oBuf;
-  oBuf.byte(ISC_REFRESH).byte(0).byte(0);
-  bool ok = _cfgWrite(oBuf);
+  bool ok = _cfgWrite(hdrRefresh, sizeof(hdrRefresh));
   // sleep for 5ms
   shortSleep(5 * MILLISEC);
   return ok;
   }
 
 bool Tpif::erase(int Amask) {
+  if (pUfmCache && (Amask & UFM_ERASE))
+    pUfmCache->invalidate();
   bool ok = _doSimple(ISC_ERASE, Amask);
   waitUntilNotBusy(-1);
   return ok;
@@ -278,6 +273,8 @@ bool Tpif::eraseCfg()  { return erase(CFG_ERASE); }
 bool Tpif::eraseAll()  { return erase(UFM_ERASE | CFG_ERASE | FEATURE_ERASE); }
 
 bool Tpif::eraseUfm() {
+  if (pUfmCache)
+    pUfmCache->invalidate();
   return _doSimple(ISC_ERASE_UFM);
   }
 
@@ -297,91 +294,117 @@ bool Tpif::enableCfgInterfaceTransparent() {
 bool Tpif::disableCfgInterface() {
   waitUntilNotBusy(-1);
 
-  TllWrBuf oBuf;
-  oBuf.byte(ISC_DISABLE).byte(0).byte(0);
-  bool ok = _cfgWrite(oBuf);
-
-  if (ok) {
-    oBuf.clear().byte(BYPASS).byte(0xff).byte(0xff).byte(0xff);
-    ok = _cfgWrite(oBuf);
-    }
+  bool ok = _cfgWrite(hdrDisable, sizeof(hdrDisable));
+  if (ok)
+    ok = _cfgWrite(hdrBypass, sizeof(hdrBypass));
   return ok;
   }
 
 //---------------------------------------------------------------------
-bool Tpif::_progPage(int Acmd, const uint8_t *p) {
-  TllWrBuf oBuf;
-  oBuf.byte(Acmd).byte(0).byte(0).byte(1);
-  for (int i=0; i<CFG_PAGE_SIZE; i++)
-    oBuf.byte(*p++);
+bool Tpif::_progPage(const uint8_t *pHdr, const uint8_t *p) {
+  TllFrame<XO2_PROG_FRAME_SIZE> oBuf;
+  oBuf.bytes(pHdr, XO2_HDR_LEN).bytes(p, CFG_PAGE_SIZE);
 
-  bool ok = _cfgWrite(oBuf);
+  bool ok = _cfgWrite(oBuf.data(), oBuf.length());
   // sleep for 200us
   shortSleep(200 * MICROSEC);
   return ok;
   }
 
 //---------------------------------------------------------------------
-bool Tpif::_readPage(int Acmd, uint8_t *p) {
-  const int totalPages     = 1;
-  const int numBytesToRead = CFG_PAGE_SIZE * totalPages;
-
-  TllWrBuf oBuf;
-  oBuf.byte(Acmd).byte(0x10).wordBE(totalPages);
-  return _cfgWriteRead(oBuf, p, numBytesToRead);
-  }
-
-//---------------------------------------------------------------------
-bool Tpif::_readPages(int Acmd, int numPages, uint8_t *p) {
+// up to READ_BURST_PAGES pages per command, streamed back to back
+bool Tpif::_readPages(const uint8_t *pHdr, int numPages, uint8_t *p) {
   assert((numPages >= 0) && (p != 0));
+  uint8_t hdr[XO2_HDR_LEN];
+  memcpy(hdr, pHdr, XO2_HDR_LEN);
+
   bool ok = true;
-  for (int i=0; ok && (i<numPages); i++) {
-    ok = _readPage(Acmd, p + CFG_PAGE_SIZE*i);
+  for (int i=0; ok && (i<numPages); i+=READ_BURST_PAGES) {
+    int n = numPages - i;
+    if (n > READ_BURST_PAGES)
+      n = READ_BURST_PAGES;
+    hdr[2] = (uint8_t)(n >> 8);
+    hdr[3] = (uint8_t)n;
+    ok = _cfgWriteRead(hdr, XO2_HDR_LEN, p + CFG_PAGE_SIZE*i,
+                                                (size_t)n * CFG_PAGE_SIZE);
     }
   return ok;
   }
 
 //---------------------------------------------------------------------
 bool Tpif::progCfgPage(const uint8_t *p) {
-  return _progPage(ISC_PROG_CFG_INCR, p);
+  return _progPage(hdrProgCfg, p);
+  }
+
+// XO2_PROG_FRAME_SIZE records, header included, see TjedecImage
+bool Tpif::progCfgFrames(const uint8_t *pFrames, int numFrames) {
+  return pLo->spiWriteFrames(RW_CONFIG, pFrames, XO2_PROG_FRAME_SIZE,
+                                              numFrames, 200 * MICROSEC);
   }
 
 bool Tpif::readCfgPages(int numPages, uint8_t *p) {
-  return _readPages(ISC_READ_CFG_INCR, numPages, p);
+  return _readPages(hdrReadCfg, numPages, p);
   }
 
-bool Tpif::_progUfmPage(const uint8_t *p) {
-  return _progPage(ISC_PROG_UFM_INCR, p);
+bool Tpif::progUfmPage(const uint8_t *p) {
+  return _progPage(hdrProgUfm, p);
   }
 
 bool Tpif::readUfmPages(int numPages, uint8_t *p) {
-  return _readPages(ISC_READ_UFM_INCR, numPages, p);
+  return _readPages(hdrReadUfm, numPages, p);
   }
 
 bool Tpif::readUfmPages(int pageNumber, int numPages, uint8_t *p) {
+  if (pUfmCache)
+    return pUfmCache->read(pageNumber, numPages, p);
+
   bool ok = enableCfgInterfaceTransparent();
 //waitUntilNotBusy(-1);
 
-  ok = _setUfmPageAddr(pageNumber);
-  ok = readUfmPages(numPages, p);
+  ok = ok && setUfmPageAddr(pageNumber);
+  ok = ok && readUfmPages(numPages, p);
 
+  // always leave the configuration interface, whatever went wrong
   waitUntilNotBusy(-1);
-  ok = progDone();
-  ok = disableCfgInterface();
+  ok = progDone() && ok;
+  ok = disableCfgInterface() && ok;
   return ok;
   }
 
 bool Tpif::writeUfmPages(int pageNumber, int numPages, uint8_t *p) {
+  if (pUfmCache)
+    return pUfmCache->write(pageNumber, numPages, p);
+
   bool ok = enableCfgInterfaceTransparent();
 //waitUntilNotBusy(-1);
 
-  ok = _setUfmPageAddr(pageNumber);
-  for (int i=0; i<numPages; i++)
-    ok = _progUfmPage(p + UFM_PAGE_SIZE*i);
+  ok = ok && setUfmPageAddr(pageNumber);
+  for (int i=0; ok && (i<numPages); i++)
+    ok = progUfmPage(p + UFM_PAGE_SIZE*i);
 
   waitUntilNotBusy(-1);
-  ok = progDone();
-  ok = disableCfgInterface();
+  ok = progDone() && ok;
+  ok = disableCfgInterface() && ok;
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+bool Tpif::enableUfmCache(int AmaxPages) {
+  if (AmaxPages < 0)
+    return false;
+  if (!pUfmCache)
+    pUfmCache = new TufmCache(*this, AmaxPages);
+  return true;
+  }
+
+bool Tpif::flushUfmCache() {
+  return pUfmCache ? pUfmCache->flush() : true;
+  }
+
+bool Tpif::disableUfmCache() {
+  bool ok = flushUfmCache();
+  delete pUfmCache;
+  pUfmCache = 0;
   return ok;
   }
 
@@ -389,9 +412,7 @@ bool Tpif::writeUfmPages(int pageNumber, int numPages, uint8_t *p) {
 bool Tpif::setUsercode(uint8_t* p) {
   assert(p);
   TllWrBuf oBuf;
-  oBuf.byte(ISC_PROGRAM_USERCODE).byte(0).byte(0).byte(0);
-  for (int i=0; i<4; i++)
-    oBuf.byte(p[i]);
+  oBuf.bytes(hdrProgUser, XO2_HDR_LEN).bytes(p, 4);
 
   bool ok = _cfgWrite(oBuf);
   // sleep for 200us
@@ -401,9 +422,28 @@ bool Tpif::setUsercode(uint8_t* p) {
 
 bool Tpif::getUsercode(uint8_t* p) {
   assert(p);
-  TllWrBuf oBuf;
-  oBuf.byte(READ_USERCODE).byte(0).byte(0).byte(0);
-  return _cfgWriteRead(oBuf, p, 4);
+  return _cfgWriteRead(hdrUsercode, sizeof(hdrUsercode), p, 4);
+  }
+
+//---------------------------------------------------------------------
+bool Tpif::setSpiDivider(int Adivider) {
+  return pLo->setSpiDivider(Adivider);
+  }
+
+int Tpif::spiDivider() {
+  return pLo->spiDivider();
+  }
+
+bool Tpif::setI2cRate(uint32_t Ahz) {
+  return pLo->setI2cRate(Ahz);
+  }
+
+uint32_t Tpif::i2cRate() {
+  return pLo->i2cRate();
+  }
+
+int Tpif::lastI2cResult() {
+  return pLo->lastReturnCode();
   }
 
 //---------------------------------------------------------------------
@@ -411,11 +451,9 @@ bool Tpif::getBusyFlag(int *pFlag) {
   *pFlag = 1;
   const int numBytesToRead = 1;
 
-  TllWrBuf oBuf;
-  oBuf.byte(CHECK_BUSY_FLAG).byte(0).byte(0).byte(0);
-
   uint8_t flag = 0;
-  bool ok = _cfgWriteRead(oBuf, &flag, numBytesToRead);
+  bool ok = _cfgWriteRead(hdrBusyFlag, sizeof(hdrBusyFlag),
+                                                  &flag, numBytesToRead);
   if (ok)
     *pFlag = (flag >> 7) & 1;
 
@@ -456,21 +494,351 @@ bool Tpif::appRead(uint8_t *p, int AnumBytes) {
   }
 
 //---------------------------------------------------------------------
+// the shadow follows the tagged bytes, the last data byte for a
+// register is its value. A data byte before any address byte has no
+// register we know of. After an X byte the rest is untagged data that
+// the copy cannot hold, so the register is dropped from it.
 bool Tpif::appWrite(uint8_t *p, int AnumBytes) {
   if (AnumBytes <= 0)
     return true;
 
   assert(p != 0);
 
-  return pLo->i2cWrite(I2C_APP_ADDR, p, AnumBytes);
+  if (!pLo->i2cWrite(I2C_APP_ADDR, p, AnumBytes))
+    return false;
+  int reg = -1;
+  for (int i=0; i<AnumBytes; i++) {
+    switch (p[i] & ~APP_DATA_MASK) {
+      case A_ADDR:
+        reg = p[i] & APP_DATA_MASK;
+        break;
+      case D_ADDR:
+        if (reg >= 0)
+          pShadow->written(reg, p[i]);
+        break;
+      case X_ADDR:
+        if (i+1 < AnumBytes)
+          pShadow->invalidate(p[i] & APP_DATA_MASK);
+        i = AnumBytes;
+        break;
+      }
+    }
+  return true;
+  }
+
+//---------------------------------------------------------------------
+bool Tpif::regWrite(int Areg, const uint8_t *pValues, int AnumValues) {
+  if ((AnumValues < 0) || (AnumValues > APP_BURST_MAX))
+    return false;
+
+  TllFrame<1 + APP_BURST_MAX> oBuf;
+  oBuf.clear().byte(A_ADDR | (Areg & APP_DATA_MASK));
+  for (int i=0; i<AnumValues; i++)
+    oBuf.byte(D_ADDR | (pValues[i] & APP_DATA_MASK));
+  if (!pLo->i2cWrite(I2C_APP_ADDR, oBuf.data(), oBuf.length()))
+    return false;
+  if (AnumValues)
+    pShadow->written(Areg & APP_DATA_MASK, pValues[AnumValues-1]);
+  return true;
+  }
+
+//---------------------------------------------------------------------
+bool Tpif::regRead(int Areg, uint8_t *pValues, int AnumValues) {
+  if ((AnumValues < 0) || (AnumValues > APP_BURST_MAX))
+    return false;
+
+  uint8_t sel = A_ADDR | (Areg & APP_DATA_MASK);
+  if (AnumValues == 0)
+    return pLo->i2cWrite(I2C_APP_ADDR, &sel, 1);
+  return pLo->i2cWriteRead(I2C_APP_ADDR, &sel, pValues, AnumValues);
+  }
+
+//---------------------------------------------------------------------
+int Tpif::appCaps(bool Arefresh) {
+  uint8_t id[APP_ID_CAPS2 + 1];
+
+  if ((FappCaps >= 0) && !Arefresh)
+    return FappCaps;
+  if (!regRead(0, id, sizeof(id)))
+    return -1;
+  FappCaps = 0;
+  if ((id[APP_ID_CAPS] & 0xf0) == APP_CAPS_MARK) {
+    FappCaps = id[APP_ID_CAPS] & 0x0f;
+    if ((id[APP_ID_CAPS2] & 0xf0) == APP_CAPS_MARK)
+      FappCaps |= (id[APP_ID_CAPS2] & 0x0f) << 4;
+    }
+  return FappCaps;
+  }
+
+//---------------------------------------------------------------------
+bool Tpif::xRegWrite(int Areg, const uint8_t *p, int AnumBytes) {
+  if ((AnumBytes < 0) || (AnumBytes > APP_BURST_MAX))
+    return false;
+  if ((appCaps() <= 0) || !(FappCaps & APP_CAP_XADDR))
+    return false;
+
+  TllFrame<1 + APP_BURST_MAX> oBuf;
+  oBuf.clear().byte(X_ADDR | (Areg & APP_DATA_MASK)).bytes(p, AnumBytes);
+  if (!pLo->i2cWrite(I2C_APP_ADDR, oBuf.data(), oBuf.length()))
+    return false;
+  if (AnumBytes)                        // 8-bit data, no 6-bit value
+    pShadow->invalidate(Areg & APP_DATA_MASK);
+  return true;
+  }
+
+//---------------------------------------------------------------------
+bool Tpif::xRegRead(int Areg, uint8_t *p, int AnumBytes) {
+  if ((AnumBytes < 0) || (AnumBytes > APP_BURST_MAX))
+    return false;
+  if ((appCaps() <= 0) || !(FappCaps & APP_CAP_XADDR))
+    return false;
+
+  uint8_t sel = X_ADDR | (Areg & APP_DATA_MASK);
+  if (AnumBytes == 0)
+    return pLo->i2cWrite(I2C_APP_ADDR, &sel, 1);
+  return pLo->i2cWriteRead(I2C_APP_ADDR, &sel, p, AnumBytes);
+  }
+
+//---------------------------------------------------------------------
+bool Tpif::appPerfRead(uint32_t *pCounters) {
+  uint8_t buf[APP_PERF_COUNTERS * APP_PERF_BYTES];
+
+  if ((appCaps() <= 0) || !(FappCaps & APP_CAP_PERF))
+    return false;
+  if (!regRead(APP_PERF_REG, buf, sizeof(buf)))
+    return false;
+  for (int i=0; i<APP_PERF_COUNTERS; i++) {
+    const uint8_t *p = buf + i * APP_PERF_BYTES;
+    pCounters[i] = p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16);
+    }
+  return true;
+  }
+
+bool Tpif::appPerfClear() {
+  uint8_t clear = 0x01;
+
+  if ((appCaps() <= 0) || !(FappCaps & APP_CAP_PERF))
+    return false;
+  return regWrite(APP_PERF_REG, &clear, 1);
+  }
+
+//---------------------------------------------------------------------
+bool Tpif::appAttnOpen(int Agpio) {
+  if ((appCaps() <= 0) || !(FappCaps & APP_CAP_ATTN))
+    return false;
+  return pLo->attnOpen(Agpio);
+  }
+
+void Tpif::appAttnClose() {
+  pLo->attnClose();
+  }
+
+// sub-address 0 sets flags, so the mask goes second
+bool Tpif::appAttnEnable(uint8_t Amask) {
+  uint8_t v[2] = { 0, (uint8_t)(Amask & APP_ATTN_ALL) };
+
+  if ((appCaps() <= 0) || !(FappCaps & APP_CAP_ATTN))
+    return false;
+  return regWrite(APP_ATTN_REG, v, 2);
+  }
+
+bool Tpif::appAttnRaise(uint8_t Aflags) {
+  if ((appCaps() <= 0) || !(FappCaps & APP_CAP_ATTN))
+    return false;
+  return regWrite(APP_ATTN_REG, &Aflags, 1);
+  }
+
+//---------------------------------------------------------------------
+bool Tpif::appAttnRead(TappAttn *p) {
+  uint8_t b[APP_ATTN_BYTES];
+
+  if ((appCaps() <= 0) || !(FappCaps & APP_CAP_ATTN))
+    return false;
+  if (!regRead(APP_ATTN_REG, b, sizeof(b)))
+    return false;
+  p->flags        = b[0] & APP_ATTN_ALL;
+  p->mask         = b[1] & APP_ATTN_ALL;
+  p->fifoLevel    = b[2] | ((b[3] & 0x07) << 8);
+  p->fifoOverflow = (b[3] & 0x80) != 0;
+  p->streamCount  = b[4] | (b[5] << 8);
+  p->timestampNs  = 0;
+  p->edges        = 0;
+  return true;
+  }
+
+//---------------------------------------------------------------------
+// a line already high has no edge coming, read straight away
+int Tpif::appAttnWait(TappAttn *p, int AtimeoutMs) {
+  uint64_t first = 0, t;
+  int edges = 0;
+
+  int level = pLo->attnLevel();
+  if (level < 0)
+    return -1;
+  if (level == 0) {
+    int res = pLo->attnWait(AtimeoutMs, &first);
+    if (res <= 0)
+      return res;
+    edges = 1;
+    }
+  while (pLo->attnWait(0, &t) > 0) {
+    if (edges++ == 0)
+      first = t;
+    }
+
+  if (!appAttnRead(p))
+    return -1;
+  p->timestampNs = first;
+  p->edges       = edges;
+  return 1;
+  }
+
+//---------------------------------------------------------------------
+int Tpif::appReadFifo(uint8_t *p, int AmaxBytes, bool *pOverflow) {
+  uint8_t buf[APP_FIFO_HDR + APP_FIFO_DEPTH];
+  uint8_t sel = A_ADDR | APP_FIFO_REG;
+  int got = 0;
+
+  if (AmaxBytes < 0)
+    return -1;
+  if (pOverflow)
+    *pOverflow = false;
+  for (;;) {
+    int want = AmaxBytes - got;
+    if (want > APP_FIFO_DEPTH)
+      want = APP_FIFO_DEPTH;
+    if (!pLo->i2cWriteRead(I2C_APP_ADDR, &sel, buf, APP_FIFO_HDR + want))
+      return -1;
+    int level = buf[0] | ((buf[1] & 0x07) << 8);
+    int n     = (level < want) ? level : want;
+    if (pOverflow && (buf[1] & 0x80))
+      *pOverflow = true;
+    memcpy(p + got, buf + APP_FIFO_HDR, n);
+    got += n;
+    if ((level <= want) || (got == AmaxBytes))
+      return got;
+    }
+  }
+
+//---------------------------------------------------------------------
+bool Tpif::appStreamWrite(int Areg, const uint8_t *p, int AnumBytes) {
+  uint8_t buf[1 + APP_BURST_MAX];
+  bool ok = (AnumBytes >= 0);
+
+  if (ok && (appCaps() > 0) && (FappCaps & APP_CAP_XADDR)) {
+    for (int i=0; ok && (i<AnumBytes); i+=APP_BURST_MAX) {
+      int n = AnumBytes - i;
+      if (n > APP_BURST_MAX)
+        n = APP_BURST_MAX;
+      ok = xRegWrite(Areg, p + i, n);
+      }
+    // stream bytes are no register value
+    pShadow->invalidate(Areg & APP_DATA_MASK);
+    return ok;
+    }
+
+  buf[0] = A_ADDR | (Areg & APP_DATA_MASK);
+  for (int i=0; ok && (i<AnumBytes); i+=APP_STREAM_CHUNK) {
+    int n = AnumBytes - i;
+    if (n > APP_STREAM_CHUNK)
+      n = APP_STREAM_CHUNK;
+    size_t len = 1 + app6Encode(p + i, n, buf + 1);
+    ok = pLo->i2cWrite(I2C_APP_ADDR, buf, len);
+    }
+  pShadow->invalidate(Areg & APP_DATA_MASK);
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+// the sub-address runs on across the chunks, the symbols of one chunk
+// fill a burst
+bool Tpif::appStreamRead(int Areg, uint8_t *p, int AnumBytes) {
+  if (AnumBytes < 0)
+    return false;
+  if ((appCaps() <= 0) || !(FappCaps & APP_CAP_LOOP))
+    return false;
+
+  uint8_t buf[APP_BURST_MAX];
+  uint8_t sel = A_ADDR | (Areg & APP_DATA_MASK);
+  bool ok = true;
+  if (AnumBytes == 0)
+    ok = pLo->i2cWrite(I2C_APP_ADDR, &sel, 1);
+
+  for (int i=0; ok && (i<AnumBytes); i+=APP_STREAM_CHUNK) {
+    int n = AnumBytes - i;
+    if (n > APP_STREAM_CHUNK)
+      n = APP_STREAM_CHUNK;
+    size_t syms = app6Symbols(n);
+    if (i == 0)
+      ok = pLo->i2cWriteRead(I2C_APP_ADDR, &sel, buf, syms);
+    else
+      ok = pLo->i2cRead(I2C_APP_ADDR, buf, syms);
+    if (ok)
+      app6Decode(buf, syms, p + i);
+    }
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+bool Tpif::appSpiTransfer(const uint8_t *pWr, uint8_t *pRd, int Alen) {
+  if (Alen <= 0)
+    return (Alen == 0);
+
+  TspiSeg seg;
+  seg.pWr = pWr;  seg.pRd = pRd;  seg.len = Alen;
+  return pLo->spiTransferSegs(RW_APP, &seg, 1);
+  }
+
+//---------------------------------------------------------------------
+bool Tpif::appSpiWrite(int Areg, const uint8_t *p, int AnumBytes) {
+  if (AnumBytes < 0)
+    return false;
+
+  uint8_t cmd = APP_SPI_WRITE | (Areg & APP_DATA_MASK);
+  TspiSeg segs[2];
+  segs[0].pWr = &cmd;  segs[0].pRd = 0;  segs[0].len = 1;
+  segs[1].pWr = p;     segs[1].pRd = 0;  segs[1].len = AnumBytes;
+  if (!pLo->spiTransferSegs(RW_APP, segs, 2))
+    return false;
+  if (AnumBytes)                        // 8-bit data, no 6-bit value
+    pShadow->invalidate(Areg & APP_DATA_MASK);
+  return true;
+  }
+
+//---------------------------------------------------------------------
+// the turnaround is the zero the firmware loaded while the command
+// came in, the register's first byte only goes into SPITXDR after it
+bool Tpif::appSpiRead(int Areg, uint8_t *p, int AnumBytes) {
+  if (AnumBytes < 0)
+    return false;
+
+  uint8_t cmd[1 + APP_SPI_TURNAROUND] = { (uint8_t)(Areg & APP_DATA_MASK) };
+  TspiSeg segs[2];
+  segs[0].pWr = cmd;  segs[0].pRd = 0;  segs[0].len = sizeof(cmd);
+  segs[1].pWr = 0;    segs[1].pRd = p;  segs[1].len = AnumBytes;
+  return pLo->spiTransferSegs(RW_APP, segs, 2);
   }
 
 //---------------------------------------------------------------------
 Tpif::Tpif() {
-  pLo = new TlowLevel;
+  pLo       = new TlowLevel;
+  pUfmCache = 0;
+  pShadow   = new TappShadow(*this);
+  FappCaps  = -1;
+  }
+
+// takes ownership of the transport, e.g. a simulated one
+Tpif::Tpif(TlowLevel *pLowLevel) {
+  assert(pLowLevel);
+  pLo       = pLowLevel;
+  pUfmCache = 0;
+  pShadow   = new TappShadow(*this);
+  FappCaps  = -1;
   }
 
 Tpif::~Tpif() {
+  disableUfmCache();
+  delete pShadow;
   delete pLo;
   }
 
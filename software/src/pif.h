@@ -12,8 +12,9 @@
 
 #define CFG_PAGE_SIZE           16
 #define UFM_PAGE_SIZE           16
-#define CFG_PAGE_COUNT          2175
+#define CFG_PAGE_COUNT          2175      /* XO2-1200, see xo2FindDevice() */
 #define UFM_PAGE_COUNT          512
+#define READ_BURST_PAGES        128       /* pages per read command */
 
 #define FEATURE_ERASE           (1<<1)
 #define CFG_ERASE               (1<<2)
@@ -23,27 +24,91 @@
 
 #define A_ADDR                  (0<<6)     /* sending an address */
 #define D_ADDR                  (1<<6)     /* sending data       */
+#define APP_DATA_MASK           0x3f       /* six bit payload    */
+#define APP_BURST_MAX           128        /* sub-addresses, pifdefs.vhd */
+#define APP_STREAM_CHUNK        96         /* bytes per transaction, 128 symbols */
+#define APP_SPI_WRITE           0x80       /* SPI command bit, pifdefs.vhd */
+#define APP_SPI_TURNAROUND      1          /* the zero held during the command */
+#define APP_FIFO_REG            4          /* R_FIFO, pifdefs.vhd */
+#define APP_FIFO_DEPTH          1024
+#define APP_FIFO_HDR            2          /* level bytes ahead of the data */
+#define X_ADDR                  (3<<6)     /* address, 8-bit data follows */
+#define APP_NUM_XREGS           64         /* reachable by X bytes */
+#define APP_ID_CAPS             3          /* R_ID sub-address */
+#define APP_CAPS_MARK           0xa0       /* bits 7..4, older builds give 'c' */
+#define APP_CAP_XADDR           0x01
+#define APP_CAP_FIFO            0x02
+#define APP_CAP_SPI             0x04
+#define APP_CAP_PERF            0x08
+#define APP_ID_CAPS2            4          /* second byte, bits 3..0 -> 7..4 */
+#define APP_CAP_ATTN            0x10
+#define APP_CAP_LOOP            0x20
+
+/* firmware performance counters, R_PERF in pifdefs.vhd */
+#define APP_PERF_REG            5
+#define APP_PERF_COUNTERS       8
+#define APP_PERF_BYTES          3          /* per counter, LSB first */
+#define APP_PERF_MASK           0xffffff
+#define APP_PERF_RX             0          /* I2C bytes received */
+#define APP_PERF_TX             1          /* I2C bytes sent */
+#define APP_PERF_ADDR           2          /* A and X bytes */
+#define APP_PERF_DATA           3          /* D bytes and X data bytes */
+#define APP_PERF_NAK            4          /* reads ended by the master */
+#define APP_PERF_WB             5          /* Wishbone cycles for I2C */
+#define APP_PERF_RESTART        6          /* state machine restarts */
+#define APP_PERF_SVC            7          /* FPGA clocks spent on I2C bytes */
+#define APP_STREAM_REG          3          /* W_STREAM_REG, pifdefs.vhd */
+#define APP_LOOP_REG            7          /* R_STREAM_LOOP, packed read */
+#define APP_LOOP_BYTES          96         /* one chunk, 128 symbols */
+
+/* attention flags and batch status, R_ATTN in pifdefs.vhd */
+#define APP_ATTN_REG            6
+#define APP_ATTN_BYTES          6          /* flags, mask, FIFO 2, stream 2 */
+#define APP_ATTN_FIFO           0x01       /* a byte went into the FIFO */
+#define APP_ATTN_FIFO_OVF       0x02       /* the FIFO overflowed */
+#define APP_ATTN_STREAM         0x04       /* a stream byte arrived */
+#define APP_ATTN_ALL            0x3f
+
+struct TappAttn {
+  uint8_t   flags;                      // APP_ATTN_xxx since the last read
+  uint8_t   mask;                       // the enabled ones
+  int       fifoLevel;                  // FIFO bytes at the read
+  bool      fifoOverflow;
+  uint16_t  streamCount;                // stream bytes received, wraps
+  uint64_t  timestampNs;                // the first edge, 0 if none
+  int       edges;                      // edges the read accounts for
+  };
+
+// counter difference across a wrap
+inline uint32_t appPerfDelta(uint32_t Anow, uint32_t Athen) {
+  return (Anow - Athen) & APP_PERF_MASK;
+  }
 
 class TlowLevel;
+class TufmCache;
+class TappShadow;
 
 //---------------------------------------------------------------------
 class Tpif {
   private:
     TlowLevel *pLo;
+    TufmCache *pUfmCache;               // NULL unless enableUfmCache()
+    TappShadow *pShadow;                // see appshadow.h
+    int        FappCaps;                // -1 until read
 
     uint32_t _dwordBE(uint8_t *p);
-    bool _cfgWrite(TllWrBuf& oBuf);
-    bool _cfgWriteRead(TllWrBuf& oBuf, uint8_t *pRdData, size_t ArdLen);
+    bool _cfgWrite(const uint8_t *pWrData, size_t AwrLen);
+    bool _cfgWriteRead(const uint8_t *pWrData, size_t AwrLen,
+                                            uint8_t *pRdData, size_t ArdLen);
+    bool _cfgWrite(TllWrBuf& oBuf) {
+      return _cfgWrite(oBuf.data(), oBuf.length());
+      }
 
     bool _doSimple(int Acmd, int Ap0=0);
+    bool _setPageAddr(int Asector, int pageNumber);
 
-    bool _progPage(int Acmd, const uint8_t *p);
-    bool _readPages(int Acmd, int numPages, uint8_t *p);
-    bool _readPage(int Acmd, uint8_t *p);
-
-    bool _initUfmAddr();
-    bool _setUfmPageAddr(int pageNumber);
-    bool _progUfmPage(const uint8_t *p);
+    bool _progPage(const uint8_t *pHdr, const uint8_t *p);
+    bool _readPages(const uint8_t *pHdr, int numPages, uint8_t *p);
 
     bool _isBusy();
 
@@ -65,15 +130,33 @@ class Tpif {
     bool eraseAll();
 
     bool initCfgAddr();
+    bool setCfgPageAddr(int pageNumber);
     bool eraseCfg();
     bool progCfgPage(const uint8_t *p);
+    bool progCfgFrames(const uint8_t *pFrames, int numFrames); // pre-framed
     bool readCfgPages(int numPages, uint8_t *p);
 
     bool eraseUfm();
+    bool initUfmAddr();
+    bool setUfmPageAddr(int pageNumber);
+    bool progUfmPage(const uint8_t *p);
     bool readUfmPages(int numPages, uint8_t *p);
     bool readUfmPages(int pageNumber, int numPages, uint8_t *p);
     bool writeUfmPages(int pageNumber, int numPages, uint8_t *p);
 
+    // once enabled, readUfmPages()/writeUfmPages() with a page number go
+    // through a write-back cache. AmaxPages 0 caches the whole UFM.
+    bool enableUfmCache(int AmaxPages=0);
+    bool flushUfmCache();
+    bool disableUfmCache();             // flushes first
+    TufmCache *ufmCache() { return pUfmCache; }
+
+    bool setSpiDivider(int Adivider);   // see TlowLevel, spitune.h
+    int  spiDivider();
+    bool setI2cRate(uint32_t Ahz);      // see i2ctune.h
+    uint32_t i2cRate();
+    int  lastI2cResult();               // BCM2835_I2C_REASON_xxx
+
     bool getBusyFlag(int *pFlag);
     bool waitUntilNotBusy(int maxLoops=DEFAULT_BUSY_LOOPS);
 
@@ -87,7 +170,83 @@ class Tpif {
     bool appRead(uint8_t *p, int AnumBytes);
     bool appWrite(uint8_t *p, int AnumBytes);
 
+    // tagged register access, one I2C transaction for the address and
+    // all the data. Values are masked to six bits, successive values go
+    // to successive write sub-addresses. A read sends the address byte
+    // and, after a repeated start, reads sub-addresses 0..AnumValues-1.
+    bool regWrite(int Areg, const uint8_t *pValues, int AnumValues);
+    bool regRead(int Areg, uint8_t *pValues, int AnumValues);
+
+    // what the firmware offers, APP_CAP_xxx bits, 0 for builds from
+    // before the capabilities byte, -1 on a bus error. Read once and
+    // kept unless Arefresh, e.g. after reconfiguring the FPGA.
+    int  appCaps(bool Arefresh=false);
+
+    // extended register access, registers 0..63 and 8-bit data. A write
+    // is the X byte then the data, a read the X byte and a repeated
+    // start. Both fail without calling the firmware if appCaps() has no
+    // APP_CAP_XADDR, older builds do not ignore the data bytes.
+    bool xRegWrite(int Areg, const uint8_t *p, int AnumBytes);
+    bool xRegRead(int Areg, uint8_t *p, int AnumBytes);
+
+    // the firmware counters, snapshotted when the register is selected
+    // and read in the same transaction. APP_PERF_COUNTERS values, APP_PERF_xxx
+    // order; they wrap at 24 bits, see appPerfDelta(). Both fail
+    // without APP_CAP_PERF.
+    bool appPerfRead(uint32_t *pCounters);
+    bool appPerfClear();
+
+    // event notification. The firmware raises its attention output
+    // while an enabled flag is set, the host sleeps on the GPIO's
+    // edges and then collects every flag and the FIFO and stream
+    // counts in one transaction, which also clears the flags. Open
+    // fails without APP_CAP_ATTN. A wait returns 1 with the status, 0
+    // after AtimeoutMs (-1 waits for ever), -1 on an error; edges that
+    // came before the read are folded into it, so flags can be 0 when
+    // an earlier read already took the event. appAttnRead() is the
+    // same read without waiting, for polling.
+    bool appAttnOpen(int Agpio=LL_ATTN_GPIO);
+    void appAttnClose();
+    bool appAttnEnable(uint8_t Amask);
+    bool appAttnRaise(uint8_t Aflags);  // as if the events had happened
+    bool appAttnRead(TappAttn *p);
+    int  appAttnWait(TappAttn *p, int AtimeoutMs);
+
+    // FPGA to host bytes from the FIFO register. Each I2C transaction
+    // asks for what is still wanted, up to APP_FIFO_DEPTH; the header
+    // says how much of it the FIFO held. One transaction drains it
+    // unless it holds more than AmaxBytes or more than the depth.
+    // Returns the bytes read, -1 on a bus error.
+    int  appReadFifo(uint8_t *p, int AmaxBytes, bool *pOverflow=0);
+
+    // the host copy of the registers, for write-combining and for
+    // reading back the write-only ones
+    TappShadow *shadow() { return pShadow; }
+
+    // 8-bit data packed 3 bytes to 4 symbols, see appcodec.h. A write
+    // is one transaction per APP_STREAM_CHUNK bytes, each starting with
+    // the address byte; if the firmware has X bytes they carry the data
+    // unpacked instead, APP_BURST_MAX bytes a transaction. A read is
+    // from a register that sends symbols back, APP_LOOP_REG in this
+    // design, which returns the first APP_LOOP_BYTES of the last
+    // stream write over and over. It selects Areg in front of the first
+    // chunk and fails without APP_CAP_LOOP.
+    bool appStreamWrite(int Areg, const uint8_t *p, int AnumBytes);
+    bool appStreamRead(int Areg, uint8_t *p, int AnumBytes);
+
+    // the app port on SPI CE1, full 8-bit data. A raw transfer is one
+    // chip-select with pWr clocked out (zeros if NULL) and MISO into pRd
+    // (if not NULL). A write is the command byte then the data; a read
+    // skips the turnaround byte and returns sub-addresses from 0 on.
+    // Only the bytes clocked out count as read, so a read of the FIFO
+    // pops exactly AnumBytes and the byte the firmware still holds at
+    // the end is not lost.
+    bool appSpiTransfer(const uint8_t *pWr, uint8_t *pRd, int Alen);
+    bool appSpiWrite(int Areg, const uint8_t *p, int AnumBytes);
+    bool appSpiRead(int Areg, uint8_t *p, int AnumBytes);
+
     Tpif();
+    Tpif(TlowLevel *pLowLevel);
     ~Tpif();
   };
 
@@ -0,0 +1,756 @@
+//---------------------------------------------------------------------
+// pifbench.cpp
+//
+// micro-benchmarks for the host-side hot paths of the library
+// no pif board is needed, bus traffic goes to a simulated XO2
+//
+//   pifbench [-t msecs] [name_filter ...]  > results.json
+//
+// results are written to stdout as JSON, progress to stderr
+
+using namespace std;
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include "pif.h"
+#include "pifwrap.h"
+#include "pifsim.h"
+#include "jedec.h"
+#include "pifprog.h"
+#include "ufm.h"
+#include "ufmkv.h"
+#include "ufmhash.h"
+#include "appcodec.h"
+#include "appshadow.h"
+#include "xo2.h"
+#include "benchutil.h"
+
+#define BENCH_REPEATS           5
+#define BENCH_DEFAULT_MS        100
+#define XO2_1200_ID_CODE        0x012ba043
+
+static volatile uint32_t sink;            // defeats dead code elimination
+
+//---------------------------------------------------------------------
+// a transport that goes nowhere, isolates the library's own overhead
+class TnullLowLevel : public TlowLevel {
+  protected:
+    virtual void _hwSpiWrite(const uint8_t *pWrData, size_t AwrLen) {}
+    virtual void _hwSpiTransfer(uint8_t *pData, size_t Alen) { sink += pData[0]; }
+    virtual void _hwSpiSegs(const TspiSeg *pSegs, int AnumSegs) {
+      sink += pSegs[AnumSegs-1].len;
+      }
+    virtual void _hwSleep(long ns) {}
+  public:
+    TnullLowLevel() : TlowLevel(false) {}
+  };
+
+//---------------------------------------------------------------------
+class Tbench {
+  public:
+    const char *Fname;
+    TsimLowLevel *pSim;                   // set if bus traffic is counted
+    long        Fpayload;                 // app bytes moved per op, if any
+    long        Ferrors;                  // failed checks, fail the run
+
+    virtual void run(long n) = 0;
+
+    Tbench(const char *Aname) : Fname(Aname), pSim(0), Fpayload(0), Ferrors(0) {}
+    virtual ~Tbench() {}
+  };
+
+//---------------------------------------------------------------------
+// holds a simulated board for the Tpif benchmarks
+class TpifBench : public Tbench {
+  protected:
+    TsimXO2  Fdev;
+    Tpif    *pPif;
+
+  public:
+    TpifBench(const char *Aname)
+          : Tbench(Aname), Fdev(XO2_1200_ID_CODE, CFG_PAGE_COUNT, UFM_PAGE_COUNT) {
+      pSim = new TsimLowLevel(&Fdev);
+      pPif = new Tpif(pSim);
+      }
+    virtual ~TpifBench() { delete pPif; }
+  };
+
+//=====================================================================
+class TbJedecRow : public Tbench {
+    char Fline[JEDEC_ROW_SIZE*8 + 2];
+  public:
+    void run(long n) {
+      uint8_t p[JEDEC_ROW_SIZE];
+      for (long i=0; i<n; i++) {
+        jedecDecodeRow(Fline, p);
+        sink += p[i & (JEDEC_ROW_SIZE-1)];
+        }
+      }
+    TbJedecRow() : Tbench("jedec_decode_row") {
+      for (int i=0; i<JEDEC_ROW_SIZE*8; i++)
+        Fline[i] = ((i * 7) % 3) ? '1' : '0';
+      strcpy(Fline + JEDEC_ROW_SIZE*8, "\n");
+      }
+  };
+
+//---------------------------------------------------------------------
+class TbWrBufFrame : public Tbench {
+    uint8_t Fpage[CFG_PAGE_SIZE];
+  public:
+    void run(long n) {
+      for (long i=0; i<n; i++) {
+        static const uint8_t hdr[4] = { 0x70, 0, 0, 1 };
+        TllFrame<4 + CFG_PAGE_SIZE> oBuf;
+        oBuf.bytes(hdr, sizeof(hdr)).bytes(Fpage, CFG_PAGE_SIZE);
+        sink += oBuf.data()[oBuf.length()-1];
+        }
+      }
+    TbWrBufFrame() : Tbench("wrbuf_prog_frame") {
+      for (int i=0; i<CFG_PAGE_SIZE; i++)
+        Fpage[i] = (uint8_t)(i * 37);
+      }
+  };
+
+//---------------------------------------------------------------------
+class TbSpiWriteRead : public Tbench {
+    TnullLowLevel Flo;
+    int           FrdLen;
+  public:
+    void run(long n) {
+      static const uint8_t hdr[4] = { 0x3c, 0, 0, 0 };
+      uint8_t rd[16];
+      for (long i=0; i<n; i++) {
+        Flo.spiWriteRead(RW_CONFIG, hdr, sizeof(hdr), rd, FrdLen);
+        sink += rd[0];
+        }
+      }
+    TbSpiWriteRead(const char *Aname, int ArdLen)
+          : Tbench(Aname), FrdLen(ArdLen) {}
+  };
+
+//---------------------------------------------------------------------
+class TbStatusDecode : public Tbench {
+  public:
+    void run(long n) {
+      Txo2Status st;
+      for (long i=0; i<n; i++) {
+        xo2DecodeStatus((uint32_t)i * 0x9e3779b9u, st);
+        sink += st.done + st.busy + st.errCode;
+        }
+      }
+    TbStatusDecode() : Tbench("status_decode") {}
+  };
+
+//---------------------------------------------------------------------
+class TbPageCompare : public Tbench {
+    vector<uint8_t> Fa, Fb;
+  public:
+    void run(long n) {
+      for (long i=0; i<n; i++)
+        sink += xo2ComparePages(&Fa[0], &Fb[0], CFG_PAGE_COUNT, CFG_PAGE_SIZE);
+      }
+    TbPageCompare() : Tbench("page_compare_image"),
+                      Fa(CFG_PAGE_COUNT*CFG_PAGE_SIZE),
+                      Fb(CFG_PAGE_COUNT*CFG_PAGE_SIZE) {
+      for (size_t i=0; i<Fa.size(); i++)
+        Fa[i] = Fb[i] = (uint8_t)(i ^ (i >> 7));
+      }
+  };
+
+//=====================================================================
+class TbPifIdCode : public TpifBench {
+  public:
+    void run(long n) {
+      uint32_t v;
+      for (long i=0; i<n; i++) {
+        pPif->getDeviceIdCode(v);
+        sink += v;
+        }
+      }
+    TbPifIdCode() : TpifBench("pif_get_idcode") {}
+  };
+
+//---------------------------------------------------------------------
+class TbPifStatus : public TpifBench {
+  public:
+    void run(long n) {
+      uint32_t v;
+      for (long i=0; i<n; i++) {
+        pPif->getStatusReg(v);
+        sink += v;
+        }
+      }
+    TbPifStatus() : TpifBench("pif_get_status") {}
+  };
+
+//---------------------------------------------------------------------
+class TbPifBusyPoll : public TpifBench {
+  public:
+    void run(long n) {
+      for (long i=0; i<n; i++)
+        sink += pPif->waitUntilNotBusy(1);
+      }
+    TbPifBusyPoll() : TpifBench("pif_busy_poll") {}
+  };
+
+//---------------------------------------------------------------------
+class TbPifProgPage : public TpifBench {
+    uint8_t Fpage[CFG_PAGE_SIZE];
+  public:
+    void run(long n) {
+      for (long i=0; i<n; i++) {
+        if ((i % CFG_PAGE_COUNT) == 0)
+          pPif->initCfgAddr();
+        pPif->progCfgPage(Fpage);
+        }
+      }
+    TbPifProgPage() : TpifBench("pif_prog_cfg_page") {
+      memset(Fpage, 0x5a, sizeof(Fpage));
+      pPif->enableCfgInterfaceOffline();
+      }
+  };
+
+//---------------------------------------------------------------------
+// same traffic as pif_prog_cfg_page, from a staged frame image
+class TbPifProgFrames : public TpifBench {
+    TjedecImage Fimg;
+  public:
+    void run(long n) {
+      for (long i=0; i<n; ) {
+        int pg = (int)(i % CFG_PAGE_COUNT);
+        if (pg == 0)
+          pPif->initCfgAddr();
+        long k = min((long)PROG_FRAME_BATCH, min((long)(CFG_PAGE_COUNT - pg), n - i));
+        pPif->progCfgFrames(Fimg.frames(pg), (int)k);
+        i += k;
+        }
+      }
+    TbPifProgFrames() : TpifBench("pif_prog_cfg_frames") {
+      Fimg.Fcfg.assign((size_t)CFG_PAGE_COUNT * CFG_PAGE_SIZE, 0x5a);
+      Fimg.stageFrames();
+      pPif->enableCfgInterfaceOffline();
+      }
+  };
+
+//---------------------------------------------------------------------
+class TbPifReadPage : public TpifBench {
+  public:
+    void run(long n) {
+      uint8_t p[CFG_PAGE_SIZE];
+      for (long i=0; i<n; i++) {
+        if ((i % CFG_PAGE_COUNT) == 0)
+          pPif->initCfgAddr();
+        pPif->readCfgPages(1, p);
+        sink += p[0];
+        }
+      }
+    TbPifReadPage() : TpifBench("pif_read_cfg_page") {
+      pPif->enableCfgInterfaceOffline();
+      }
+  };
+
+//---------------------------------------------------------------------
+// the full enable/address/read/done/disable sequence for one UFM page
+class TbPifUfmRead : public TpifBench {
+  public:
+    void run(long n) {
+      uint8_t p[UFM_PAGE_SIZE];
+      for (long i=0; i<n; i++) {
+        pPif->readUfmPages(i % UFM_PAGE_COUNT, 1, p);
+        sink += p[0];
+        }
+      }
+    TbPifUfmRead() : TpifBench("pif_ufm_read_page") {}
+  };
+
+//---------------------------------------------------------------------
+class TbPifUfmWrite : public TpifBench {
+  public:
+    void run(long n) {
+      uint8_t p[UFM_PAGE_SIZE];
+      memset(p, 0xa5, sizeof(p));
+      for (long i=0; i<n; i++)
+        pPif->writeUfmPages(i % UFM_PAGE_COUNT, 1, p);
+      }
+    TbPifUfmWrite() : TpifBench("pif_ufm_write_page") {}
+  };
+
+//---------------------------------------------------------------------
+// random single page reads inside one open session
+class TbUfmSessionRead : public TpifBench {
+    TufmSession *pSession;
+  public:
+    void run(long n) {
+      uint8_t p[UFM_PAGE_SIZE];
+      for (long i=0; i<n; i++) {
+        pSession->read((int)((i * 197) % UFM_PAGE_COUNT), 1, p);
+        sink += p[0];
+        }
+      }
+    TbUfmSessionRead() : TpifBench("ufm_session_read_page") {
+      pSession = new TufmSession(*pPif);
+      }
+    ~TbUfmSessionRead() { delete pSession; }
+  };
+
+//---------------------------------------------------------------------
+// pifReadUfmPages() with the cache warm, every page a hit
+class TbUfmCacheRead : public TpifBench {
+  public:
+    void run(long n) {
+      uint8_t p[UFM_PAGE_SIZE];
+      for (long i=0; i<n; i++) {
+        pPif->readUfmPages((int)((i * 197) % UFM_PAGE_COUNT), 1, p);
+        sink += p[0];
+        }
+      }
+    TbUfmCacheRead() : TpifBench("ufm_cache_read_page") {
+      uint8_t p[UFM_PAGE_COUNT * UFM_PAGE_SIZE];
+      pPif->enableUfmCache();
+      pPif->readUfmPages(0, UFM_PAGE_COUNT, p);
+      }
+  };
+
+//---------------------------------------------------------------------
+// updates to a handful of keys, compaction included as it falls due
+class TbUfmKvPut : public TpifBench {
+    TufmKV *pKv;
+  public:
+    void run(long n) {
+      static const char *keys[] = { "ip", "mask", "gw", "name", "mode", "rate" };
+      uint8_t v[12];
+      for (long i=0; i<n; i++) {
+        memset(v, (int)i, sizeof(v));
+        pKv->put(keys[i % 6], v, sizeof(v));
+        }
+      }
+    TbUfmKvPut() : TpifBench("ufm_kv_put") {
+      pKv = new TufmKV(*pPif);
+      pKv->open();
+      }
+    ~TbUfmKvPut() { delete pKv; }
+  };
+
+//---------------------------------------------------------------------
+// 4 byte keys and values, table placed straight into the model's UFM
+class TbUfmHashLookup : public TpifBench {
+    TufmHashTable *pTable;
+  public:
+    void run(long n) {
+      uint8_t key[4], val[4];
+      for (long i=0; i<n; i++) {
+        uint32_t k = (uint32_t)(i % 400) + 1;
+        key[0] = k >> 24;  key[1] = k >> 16;  key[2] = k >> 8;  key[3] = k;
+        sink += pTable->lookup(key, val);
+        }
+      }
+    TbUfmHashLookup() : TpifBench("ufm_hash_lookup") {
+      TufmHashBuilder b(4, 4);
+      for (uint32_t k=1; k<=400; k++) {
+        uint8_t key[4] = { (uint8_t)(k >> 24), (uint8_t)(k >> 16), (uint8_t)(k >> 8), (uint8_t)k };
+        b.add(key, key);
+        }
+      vector<uint8_t> pages;
+      b.build(pages, UFM_PAGE_COUNT);
+      copy(pages.begin(), pages.end(), Fdev.Fufm.begin());
+      pTable = new TufmHashTable(*pPif);
+      pTable->open(0);
+      }
+    ~TbUfmHashLookup() { delete pTable; }
+  };
+
+//---------------------------------------------------------------------
+// a register update the way pifweb.py did it, one byte per call
+class TbAppByteWrites : public TpifBench {
+  public:
+    void run(long n) {
+      for (long i=0; i<n; i++) {
+        uint8_t a = A_ADDR | 2, d = D_ADDR | (uint8_t)(i % 3);
+        pPif->appWrite(&a, 1);
+        pPif->appWrite(&d, 1);
+        }
+      }
+    TbAppByteWrites() : TpifBench("app_byte_writes") {}
+  };
+
+//---------------------------------------------------------------------
+// the same update, then a four value burst each way
+class TbRegWrite : public TpifBench {
+    int Fn;
+  public:
+    void run(long n) {
+      uint8_t v[4] = { 1, 2, 3, 4 };
+      for (long i=0; i<n; i++) {
+        v[0] = (uint8_t)(i % 3);
+        pPif->regWrite(2, v, Fn);
+        }
+      }
+    TbRegWrite(const char *Aname, int An) : TpifBench(Aname), Fn(An) {}
+  };
+
+class TbRegRead : public TpifBench {
+    int Fn;
+  public:
+    void run(long n) {
+      uint8_t v[4];
+      for (long i=0; i<n; i++) {
+        pPif->regRead(0, v, Fn);
+        sink += v[0];
+        }
+      }
+    TbRegRead(const char *Aname, int An) : TpifBench(Aname), Fn(An) {}
+  };
+
+// 16 8-bit values to the wide register, X byte then the data
+class TbXRegWrite : public TpifBench {
+  public:
+    void run(long n) {
+      uint8_t v[16];
+      for (long i=0; i<n; i++) {
+        memset(v, (int)i, sizeof(v));
+        pPif->xRegWrite(16, v, sizeof(v));
+        }
+      }
+    TbXRegWrite() : TpifBench("xreg_write_wide") { Fpayload = 16; }
+  };
+
+// the firmware counter snapshot, one transaction
+class TbPerfRead : public TpifBench {
+  public:
+    void run(long n) {
+      uint32_t c[APP_PERF_COUNTERS];
+      for (long i=0; i<n; i++) {
+        pPif->appPerfRead(c);
+        sink += c[APP_PERF_RX];
+        }
+      }
+    TbPerfRead() : TpifBench("app_perf_read") {}
+  };
+
+//---------------------------------------------------------------------
+// a control loop touching two registers eight times, then one flush
+class TbShadow : public TpifBench {
+  public:
+    void run(long n) {
+      TappShadow *sh = pPif->shadow();
+      for (long i=0; i<n; i++) {
+        for (int k=0; k<8; k++) {
+          sh->set(1, (uint8_t)(i + k));
+          sh->set(2, (uint8_t)(k % 3));
+          }
+        sh->flush();
+        }
+      }
+    TbShadow() : TpifBench("shadow_sets_flush") {}
+  };
+
+//---------------------------------------------------------------------
+// the 6-bit codec alone, 1kB each way
+class TbApp6Codec : public Tbench {
+    uint8_t Fbytes[1024], Fsyms[1366];
+    bool    Fdecode;
+  public:
+    void run(long n) {
+      for (long i=0; i<n; i++) {
+        if (Fdecode)
+          sink += app6Decode(Fsyms, sizeof(Fsyms), Fbytes);
+        else
+          sink += app6Encode(Fbytes, sizeof(Fbytes), Fsyms);
+        }
+      }
+    TbApp6Codec(const char *Aname, bool Adecode)
+          : Tbench(Aname), Fdecode(Adecode) {
+      for (int i=0; i<(int)sizeof(Fbytes); i++)
+        Fbytes[i] = (uint8_t)(i * 37);
+      app6Encode(Fbytes, sizeof(Fbytes), Fsyms);
+      }
+  };
+
+//---------------------------------------------------------------------
+// 1kB through the packed stream, modelled I2C time gives the payload
+// rate the channel sustains. The read is the loop register, which
+// repeats what the last write left in it.
+class TbAppStream : public TpifBench {
+    uint8_t Fbuf[1024];
+    bool    Fread;
+  public:
+    void run(long n) {
+      for (long i=0; i<n; i++) {
+        if (Fread)
+          pPif->appStreamRead(APP_LOOP_REG, Fbuf, sizeof(Fbuf));
+        else
+          pPif->appStreamWrite(APP_STREAM_REG, Fbuf, sizeof(Fbuf));
+        }
+      }
+    TbAppStream(const char *Aname, bool Aread)
+          : TpifBench(Aname), Fread(Aread) {
+      memset(Fbuf, 0xa5, sizeof(Fbuf));
+      Fpayload = sizeof(Fbuf);
+      }
+  };
+
+//---------------------------------------------------------------------
+// a chunk of varying bytes written and read back through the loop
+class TbAppStreamLoop : public TpifBench {
+    uint8_t Fout[APP_LOOP_BYTES];
+    uint8_t Fin[APP_LOOP_BYTES];
+  public:
+    void run(long n) {
+      for (long i=0; i<n; i++) {
+        for (int j=0; j<APP_LOOP_BYTES; j++)
+          Fout[j] = (uint8_t)(i * 7 + j * 13);
+        if (!pPif->appStreamWrite(APP_STREAM_REG, Fout, sizeof(Fout)) ||
+            !pPif->appStreamRead(APP_LOOP_REG, Fin, sizeof(Fin)) ||
+            memcmp(Fout, Fin, sizeof(Fin)))
+          Ferrors++;
+        }
+      }
+    TbAppStreamLoop() : TpifBench("app_stream_loop") {
+      Fpayload = 2 * APP_LOOP_BYTES;
+      }
+  };
+
+//---------------------------------------------------------------------
+// the same 1kB over the app SPI port, one CE1 transaction each
+class TbAppSpi : public TpifBench {
+    uint8_t Fbuf[1024];
+    bool    Fread;
+  public:
+    void run(long n) {
+      for (long i=0; i<n; i++) {
+        if (Fread)
+          pPif->appSpiRead(3, Fbuf, sizeof(Fbuf));
+        else
+          pPif->appSpiWrite(3, Fbuf, sizeof(Fbuf));
+        }
+      }
+    TbAppSpi(const char *Aname, bool Aread)
+          : TpifBench(Aname), Fread(Aread) {
+      memset(Fbuf, 0xa5, sizeof(Fbuf));
+      Fpayload = sizeof(Fbuf);
+      }
+  };
+
+//---------------------------------------------------------------------
+// the FIFO test source running, so every select finds it full and one
+// transaction drains 1kB
+class TbAppFifo : public TpifBench {
+    uint8_t Fbuf[APP_FIFO_DEPTH];
+  public:
+    void run(long n) {
+      for (long i=0; i<n; i++)
+        sink += pPif->appReadFifo(Fbuf, sizeof(Fbuf));
+      }
+    TbAppFifo() : TpifBench("app_fifo_read_1k") {
+      uint8_t run = 0x01;                 // FIFO_CTL_RUN
+      pPif->regWrite(APP_FIFO_REG, &run, 1);
+      Fpayload = sizeof(Fbuf);
+      }
+  };
+
+//---------------------------------------------------------------------
+// 64 FIFO bytes every millisecond of modelled time, collected after
+// the attention edge or by polling the status every 100us
+#define ATTN_PERIOD_NS          (1000 * 1000)
+#define ATTN_POLL_NS            (100 * 1000)
+#define ATTN_BYTES              64
+
+class TbAppAttn : public TpifBench {
+    bool    Fpoll;
+    uint8_t Fbuf[ATTN_BYTES];
+  public:
+    void run(long n) {
+      TappAttn a;
+      for (long i=0; i<n; i++) {
+        pSim->attnSchedule(Fdev.nowNs() + ATTN_PERIOD_NS, APP_ATTN_FIFO, ATTN_BYTES);
+        if (Fpoll) {
+          do
+            pSim->sleepNs(ATTN_POLL_NS);
+          while (pPif->appAttnRead(&a) && !(a.flags & APP_ATTN_FIFO));
+          }
+        else
+          pPif->appAttnWait(&a, -1);
+        int want = (a.fifoLevel < ATTN_BYTES) ? a.fifoLevel : ATTN_BYTES;
+        sink += pPif->appReadFifo(Fbuf, want);
+        }
+      }
+    TbAppAttn(const char *Aname, bool Apoll) : TpifBench(Aname), Fpoll(Apoll) {
+      pPif->appAttnEnable(APP_ATTN_FIFO);
+      if (!Fpoll)
+        pPif->appAttnOpen();
+      Fpayload = ATTN_BYTES;
+      }
+  };
+
+//---------------------------------------------------------------------
+// an event that is pending while masked, then the mask is written and
+// the flags read. The write selects the register too, the event must
+// still be there for the read.
+class TbAppAttnRearm : public TpifBench {
+  public:
+    void run(long n) {
+      TappAttn a;
+      for (long i=0; i<n; i++) {
+        pSim->app()->attnEvent(APP_ATTN_STREAM);
+        pPif->appAttnEnable(APP_ATTN_STREAM);
+        if (!pPif->appAttnRead(&a) || !(a.flags & APP_ATTN_STREAM))
+          Ferrors++;
+        pPif->appAttnEnable(0);
+        }
+      }
+    TbAppAttnRearm() : TpifBench("app_attn_rearm") {}
+  };
+
+//=====================================================================
+static bool selected(const char *name, int argc, char **argv, int first) {
+  if (first >= argc)
+    return true;
+  for (int i=first; i<argc; i++)
+    if (strstr(name, argv[i]))
+      return true;
+  return false;
+  }
+
+//---------------------------------------------------------------------
+// grow the iteration count until one run takes minNs, then time
+// BENCH_REPEATS runs of that size and keep the best and the median
+static void measure(Tbench& b, uint64_t minNs, TjsonOut& js) {
+  long n = 1;
+  for (;;) {
+    uint64_t t0 = benchWallNs();
+    b.run(n);
+    uint64_t dt = benchWallNs() - t0;
+    if (dt >= minNs / BENCH_REPEATS)
+      break;
+    n *= (dt < minNs / (BENCH_REPEATS*100)) ? 10 : 2;
+    }
+
+  uint64_t spiT0 = 0, spiB0 = 0, sleep0 = 0, i2cT0 = 0, i2cB0 = 0, now0 = 0;
+  if (b.pSim) {
+    now0   = b.pSim->device()->nowNs();
+    spiT0  = b.pSim->FspiTransactions;
+    spiB0  = b.pSim->FspiBytes;
+    sleep0 = b.pSim->FsleepNs;
+    i2cT0  = b.pSim->Fi2cTransactions;
+    i2cB0  = b.pSim->Fi2cBytes;
+    }
+
+  double   nsPerOp[BENCH_REPEATS];
+  uint64_t cpu0 = benchCpuNs();
+  for (int r=0; r<BENCH_REPEATS; r++) {
+    uint64_t t0 = benchWallNs();
+    b.run(n);
+    nsPerOp[r] = (double)(benchWallNs() - t0) / n;
+    }
+  uint64_t cpuNs = benchCpuNs() - cpu0;
+  sort(nsPerOp, nsPerOp + BENCH_REPEATS);
+
+  double ops = (double)n * BENCH_REPEATS;
+  js.object()
+      .str    ("name",            b.Fname)
+      .integer("iterations",      (uint64_t)ops)
+      .num    ("ns_per_op",       nsPerOp[BENCH_REPEATS/2])
+      .num    ("ns_per_op_min",   nsPerOp[0])
+      .num    ("ns_per_op_max",   nsPerOp[BENCH_REPEATS-1])
+      .num    ("cpu_ns_per_op",   cpuNs / ops)
+      .num    ("ops_per_sec",     1e9 / nsPerOp[BENCH_REPEATS/2]);
+  if (b.pSim) {
+    js.num("spi_transactions_per_op", (b.pSim->FspiTransactions - spiT0) / ops)
+      .num("spi_bytes_per_op",        (b.pSim->FspiBytes - spiB0) / ops)
+      .num("modeled_sleep_ns_per_op", (b.pSim->FsleepNs - sleep0) / ops)
+      .num("i2c_transactions_per_op", (b.pSim->Fi2cTransactions - i2cT0) / ops)
+      .num("i2c_bytes_per_op",        (b.pSim->Fi2cBytes - i2cB0) / ops);
+    double modelled = (b.pSim->device()->nowNs() - now0) / ops;
+    js.num("modeled_ns_per_op", modelled);
+    if (b.Fpayload)
+      js.num("modeled_payload_bytes_per_sec", b.Fpayload * 1e9 / modelled);
+    }
+  if (b.Ferrors)
+    js.integer("errors", (uint64_t)b.Ferrors);
+  js.endObject();
+
+  fprintf(stderr, "%-24s %12.1f ns/op\n", b.Fname, nsPerOp[BENCH_REPEATS/2]);
+  if (b.Ferrors)
+    fprintf(stderr, "%-24s %12ld FAILED checks\n", b.Fname, b.Ferrors);
+  }
+
+//---------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+  long ms    = BENCH_DEFAULT_MS;
+  int  first = 1;
+  if ((argc > 2) && (strcmp(argv[1], "-t") == 0)) {
+    ms    = atol(argv[2]);
+    first = 3;
+    }
+  if (ms <= 0) {
+    fprintf(stderr, "%s [-t msecs] [name_filter ...]\n", argv[0]);
+    return EXIT_FAILURE;
+    }
+
+  vector<Tbench *> benches;
+  benches.push_back(new TbJedecRow);
+  benches.push_back(new TbWrBufFrame);
+  benches.push_back(new TbSpiWriteRead("spi_write_read_status", 4));
+  benches.push_back(new TbSpiWriteRead("spi_write_read_busy",   1));
+  benches.push_back(new TbSpiWriteRead("spi_write_read_page",   CFG_PAGE_SIZE));
+  benches.push_back(new TbStatusDecode);
+  benches.push_back(new TbPageCompare);
+  benches.push_back(new TbPifIdCode);
+  benches.push_back(new TbPifStatus);
+  benches.push_back(new TbPifBusyPoll);
+  benches.push_back(new TbPifProgPage);
+  benches.push_back(new TbPifProgFrames);
+  benches.push_back(new TbPifReadPage);
+  benches.push_back(new TbPifUfmRead);
+  benches.push_back(new TbPifUfmWrite);
+  benches.push_back(new TbUfmSessionRead);
+  benches.push_back(new TbUfmCacheRead);
+  benches.push_back(new TbUfmKvPut);
+  benches.push_back(new TbUfmHashLookup);
+  benches.push_back(new TbAppByteWrites);
+  benches.push_back(new TbRegWrite("reg_write_one",   1));
+  benches.push_back(new TbRegWrite("reg_write_burst", 4));
+  benches.push_back(new TbRegRead("reg_read_one", 1));
+  benches.push_back(new TbShadow);
+  benches.push_back(new TbRegRead("reg_read_burst", 4));
+  benches.push_back(new TbXRegWrite);
+  benches.push_back(new TbPerfRead);
+  benches.push_back(new TbApp6Codec("app6_encode_1k", false));
+  benches.push_back(new TbApp6Codec("app6_decode_1k", true));
+  benches.push_back(new TbAppStream("app_stream_write_1k", false));
+  benches.push_back(new TbAppStream("app_stream_read_1k",  true));
+  benches.push_back(new TbAppStreamLoop);
+  benches.push_back(new TbAppSpi("app_spi_write_1k", false));
+  benches.push_back(new TbAppSpi("app_spi_read_1k",  true));
+  benches.push_back(new TbAppFifo);
+  benches.push_back(new TbAppAttn("app_attn_wait", false));
+  benches.push_back(new TbAppAttn("app_attn_poll", true));
+  benches.push_back(new TbAppAttnRearm);
+
+  char version[200];
+  pifVersion(version, sizeof(version));
+
+  TjsonOut js(stdout);
+  js.object()
+      .str    ("suite",   "pifbench")
+      .str    ("library", version)
+      .integer("min_time_ms", ms)
+      .integer("repeats", BENCH_REPEATS)
+      .array  ("results");
+  int rc = 0;
+  for (size_t i=0; i<benches.size(); i++) {
+    if (selected(benches[i]->Fname, argc, argv, first))
+      measure(*benches[i], (uint64_t)ms * 1000000ULL, js);
+    if (benches[i]->Ferrors)
+      rc = EXIT_FAILURE;
+    delete benches[i];
+    }
+  js.endArray().endObject();
+  return rc;
+  }
+
+// EOF ----------------------------------------------------------------
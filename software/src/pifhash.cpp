@@ -0,0 +1,126 @@
+//---------------------------------------------------------------------
+// pifhash.cpp
+//
+// builds a UFM hash table image, see ufmhash.h
+//
+//   pifhash [-s start_page] [-p max_pages] table.txt table.mem
+//
+// table.txt has one entry per line, key and value in hex, e.g.
+//   0a000001 00112233
+// all keys the same length, all values the same length, '#' starts
+// a comment. table.mem is one UFM page per line in the EFB HEX init
+// format; point the EFB UFM_INIT_FILE_NAME at it and the table goes
+// into the UFM section of the JEDEC file with the bitstream.
+
+using namespace std;
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+
+#include "ufmhash.h"
+
+//---------------------------------------------------------------------
+static bool hexField(const char *&p, vector<uint8_t>& out) {
+  out.clear();
+  while (isspace((unsigned char)*p))
+    p++;
+  while (isxdigit((unsigned char)p[0]) && isxdigit((unsigned char)p[1])) {
+    char b[3] = { p[0], p[1], 0 };
+    out.push_back((uint8_t)strtoul(b, 0, 16));
+    p += 2;
+    }
+  return !out.empty() && ((*p == 0) || isspace((unsigned char)*p));
+  }
+
+//---------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+  int startPage = 0;
+  int maxPages  = UFM_PAGE_COUNT;
+  int i;
+
+  for (i=1; (i+1<argc) && (argv[i][0] == '-'); i+=2) {
+    if (strcmp(argv[i], "-s") == 0)
+      startPage = atoi(argv[i+1]);
+    else if (strcmp(argv[i], "-p") == 0)
+      maxPages = atoi(argv[i+1]);
+    else
+      break;
+    }
+  if (i+2 != argc) {
+    fprintf(stderr, "%s [-s start_page] [-p max_pages] table.txt table.mem\n", argv[0]);
+    return EXIT_FAILURE;
+    }
+
+  FILE *in = fopen(argv[i], "r");
+  if (!in) {
+    perror(argv[i]);
+    return EXIT_FAILURE;
+    }
+
+  TufmHashBuilder *pBuilder = 0;
+  vector<uint8_t>  key, val;
+  char            *line = NULL;
+  size_t           len  = 0;
+  int              num  = 0;
+  bool             ok   = true;
+
+  while (ok && (getline(&line, &len, in) != -1)) {
+    num++;
+    char *hash = strchr(line, '#');
+    if (hash)
+      *hash = 0;
+    const char *p = line;
+    while (isspace((unsigned char)*p))
+      p++;
+    if (*p == 0)
+      continue;
+
+    ok = hexField(p, key) && hexField(p, val);
+    if (ok && !pBuilder)
+      pBuilder = new TufmHashBuilder((int)key.size(), (int)val.size());
+    if (ok && (pBuilder->slotsPerPage() < 1)) {
+      fprintf(stderr, "key and value must fit in %d bytes\n", UFM_PAGE_SIZE);
+      return EXIT_FAILURE;
+      }
+    ok = ok && ((int)key.size() == pBuilder->keyLen()) &&
+               ((int)val.size() == pBuilder->valLen());
+    ok = ok && pBuilder->add(&key[0], &val[0]);
+    if (!ok)
+      fprintf(stderr, "line %d: malformed, zero or duplicate entry\n", num);
+    }
+  free(line);
+  fclose(in);
+  if (!ok || !pBuilder)
+    return EXIT_FAILURE;
+
+  vector<uint8_t> pages;
+  if (!pBuilder->build(pages, maxPages - startPage)) {
+    fprintf(stderr, "%d entries do not fit in %d pages\n",
+                                  pBuilder->count(), maxPages - startPage);
+    return EXIT_FAILURE;
+    }
+
+  FILE *out = fopen(argv[i+1], "w");
+  if (!out) {
+    perror(argv[i+1]);
+    return EXIT_FAILURE;
+    }
+  int numPages = (int)(pages.size() / UFM_PAGE_SIZE);
+  for (int pg=0; pg<numPages; pg++) {
+    for (int b=0; b<UFM_PAGE_SIZE; b++)
+      fprintf(out, "%02X", pages[pg * UFM_PAGE_SIZE + b]);
+    fprintf(out, "\n");
+    }
+  fclose(out);
+
+  printf("%d entries, %d pages\n", pBuilder->count(), numPages);
+  printf("UFM_INIT_START_PAGE => %d, UFM_INIT_PAGES => %d\n", startPage, numPages);
+  delete pBuilder;
+  return 0;
+  }
+
+// EOF ----------------------------------------------------------------
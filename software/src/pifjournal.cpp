@@ -0,0 +1,172 @@
+// pifjournal.cpp -----------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "pifjournal.h"
+
+//---------------------------------------------------------------------
+static uint64_t fnv64(uint64_t h, const std::vector<uint8_t>& v) {
+  for (size_t i=0; i<v.size(); i++) {
+    h ^= v[i];
+    h *= 1099511628211ULL;
+    }
+  return h;
+  }
+
+uint64_t jedecImageHash(const TjedecImage& img) {
+  uint64_t h = fnv64(14695981039346656037ULL, img.Fcfg);
+  h ^= (uint64_t)img.Fcfg.size();
+  return fnv64(h, img.Fufm);
+  }
+
+//---------------------------------------------------------------------
+static void traceHex(const uint8_t *p, char *s) {
+  for (int i=0; i<8; i++)
+    sprintf(s + 2*i, "%02x", p[i]);
+  }
+
+//---------------------------------------------------------------------
+bool TprogJournal::_append(const char *rec, bool Async) {
+  if (Ffd < 0)
+    return false;
+  size_t len = strlen(rec);
+  bool ok = (write(Ffd, rec, len) == (ssize_t)len);
+  if (ok && Async)
+    ok = (fsync(Ffd) == 0);
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+bool TprogJournal::load() {
+  FILE *fd = fopen(Fpath.c_str(), "r");
+  if (!fd)
+    return false;
+
+  Fphase = JP_NONE;
+  Fpages = 0;
+  char line[80];
+  while (fgets(line, sizeof(line), fd)) {
+    switch (line[0]) {
+      case 'H': {
+        unsigned long long h;
+        char trace[17];
+        if (sscanf(line, "H %llx %16s", &h, trace) != 2)
+          break;
+        FimageHash = h;
+        for (int i=0; i<8; i++) {
+          char b[3] = { trace[2*i], trace[2*i+1], 0 };
+          FtraceId[i] = (uint8_t)strtoul(b, 0, 16);
+          }
+        Fphase = JP_STARTED;
+        break;
+        }
+      case 'E':                         // also a re-erase mid programming
+        if (Fphase != JP_NONE) {
+          Fphase = JP_ERASED;
+          Fpages = 0;
+          }
+        break;
+      case 'P':
+        if ((Fphase == JP_ERASED) || (Fphase == JP_PROGRAMMING)) {
+          Fphase = JP_PROGRAMMING;
+          Fpages = atoi(line + 1);
+          }
+        break;
+      case 'U':
+        if (Fphase != JP_NONE)
+          Fphase = JP_UFM;
+        break;
+      }
+    }
+  fclose(fd);
+  FsyncedPages = Fpages;
+  return Fphase != JP_NONE;
+  }
+
+//---------------------------------------------------------------------
+bool TprogJournal::matches(uint64_t AimageHash, const uint8_t *pTraceId) {
+  return (Fphase != JP_NONE) && (FimageHash == AimageHash) &&
+                                (memcmp(FtraceId, pTraceId, 8) == 0);
+  }
+
+//---------------------------------------------------------------------
+bool TprogJournal::start(uint64_t AimageHash, const uint8_t *pTraceId) {
+  if (Ffd >= 0)
+    close(Ffd);
+  Ffd = open(Fpath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+  FimageHash   = AimageHash;
+  memcpy(FtraceId, pTraceId, 8);
+  Fphase       = JP_STARTED;
+  Fpages       = 0;
+  FsyncedPages = 0;
+
+  char trace[17], rec[64];
+  traceHex(pTraceId, trace);
+  sprintf(rec, "H %016llx %s\n", (unsigned long long)AimageHash, trace);
+  return _append(rec, true);
+  }
+
+bool TprogJournal::reopen() {
+  if (Ffd < 0)
+    Ffd = open(Fpath.c_str(), O_WRONLY | O_APPEND);
+  return Ffd >= 0;
+  }
+
+//---------------------------------------------------------------------
+bool TprogJournal::erased() {
+  Fphase       = JP_ERASED;
+  Fpages       = 0;
+  FsyncedPages = 0;
+  return _append("E\n", true);
+  }
+
+// written every call, forced to disk every JOURNAL_SYNC_PAGES
+bool TprogJournal::programmed(int Apages) {
+  char rec[32];
+  sprintf(rec, "P %d\n", Apages);
+  Fphase = JP_PROGRAMMING;
+  Fpages = Apages;
+  bool sync = (Apages - FsyncedPages >= JOURNAL_SYNC_PAGES);
+  if (sync)
+    FsyncedPages = Apages;
+  return _append(rec, sync);
+  }
+
+bool TprogJournal::ufmStarted() {
+  Fphase = JP_UFM;
+  return _append("U\n", true);
+  }
+
+//---------------------------------------------------------------------
+bool TprogJournal::finish() {
+  if (Ffd >= 0)
+    close(Ffd);
+  Ffd    = -1;
+  Fphase = JP_NONE;
+  return (unlink(Fpath.c_str()) == 0);
+  }
+
+//---------------------------------------------------------------------
+TprogJournal::TprogJournal(const char *Apath)
+      : Fpath(Apath), Ffd(-1), FimageHash(0),
+        Fphase(JP_NONE), Fpages(0), FsyncedPages(0) {
+  memset(FtraceId, 0, sizeof(FtraceId));
+  }
+
+TprogJournal::~TprogJournal() {
+  if (Ffd >= 0)
+    close(Ffd);
+  }
+
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,67 @@
+// pifjournal.h -------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// on-disk progress journal, so an interrupted load can be resumed
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef pifjournalH
+#define pifjournalH
+
+#include <stdint.h>
+#include <string>
+
+#include "jedec.h"
+
+#define JOURNAL_SYNC_PAGES      512       /* pages between fsync()s */
+
+// FNV-1a over the config and UFM data
+uint64_t jedecImageHash(const TjedecImage& img);
+
+//---------------------------------------------------------------------
+// an append-only text file, one record per line
+//   H <image hash> <TraceID>   started, written once
+//   E                          erase finished
+//   P <pages>                  config pages confirmed programmed
+//   U                          UFM programming started
+// The file is removed by finish() once the load is complete. Page
+// records are only forced to disk every JOURNAL_SYNC_PAGES, a resume
+// then redoes at most that many pages.
+class TprogJournal {
+  public:
+    enum { JP_NONE, JP_STARTED, JP_ERASED, JP_PROGRAMMING, JP_UFM };
+
+  private:
+    std::string Fpath;
+    int         Ffd;
+    uint64_t    FimageHash;
+    uint8_t     FtraceId[8];
+    int         Fphase;
+    int         Fpages;
+    int         FsyncedPages;
+
+    bool _append(const char *rec, bool Async);
+
+  public:
+    bool load();                        // false if there is no journal
+
+    // true if the journal belongs to this image and this board
+    bool matches(uint64_t AimageHash, const uint8_t *pTraceId);
+    int  phase()     { return Fphase; }
+    int  pages()     { return Fpages; }
+
+    bool start(uint64_t AimageHash, const uint8_t *pTraceId);
+    bool reopen();                      // append to a loaded journal
+    bool erased();
+    bool programmed(int Apages);
+    bool ufmStarted();
+    bool finish();
+
+    TprogJournal(const char *Apath);
+    ~TprogJournal();
+  };
+
+#endif
+// EOF ----------------------------------------------------------------
@@ -14,9 +14,8 @@ using namespace std;
 #include <string.h>
 
 #include "pifwrap.h"
-
-#define CFG_PAGE_SIZE           16
-#define UFM_PAGE_SIZE           16
+#include "pifprog.h"
+#include "i2ctune.h"
 
 static const int MICROSEC = 1000;              // nanosecs
 static const int MILLISEC = 1000 * MICROSEC;   // nanosecs
@@ -67,94 +66,177 @@ static void showCfgStatus(pifHandle h) {
   int init = INITn(h);
   printf("*** status = %8x, INITn = %d", status, init);
 
-  string fcStatus;
-  uint32_t errCode = (status >> 23) & 7;
-  switch (errCode) {
-    case 0: fcStatus = "No Error";      break;
-    case 1: fcStatus = "ID ERR";        break;
-    case 2: fcStatus = "CMD ERR";       break;
-    case 3: fcStatus = "CRC ERR";       break;
-    case 4: fcStatus = "Preamble ERR";  break;
-    case 5: fcStatus = "Abort ERR";     break;
-    case 6: fcStatus = "Overflow ERR";  break;
-    case 7: fcStatus = "SDM EOF";       break;
-    }
+  Txo2Status st;
+  xo2DecodeStatus(status, st);
   printf("  Done=%d, CfgEna=%d, Busy=%d, Fail=%d, FlashCheck=%s\n",
-            ((status >>  8) & 1),
-            ((status >>  9) & 1),
-            ((status >> 12) & 1),
-            ((status >> 13) & 1), fcStatus.c_str());
+            st.done, st.cfgEna, st.busy, st.fail, xo2ErrString(st.errCode));
   }
 
 
 //---------------------------------------------------------------------
-enum state {INITIAL, INDATA};
+// Ahz 0 probes for the fastest rate
+static void setI2cRate(pifHandle h, uint32_t Ahz) {
+  if (Ahz) {
+    if (!pifI2cSetRate(h, Ahz))
+      printf("I2C rate %u not supported\n", Ahz);
+    return;
+    }
+
+  TI2cProbeResult res;
+  i2cProbe(*(Tpif *)h, &res);
+  for (int i=0; i<res.numRates; i++)
+    printf("I2C %4ukHz: %2d/%d loopbacks, %d mismatches, %s\n",
+              res.rates[i].hz / 1000, res.rates[i].passes, I2C_PROBE_PASSES,
+              res.rates[i].mismatches, i2cReasonString(res.rates[i].reasons));
+  printf("I2C rate %ukHz\n", pifI2cGetRate(h) / 1000);
+  }
 
-static void configureXO2(pifHandle h, FILE *fd) {
-    char *line = NULL, *eptr;
-    int num = 0;
-    size_t len = 0;
-    ssize_t read;
-    enum state machine = INITIAL;
+//---------------------------------------------------------------------
+static void showProgress(int Apage, int AnumPages, void *pCtx) {
+  if ((Apage % 25)==0)
+    printf(".");
+  }
+
+//---------------------------------------------------------------------
+// the handle is the Tpif object, see pifwrap.cpp. DONE is only set,
+// and the new image only booted, once everything has verified; on a
+// failure the journal is kept so that the next run can carry on.
+static bool configureXO2(pifHandle h, FILE *fd, const char *journalPath,
+                                                        int sampleBatches) {
+  TpifProgrammer prog(*(Tpif *)h);
+  TjedecImage    img;
+  int            badLine = 0;
+  bool           ok;
 
   printf("\n----------------------------\n");
 
-  pifWaitUntilNotBusy(h, -1);
+  if (!jedecRead(fd, img, &badLine)) {
+    printf("bad fuse row at line %d\n", badLine);
+    return false;
+    }
+  printf("%d configuration pages read\n", img.cfgPages());
+  if (img.ufmPages())
+    printf("%d UFM pages read\n", img.ufmPages());
+
+  // an image is only loaded once it is known to fit the FPGA
+  if (!prog.identify()) {
+    printf("cannot identify FPGA\n");
+    return false;
+    }
+  const Txo2Device *dev = prog.device();
+  if (!img.Fdevice.empty() && (img.Fdevice.find(dev->name) == string::npos)) {
+    printf("JEDEC file is for %s, FPGA is %s\n",
+                                      img.Fdevice.c_str(), dev->name);
+    return false;
+    }
+  if (img.cfgPages() > dev->cfgPages) {
+    printf("too many pages for %s (%d)\n", dev->name, dev->cfgPages);
+    return false;
+    }
+  if (img.ufmPages() > dev->ufmPages) {
+    printf("too many UFM pages for %s (%d)\n", dev->name, dev->ufmPages);
+    return false;
+    }
 
-  pifDisableCfgInterface(h);
-  showCfgStatus(h);
-  pifEnableCfgInterfaceOffline(h);
+  // a journal left by an interrupted run of this image on this board
+  // lets us carry on where it stopped
+  TprogJournal *journal = 0;
+  uint64_t      imageHash = jedecImageHash(img);
+  uint8_t       traceId[8];
+  int           resumeFrom = -1;
+  pifGetTraceId(h, traceId);
+  if (journalPath) {
+    journal = new TprogJournal(journalPath);
+    prog.setJournal(journal);
+    if (journal->load() && journal->matches(imageHash, traceId) &&
+        ((journal->phase() == TprogJournal::JP_ERASED) ||
+         (journal->phase() == TprogJournal::JP_PROGRAMMING)))
+      resumeFrom = journal->pages();
+    }
 
-  showCfgStatus(h);
-  printf("erasing configuration memory..\n");
-  pifEraseCfg(h);
-  printf("erased..\n");
+  bool withUfm = (img.ufmPages() > 0);
+  prog.setProgress(showProgress, 0);
+  prog.setIntegrity(sampleBatches);
+  if (resumeFrom >= 0) {
+    showCfgStatus(h);
+    printf("resuming at page %d..\n", resumeFrom);
+    journal->reopen();
+    ok = prog.resume(img, resumeFrom);
+    printf("\n");
+    if (!ok) {
+      printf("pages before %d do not match, starting over\n", resumeFrom);
+      resumeFrom = -1;
+      }
+    }
 
-  pifInitCfgAddr(h);
-  showCfgStatus(h);
-  printf("programming configuration memory..\n"); // up to 2.2 secs in a -7000
-  while ((read = getline(&line, &len, fd)) != -1) {
-    uint8_t frameData[CFG_PAGE_SIZE];
-    uint8_t c;
-    char *tmp;
-    //printf("Retrieved line[%d] of length: %zu\n", num, read);
-    num++;
-    //printf("%s", line);
-    if (line[0] != '0' && line [0] != '1') {
-      if (machine == INITIAL)
-        continue;
-      if (machine == INDATA)
-        break;
+  if (resumeFrom < 0) {
+    if (journal)
+      journal->start(imageHash, traceId);
+    showCfgStatus(h);
+    printf(withUfm ? "erasing configuration memory and UFM..\n"
+                   : "erasing configuration memory..\n");
+    if (!prog.erase(withUfm)) {
+      printf("erase FAILED\n");
+      delete journal;
+      return false;
+      }
+    printf("erased..\n");
+
+    showCfgStatus(h);
+    printf("programming configuration memory..\n"); // up to 2.2 secs in a -7000
+    ok = prog.program(img);
+    printf("\n");
+    if (!ok) {
+      printf("programming FAILED\n");
+      delete journal;
+      return false;
+      }
     }
-    machine = INDATA;
-    for (int i=0; i < CFG_PAGE_SIZE; i++) {
-      tmp = strndup(&line[i*8], 8);
-      c = (uint8_t)strtol(tmp, &eptr, 2);
-      printf("tmp: %s hex: 0x%02x\n", tmp, c);
-      frameData[i] = c;
-      free(tmp);
+
+  if (sampleBatches) {
+    const TprogStats& st = prog.stats();
+    printf("integrity: %d status checks, %d pages read back, "
+           "%d re-erases, %d pages reprogrammed\n",
+           st.statusChecks, st.readbackPages, st.reerases,
+           st.reprogrammedPages);
     }
-    pifProgCfgPage(h, frameData);
-    if ((num % 25)==0)
-      printf(".");
-  }
-  printf("\n");
 
   showCfgStatus(h);
-/*
-  for (int i=0; i<CFG_PAGE_SIZE; i++)
-    frameData[i] = 0xff;
-  pifProgCfgPage(h, frameData);
-  showCfgStatus(h);
-*/
+  int badPage = -1;
+  if (!prog.verify(img, &badPage)) {
+    printf("verify FAILED at page %d\n", badPage);
+    delete journal;
+    return false;
+    }
+  printf("verified..\n");
+
+  if (withUfm) {
+    printf("programming UFM..\n");
+    if (!prog.programUfm(img)) {
+      printf("UFM programming FAILED\n");
+      delete journal;
+      return false;
+      }
+    if (!prog.verifyUfm(img, &badPage)) {
+      printf("UFM verify FAILED at page %d\n", badPage);
+      delete journal;
+      return false;
+      }
+    printf("UFM verified..\n");
+    }
+
+  // the journal goes before DONE, a configured device is never resumed
+  if (journal) {
+    journal->finish();
+    delete journal;
+    }
 
   printf("programmed. transferring..\n");
-  pifProgDone(h);
-  pifRefresh(h);
+  ok = prog.done() && prog.refresh();
 
-  pifDisableCfgInterface(h);
   showCfgStatus(h);
-  printf("configuration done\n");
+  printf(ok ? "configuration done\n" : "transfer FAILED\n");
+  return ok;
   }
 
 #define handle_error(msg) \
@@ -163,13 +245,35 @@ static void configureXO2(pifHandle h, FILE *fd) {
 //---------------------------------------------------------------------
 int main(int argc, char *argv[]) {
   FILE *fd;
-
-  if (argc < 2) {
-    fprintf(stderr, "%s file\n", argv[0]);
+  const char *journalPath = NULL;
+  const char *profilePath = NULL;
+  int   sampleBatches = 0;
+  uint32_t i2cHz    = 0;
+  bool     setI2cHz = false;
+  int   arg = 1;
+  bool  ok  = false;
+
+  for (; (arg+1 < argc) && (argv[arg][0] == '-'); arg+=2) {
+    if (strcmp(argv[arg], "-j") == 0)
+      journalPath = argv[arg+1];
+    else if (strcmp(argv[arg], "-i") == 0)
+      sampleBatches = atoi(argv[arg+1]);
+    else if (strcmp(argv[arg], "-t") == 0)
+      profilePath = argv[arg+1];
+    else if (strcmp(argv[arg], "-r") == 0) {
+      i2cHz    = strtoul(argv[arg+1], 0, 0);
+      setI2cHz = true;
+      }
+    else
+      break;
+    }
+  if ((arg+1 != argc) || (sampleBatches < 0)) {
+    fprintf(stderr, "%s [-j journal] [-i sample_batches] [-t spi_profile]\n"
+                    "        [-r i2c_hz, 0 probes] file\n", argv[0]);
     exit(EXIT_FAILURE);
   }
 
-  fd = fopen(argv[1], "r");
+  fd = fopen(argv[arg], "r");
   if (fd == NULL)
     handle_error("fopen");
 
@@ -183,16 +287,22 @@ int main(int argc, char *argv[]) {
   h = pifInit();
 //printf("handle=%x\n", (unsigned)h);
   if (h) {
+    if (profilePath) {
+      int div = pifSpiTune(h, profilePath, 0);
+      printf("SPI clock divider %d (%.2fMHz)\n", div, div ? 250.0 / div : 0.0);
+      }
+    if (setI2cHz)
+      setI2cRate(h, i2cHz);
     showDeviceID(h);
     showTraceID(h);
     //  showUsercode(h);
-    configureXO2(h, fd);
+    ok = configureXO2(h, fd, journalPath, sampleBatches);
 
     pifClose(h);
   }
 
   printf("==================== bye ==========================\n");
-  return 0;
+  return ok ? 0 : EXIT_FAILURE;
   }
 
 // EOF ----------------------------------------------------------------
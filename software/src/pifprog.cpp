@@ -0,0 +1,233 @@
+// pifprog.cpp --------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <assert.h>
+#include <string.h>
+
+#include "pifprog.h"
+
+//---------------------------------------------------------------------
+bool TpifProgrammer::identify() {
+  uint32_t idCode = 0;
+  bool ok = Fpif.getDeviceIdCode(idCode);
+  pDevice = ok ? xo2FindDevice(idCode) : 0;
+  return (pDevice != 0);
+  }
+
+//---------------------------------------------------------------------
+bool TpifProgrammer::erase(bool AwithUfm) {
+  bool ok = Fpif.waitUntilNotBusy(-1);
+  ok = ok && Fpif.disableCfgInterface();
+  ok = ok && Fpif.enableCfgInterfaceOffline();
+  ok = ok && Fpif.erase(AwithUfm ? (CFG_ERASE | UFM_ERASE) : CFG_ERASE);
+  if (ok && pJournal)
+    pJournal->erased();
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+// n pages from Apage on, the address register is already there
+bool TpifProgrammer::_progBatch(const TjedecImage& img, int Apage, int n) {
+  bool ok = true;
+  if (img.framesStaged())               // the transmit stream is laid out
+    ok = Fpif.progCfgFrames(img.frames(Apage), n);
+  else
+    for (int i=Apage; ok && (i<Apage+n); i++)
+      ok = Fpif.progCfgPage(img.cfgPage(i));
+  for (int i=Apage; Fprogress && (i<Apage+n); i++)
+    Fprogress(i, img.cfgPages(), pProgressCtx);
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+// reads back pages Afrom..Ato-1, which leaves the address register at
+// Ato. Returns the first bad page or -1.
+int TpifProgrammer::_checkBack(const TjedecImage& img, int Afrom, int Ato) {
+  uint8_t buf[PROG_VERIFY_CHUNK * CFG_PAGE_SIZE];
+
+  bool ok = Fpif.waitUntilNotBusy(-1);
+  ok = ok && Fpif.setCfgPageAddr(Afrom);
+  for (int i=Afrom; i<Ato; i+=PROG_VERIFY_CHUNK) {
+    int n = Ato - i;
+    if (n > PROG_VERIFY_CHUNK)
+      n = PROG_VERIFY_CHUNK;
+    ok = ok && Fpif.readCfgPages(n, buf);
+    if (!ok)
+      return Afrom;
+    Fstats.readbackPages += n;
+    int bad = xo2ComparePages(buf, img.cfgPage(i), n, CFG_PAGE_SIZE);
+    if (bad >= 0)
+      return i + bad;
+    }
+  return -1;
+  }
+
+//---------------------------------------------------------------------
+bool TpifProgrammer::_program(const TjedecImage& img, int AfromPage) {
+  int numPages = img.cfgPages();
+  if (pDevice && (numPages > pDevice->cfgPages))
+    return false;
+
+  memset(&Fstats, 0, sizeof(Fstats));
+  bool ok = (AfromPage == 0) ? Fpif.initCfgAddr() : Fpif.setCfgPageAddr(AfromPage);
+  int  good    = AfromPage;             // everything before is confirmed
+  int  batches = 0;
+  int  retries = 0;
+  for (int i=AfromPage; ok && (i<numPages); ) {
+    int n = numPages - i;
+    if (n > PROG_FRAME_BATCH)
+      n = PROG_FRAME_BATCH;
+    ok = _progBatch(img, i, n);
+    i += n;
+    batches++;
+    if (ok && !FsampleEvery) {
+      if (pJournal)
+        pJournal->programmed(i);
+      continue;
+      }
+
+    bool check = (i == numPages) || ((batches % FsampleEvery) == 0);
+    uint32_t status = 0;
+    Txo2Status st;
+    ok = ok && Fpif.getStatusReg(status);
+    Fstats.statusChecks++;
+    xo2DecodeStatus(status, st);
+    if (!ok || !(check || st.fail))
+      continue;
+
+    if (_checkBack(img, good, i) < 0) {
+      good = i;
+      if (pJournal)
+        pJournal->programmed(good);
+      continue;
+      }
+
+    // config flash pages must not be programmed twice, so whatever went
+    // wrong is only put right by an erase and a run from page 0
+    if (++retries > FmaxRetries)
+      return false;
+    Fstats.reerases++;
+    Fstats.reprogrammedPages += i;
+    ok = erase(false) && Fpif.initCfgAddr();
+    good = i = 0;
+    }
+  return ok;
+  }
+
+bool TpifProgrammer::program(const TjedecImage& img) {
+  return _program(img, 0);
+  }
+
+//---------------------------------------------------------------------
+bool TpifProgrammer::resume(const TjedecImage& img, int AfromPage) {
+  if ((AfromPage < 0) || (AfromPage > img.cfgPages()))
+    return false;
+
+  int first = AfromPage - PROG_RESUME_CHECK;
+  if (first < 0)
+    first = 0;
+  uint8_t buf[PROG_RESUME_CHECK * CFG_PAGE_SIZE];
+  bool ok = Fpif.waitUntilNotBusy(-1);
+  ok = ok && Fpif.enableCfgInterfaceOffline();
+  if (AfromPage > first) {
+    ok = ok && Fpif.setCfgPageAddr(first);
+    ok = ok && Fpif.readCfgPages(AfromPage - first, buf);
+    ok = ok && (xo2ComparePages(buf, img.cfgPage(first), AfromPage - first,
+                                                        CFG_PAGE_SIZE) < 0);
+    }
+  return ok && _program(img, AfromPage);
+  }
+
+//---------------------------------------------------------------------
+bool TpifProgrammer::verify(const TjedecImage& img, int *pBadPage) {
+  uint8_t buf[PROG_VERIFY_CHUNK * CFG_PAGE_SIZE];
+  int numPages = img.cfgPages();
+
+  if (pBadPage)
+    *pBadPage = -1;
+  bool ok = Fpif.initCfgAddr();
+  for (int i=0; ok && (i<numPages); i+=PROG_VERIFY_CHUNK) {
+    int n = numPages - i;
+    if (n > PROG_VERIFY_CHUNK)
+      n = PROG_VERIFY_CHUNK;
+    ok = Fpif.readCfgPages(n, buf);
+    int bad = ok ? xo2ComparePages(buf, img.cfgPage(i), n, CFG_PAGE_SIZE) : 0;
+    if (bad >= 0) {
+      if (pBadPage)
+        *pBadPage = i + bad;
+      ok = false;
+      }
+    }
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+// still in the offline session, one address set per run of non-blank
+// pages
+bool TpifProgrammer::programUfm(const TjedecImage& img) {
+  int numPages = img.ufmPages();
+  if (pDevice && (numPages > pDevice->ufmPages))
+    return false;
+  if (pJournal)
+    pJournal->ufmStarted();
+
+  bool ok = true;
+  int  next = -1;                       // where the address register is
+  for (int i=0; ok && (i<numPages); i++) {
+    if (img.ufmPageBlank(i))
+      continue;
+    if (i != next)
+      ok = Fpif.setUfmPageAddr(i);
+    ok = ok && Fpif.progUfmPage(img.ufmPage(i));
+    next = i + 1;
+    }
+  return ok && Fpif.waitUntilNotBusy(-1);
+  }
+
+//---------------------------------------------------------------------
+bool TpifProgrammer::verifyUfm(const TjedecImage& img, int *pBadPage) {
+  uint8_t buf[PROG_VERIFY_CHUNK * UFM_PAGE_SIZE];
+  int numPages = img.ufmPages();
+
+  if (pBadPage)
+    *pBadPage = -1;
+  bool ok = Fpif.setUfmPageAddr(0);
+  for (int i=0; ok && (i<numPages); i+=PROG_VERIFY_CHUNK) {
+    int n = numPages - i;
+    if (n > PROG_VERIFY_CHUNK)
+      n = PROG_VERIFY_CHUNK;
+    ok = Fpif.readUfmPages(n, buf);
+    int bad = ok ? xo2ComparePages(buf, img.ufmPage(i), n, UFM_PAGE_SIZE) : 0;
+    if (bad >= 0) {
+      if (pBadPage)
+        *pBadPage = i + bad;
+      ok = false;
+      }
+    }
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+bool TpifProgrammer::done() {
+  return Fpif.progDone();
+  }
+
+bool TpifProgrammer::refresh() {
+  bool ok = Fpif.refresh();
+  ok = Fpif.disableCfgInterface() && ok;
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+TpifProgrammer::TpifProgrammer(Tpif& Apif)
+      : Fpif(Apif), pDevice(0), Fprogress(0), pProgressCtx(0), pJournal(0),
+        FsampleEvery(0), FmaxRetries(PROG_MAX_RETRIES) {
+  memset(&Fstats, 0, sizeof(Fstats));
+  }
+
+// EOF ----------------------------------------------------------------
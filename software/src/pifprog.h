@@ -0,0 +1,87 @@
+// pifprog.h ----------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// the config flash loader flow, phase by phase
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef pifprogH
+#define pifprogH
+
+#include "pif.h"
+#include "jedec.h"
+#include "xo2.h"
+#include "pifjournal.h"
+
+#define PROG_VERIFY_CHUNK       64        /* pages per verify compare */
+#define PROG_FRAME_BATCH        64        /* staged frames per transport call */
+#define PROG_RESUME_CHECK       8         /* pages re-read before resuming */
+#define PROG_MAX_RETRIES        8         /* re-erases per run */
+
+//---------------------------------------------------------------------
+// what integrity mode cost, see TpifProgrammer::setIntegrity()
+struct TprogStats {
+  int       statusChecks;               // status register reads
+  int       readbackPages;              // pages read back and compared
+  int       reerases;                   // readback mismatches, each an erase
+  int       reprogrammedPages;          // pages sent more than once
+  };
+
+typedef void (*TprogProgress)(int Apage, int AnumPages, void *pCtx);
+
+//---------------------------------------------------------------------
+class TpifProgrammer {
+  private:
+    Tpif&             Fpif;
+    const Txo2Device *pDevice;
+    TprogProgress     Fprogress;
+    void             *pProgressCtx;
+    TprogJournal     *pJournal;
+    int               FsampleEvery;     // batches between readbacks, 0 off
+    int               FmaxRetries;
+    TprogStats        Fstats;
+
+    bool _progBatch(const TjedecImage& img, int Apage, int n);
+    int  _checkBack(const TjedecImage& img, int Afrom, int Ato);
+    bool _program(const TjedecImage& img, int AfromPage);
+
+  public:
+    // the phases, in the order the loader runs them
+    bool identify();                    // sets device()
+    bool erase(bool AwithUfm=false);    // offline mode, config flash erased
+    bool program(const TjedecImage& img);
+    // after an interrupted program(), no erase. The PROG_RESUME_CHECK
+    // pages before AfromPage are verified first.
+    bool resume(const TjedecImage& img, int AfromPage);
+    bool verify(const TjedecImage& img, int *pBadPage=0);
+    bool programUfm(const TjedecImage& img);   // blank pages are skipped
+    bool verifyUfm(const TjedecImage& img, int *pBadPage=0);
+    bool done();                        // program the DONE bit
+    bool refresh();                     // boot the new image, leave config
+
+    // the SPI transport cannot report errors, so in integrity mode
+    // program() checks the status Fail bit after every batch and reads
+    // back what was programmed every AsampleBatches batches (and at the
+    // end). A page may only be programmed once after an erase, so on a
+    // bad page the flash is erased again and programmed from page 0, at
+    // most AmaxRetries times. 0 turns it off.
+    void setIntegrity(int AsampleBatches, int AmaxRetries=PROG_MAX_RETRIES) {
+      FsampleEvery = (AsampleBatches > 0) ? AsampleBatches : 0;
+      FmaxRetries  = AmaxRetries;
+      }
+    const TprogStats& stats() { return Fstats; }
+
+    const Txo2Device *device() { return pDevice; }
+    void setJournal(TprogJournal *Ajournal) { pJournal = Ajournal; }
+    void setProgress(TprogProgress Afn, void *pCtx) {
+      Fprogress    = Afn;
+      pProgressCtx = pCtx;
+      }
+
+    TpifProgrammer(Tpif& Apif);
+  };
+
+#endif
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,199 @@
+//---------------------------------------------------------------------
+// pifprogbench.cpp
+//
+// end-to-end programming time, every XO2 density, simulated board
+//
+//   pifprogbench [-d spi_divider] [-o xfer_overhead_ns]
+//                [-f faults_per_page] [-s sample_batches]  > results.json
+//
+// runs the loader flow (identify, erase, program, verify, done,
+// refresh) against a timing-modelled XO2 and reports, per phase, the
+// modelled wall time, SPI bus utilisation and host CPU time. -s turns
+// on integrity mode, -f injects single bit errors into programmed
+// pages; the retries and what they cost are reported too.
+
+using namespace std;
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pifprog.h"
+#include "pifsim.h"
+#include "pifwrap.h"
+#include "benchutil.h"
+
+#define SPI_CORE_CLOCK_HZ       250e6
+
+//---------------------------------------------------------------------
+// counters at the start of a phase
+class TphaseMark {
+  public:
+    uint64_t Fmodelled, Fbus, Fcpu, Ftrans, Fbytes;
+
+    void take(TsimLowLevel& lo) {
+      Fmodelled = lo.device()->nowNs();
+      Fbus      = lo.FbusNs;
+      Fcpu      = benchCpuNs();
+      Ftrans    = lo.FspiTransactions;
+      Fbytes    = lo.FspiBytes;
+      }
+  };
+
+//---------------------------------------------------------------------
+static void reportPhase(TjsonOut& js, const char *name, bool ok,
+                        TphaseMark& m, TsimLowLevel& lo, uint64_t& total) {
+  uint64_t modelled = lo.device()->nowNs() - m.Fmodelled;
+  uint64_t bus      = lo.FbusNs - m.Fbus;
+  total += modelled;
+
+  js.object()
+      .str    ("phase",             name)
+      .boolean("ok",                ok)
+      .num    ("modelled_ms",       modelled / 1e6)
+      .num    ("bus_ms",            bus / 1e6)
+      .num    ("bus_utilisation",   modelled ? (double)bus / modelled : 0.0)
+      .num    ("cpu_ms",            (benchCpuNs() - m.Fcpu) / 1e6)
+      .integer("spi_transactions",  lo.FspiTransactions - m.Ftrans)
+      .integer("spi_bytes",         lo.FspiBytes - m.Fbytes)
+      .endObject();
+  }
+
+//---------------------------------------------------------------------
+// a repeatable pseudo-random bitstream that fills the part
+static void makeImage(TjedecImage& img, const Txo2Device *dev) {
+  img.clear();
+  img.Fdevice = dev->name;
+  img.Fcfg.resize((size_t)dev->cfgPages * CFG_PAGE_SIZE);
+  uint32_t x = 0x2545f491;
+  for (size_t i=0; i<img.Fcfg.size(); i++) {
+    x ^= x << 13;  x ^= x >> 17;  x ^= x << 5;
+    img.Fcfg[i] = (uint8_t)x;
+    }
+  img.stageFrames();
+  }
+
+//---------------------------------------------------------------------
+static void benchDevice(TjsonOut& js, const Txo2Device *dev,
+                        double spiHz, long overheadNs,
+                        double faultRate, int sampleBatches) {
+  TsimXO2 sim(dev->idCode, dev->cfgPages, dev->ufmPages);
+  TsimTiming t = simDefaultTiming(dev->cfgPages);
+  t.spiHz          = spiHz;
+  t.xferOverheadNs = overheadNs;
+  sim.setTiming(t);
+  sim.setFaultRate(faultRate);
+
+  TsimLowLevel   *lo = new TsimLowLevel(&sim);
+  Tpif            pif(lo);
+  TpifProgrammer  prog(pif);
+  TjedecImage     img;
+  prog.setIntegrity(sampleBatches);
+  makeImage(img, dev);
+
+  TphaseMark m;
+  uint64_t   total = 0;
+  uint8_t    traceId[8];
+  int        badPage = -1;
+  bool       ok;
+
+  js.object()
+      .str    ("device",    dev->name)
+      .integer("cfg_pages", dev->cfgPages)
+      .integer("ufm_pages", dev->ufmPages)
+      .array  ("phases");
+
+  m.take(*lo);
+  ok = prog.identify() && pif.getTraceId(traceId);
+  reportPhase(js, "identify", ok, m, *lo, total);
+
+  m.take(*lo);
+  ok = prog.erase();
+  reportPhase(js, "erase", ok, m, *lo, total);
+
+  m.take(*lo);
+  ok = prog.program(img);
+  reportPhase(js, "program", ok, m, *lo, total);
+
+  m.take(*lo);
+  ok = prog.verify(img, &badPage);
+  reportPhase(js, "verify", ok, m, *lo, total);
+
+  m.take(*lo);
+  ok = prog.done();
+  reportPhase(js, "done", ok, m, *lo, total);
+
+  m.take(*lo);
+  ok = prog.refresh();
+  reportPhase(js, "refresh", ok, m, *lo, total);
+
+  uint32_t status = sim.statusReg();
+  const TprogStats& st = prog.stats();
+  js.endArray()
+      .num    ("total_modelled_ms", total / 1e6)
+      .num    ("first_bad_page",    badPage)
+      .boolean("device_fail_flag",  (status >> 13) & 1)
+      .integer("injected_faults",   sim.Ffaults)
+      .integer("status_checks",     st.statusChecks)
+      .integer("readback_pages",    st.readbackPages)
+      .integer("reerases",          st.reerases)
+      .integer("reprogrammed_pages", st.reprogrammedPages)
+      .endObject();
+
+  fprintf(stderr, "%-12s %6d pages  %9.1f ms modelled  %s"
+                  "  %d faults  %d re-erases\n",
+                  dev->name, dev->cfgPages, total / 1e6,
+                  (badPage < 0) ? "ok" : "BAD",
+                  (int)sim.Ffaults, st.reerases);
+  }
+
+//---------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+  int  divider    = 32;                  // what TlowLevel uses, ~8MHz
+  long overheadNs = simDefaultTiming(0).xferOverheadNs;
+  double faultRate = 0;
+  int  sample     = 0;                   // integrity mode off
+
+  for (int i=1; i<argc; i++) {
+    if ((strcmp(argv[i], "-d") == 0) && (i+1 < argc))
+      divider = atoi(argv[++i]);
+    else if ((strcmp(argv[i], "-o") == 0) && (i+1 < argc))
+      overheadNs = atol(argv[++i]);
+    else if ((strcmp(argv[i], "-f") == 0) && (i+1 < argc))
+      faultRate = atof(argv[++i]);
+    else if ((strcmp(argv[i], "-s") == 0) && (i+1 < argc))
+      sample = atoi(argv[++i]);
+    else
+      divider = 0;
+    }
+  if ((divider < 2) || (divider & 1) || (overheadNs < 0) ||
+      (faultRate < 0) || (faultRate > 1) || (sample < 0)) {
+    fprintf(stderr, "%s [-d spi_divider] [-o xfer_overhead_ns]"
+                    " [-f faults_per_page] [-s sample_batches]\n", argv[0]);
+    return EXIT_FAILURE;
+    }
+
+  double spiHz = SPI_CORE_CLOCK_HZ / divider;
+  char version[200];
+  pifVersion(version, sizeof(version));
+
+  TjsonOut js(stdout);
+  js.object()
+      .str    ("suite",             "pifprogbench")
+      .str    ("library",           version)
+      .num    ("spi_hz",            spiHz)
+      .integer("xfer_overhead_ns",  overheadNs)
+      .num    ("faults_per_page",   faultRate)
+      .integer("sample_batches",    sample)
+      .array  ("devices");
+
+  int numDevices;
+  const Txo2Device *devices = xo2DeviceList(&numDevices);
+  for (int i=0; i<numDevices; i++)
+    benchDevice(js, &devices[i], spiHz, overheadNs, faultRate, sample);
+
+  js.endArray().endObject();
+  return 0;
+  }
+
+// EOF ----------------------------------------------------------------
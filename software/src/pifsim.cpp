@@ -0,0 +1,752 @@
+// pifsim.cpp ---------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+#include "pifsim.h"
+#include "pif.h"
+#include "xo2.h"
+#include "bcm2835.h"
+
+#define SIM_HEADER_LEN          4         /* command + 3 operand bytes */
+
+//---------------------------------------------------------------------
+// the erase time grows with the size of the config flash, 1.0s for
+// an XO2-1200 up to ~4.2s for an XO2-7000
+TsimTiming simDefaultTiming(int AcfgPages) {
+  TsimTiming t;
+  t.spiHz          = 250e6 / 32;        // BCM2835_SPI_CLOCK_DIVIDER_32
+  t.xferOverheadNs = 1500;
+  t.progPageNs     = 160 * 1000;
+  t.eraseCfgNs     = (long)AcfgPages * 460 * 1000;
+  t.eraseUfmNs     = 400 * 1000 * 1000;
+  t.progDoneNs     = 50 * 1000;
+  t.maxSpiHz       = 0;
+  t.maxI2cHz       = 0;
+  t.i2cOverheadNs  = 20 * 1000;
+  t.attnWakeNs     = 50 * 1000;
+  return t;
+  }
+
+//---------------------------------------------------------------------
+void TsimXO2::_put32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >>  8);
+  p[3] = (uint8_t)(v      );
+  }
+
+//---------------------------------------------------------------------
+// xorshift, repeatable for a given seed
+uint32_t TsimXO2::_random() {
+  Frng ^= Frng << 13;
+  Frng ^= Frng >> 17;
+  Frng ^= Frng << 5;
+  return Frng;
+  }
+
+//---------------------------------------------------------------------
+// one page per call, the address register post-increments. Programming
+// can only set bits, erased flash reads as zeros. An injected fault
+// flips one data bit on the way in.
+void TsimXO2::_prog(std::vector<uint8_t>& mem, const uint8_t *p, size_t len) {
+  size_t offs = (size_t)Faddr * CFG_PAGE_SIZE;
+  if (!FcfgEna || _busy() || (len < CFG_PAGE_SIZE)
+               || (offs+CFG_PAGE_SIZE > mem.size())) {
+    Ffail = true;
+    return;
+    }
+  uint8_t page[CFG_PAGE_SIZE];
+  memcpy(page, p, CFG_PAGE_SIZE);
+  if ((FfaultRate > 0) && (_random() < FfaultRate * 4294967295.0)) {
+    uint32_t bit = _random() % (CFG_PAGE_SIZE * 8);
+    page[bit / 8] ^= (uint8_t)(0x80 >> (bit % 8));
+    Ffaults++;
+    }
+  for (int i=0; i<CFG_PAGE_SIZE; i++)
+    mem[offs + i] |= page[i];
+  Faddr++;
+  _setBusy(Ftiming.progPageNs);
+  }
+
+//---------------------------------------------------------------------
+// pages are streamed back to back for as long as the clock runs
+void TsimXO2::_read(std::vector<uint8_t>& mem, uint8_t *p, size_t len) {
+  memset(p, 0, len);
+  if (!FcfgEna) {
+    Ffail = true;
+    return;
+    }
+  for (size_t done=0; done<len; done+=CFG_PAGE_SIZE) {
+    size_t offs = (size_t)Faddr * CFG_PAGE_SIZE;
+    size_t n    = len - done;
+    if (n > CFG_PAGE_SIZE)
+      n = CFG_PAGE_SIZE;
+    if (offs+CFG_PAGE_SIZE <= mem.size())
+      memcpy(p+done, &mem[offs], n);
+    Faddr++;
+    }
+  }
+
+//---------------------------------------------------------------------
+uint32_t TsimXO2::statusReg() {
+  uint32_t v = 0;
+  if (Fdone)          v |= (1 <<  8);
+  if (FcfgEna)        v |= (1 <<  9);
+  if (_busy())        v |= (1 << 12);
+  if (Ffail)          v |= (1 << 13);
+  return v;
+  }
+
+//---------------------------------------------------------------------
+void TsimXO2::spiTransfer(uint8_t *pData, size_t Alen) {
+  if (Alen < 1)
+    return;
+
+  int     cmd  = pData[0];
+  int     op0  = (Alen > 1) ? pData[1] : 0;
+  uint8_t *pay = pData + SIM_HEADER_LEN;
+  size_t  nPay = (Alen > SIM_HEADER_LEN) ? Alen - SIM_HEADER_LEN : 0;
+
+  switch (cmd) {
+    case READ_DEVICE_ID_CODE:
+      if (nPay >= 4) _put32(pay, FidCode);
+      break;
+    case READ_STATUS_REG:
+      if (nPay >= 4) _put32(pay, statusReg());
+      break;
+    case READ_USERCODE:
+      if (nPay >= 4) _put32(pay, Fusercode);
+      break;
+    case READ_TRACE_ID_CODE:
+      memcpy(pay, FtraceId, (nPay < 8) ? nPay : 8);
+      break;
+    case CHECK_BUSY_FLAG:
+      if (nPay >= 1) pay[0] = _busy() ? 0x80 : 0;
+      break;
+
+    case ISC_ENABLE_X:
+    case ISC_ENABLE_PROG:
+      FcfgEna = true;
+      Ffail   = false;
+      break;
+    case ISC_DISABLE:
+      FcfgEna = false;
+      break;
+    case BYPASS:
+      break;
+
+    case ISC_INIT_CFG_ADDR:
+      FufmSector = false;
+      Faddr      = 0;
+      break;
+    case ISC_INIT_UFM_ADDR:
+      FufmSector = true;
+      Faddr      = 0;
+      break;
+    case LSC_WRITE_ADDRESS:
+      if (nPay >= 4) {
+        FufmSector = (pay[0] & 0x40) != 0;
+        Faddr      = ((pay[2] << 8) | pay[3]) & 0x3fff;
+        }
+      break;
+
+    case ISC_ERASE:
+      if (!FcfgEna || _busy()) {
+        Ffail = true;
+        break;
+        }
+      if (op0 & CFG_ERASE) {
+        std::fill(Fcfg.begin(), Fcfg.end(), 0);
+        Fdone     = false;
+        Fusercode = 0;
+        _setBusy(Ftiming.eraseCfgNs);
+        }
+      if (op0 & UFM_ERASE) {
+        std::fill(Fufm.begin(), Fufm.end(), 0);
+        if (!(op0 & CFG_ERASE))
+          _setBusy(Ftiming.eraseUfmNs);
+        }
+      break;
+    case ISC_ERASE_UFM:
+      if (!FcfgEna || _busy()) {
+        Ffail = true;
+        break;
+        }
+      std::fill(Fufm.begin(), Fufm.end(), 0);
+      _setBusy(Ftiming.eraseUfmNs);
+      break;
+
+    case ISC_PROG_CFG_INCR:
+      _prog(Fcfg, pay, nPay);
+      break;
+    case ISC_PROG_UFM_INCR:
+      _prog(Fufm, pay, nPay);
+      break;
+    case ISC_READ_CFG_INCR:
+      _read(Fcfg, pay, nPay);
+      break;
+    case ISC_READ_UFM_INCR:
+      _read(Fufm, pay, nPay);
+      break;
+
+    case ISC_PROGRAM_USERCODE:
+      if (nPay >= 4)
+        Fusercode = (pay[0] << 24) | (pay[1] << 16) | (pay[2] << 8) | pay[3];
+      break;
+    case ISC_PROG_DONE:
+      if (FcfgEna) {
+        Fdone = true;
+        _setBusy(Ftiming.progDoneNs);
+        }
+      break;
+    case ISC_REFRESH:
+      FcfgEna = false;
+      break;
+
+    default:
+      Ffail = true;
+      break;
+    }
+
+  // nothing meaningful is clocked out during the header
+  memset(pData, 0, (Alen < SIM_HEADER_LEN) ? Alen : SIM_HEADER_LEN);
+
+  // past the cable's limit read bits go wrong, rarely just above it
+  // and every transfer at twice the speed
+  double over = (Ftiming.maxSpiHz > 0) ? Ftiming.spiHz / Ftiming.maxSpiHz - 1 : 0;
+  if ((over > 0) && (nPay > 0) && (_random() < over * 4294967295.0)) {
+    uint32_t bit = _random() % (nPay * 8);
+    pay[bit / 8] ^= (uint8_t)(0x80 >> (bit % 8));
+    }
+  }
+
+//---------------------------------------------------------------------
+TsimXO2::TsimXO2(uint32_t AidCode, int AcfgPages, int AufmPages)
+      : Ftiming(simDefaultTiming(AcfgPages)), FnowNs(0), FbusyUntilNs(0),
+        FidCode(AidCode), Fusercode(0),
+        FcfgEna(false), Fdone(false), Ffail(false),
+        FufmSector(false), Faddr(0), FfaultRate(0), Frng(1),
+        Fcfg((size_t)AcfgPages * CFG_PAGE_SIZE, 0),
+        Fufm((size_t)AufmPages * UFM_PAGE_SIZE, 0), Ffaults(0) {
+  static const uint8_t traceId[8] = {0x80,0x12,0x34,0x56,0x78,0x9a,0xbc,0xde};
+  memcpy(FtraceId, traceId, sizeof(FtraceId));
+  }
+
+//=====================================================================
+
+//---------------------------------------------------------------------
+uint8_t TsimApp::_readByte() {
+  if (Faddr == 4) {                     // R_FIFO
+    int level = FfifoBudget;
+    switch (FfifoHdr) {
+      case 0:  FfifoHdr++;  return level & 0xff;
+      case 1:  FfifoHdr++;  return (FfifoOvf ? 0x80 : 0) | ((level >> 8) & 0x07);
+      }
+    if (FfifoBudget == 0)
+      return 0;
+    uint8_t b = Ffifo.front();
+    Ffifo.pop_front();
+    FfifoBudget--;
+    return b;
+    }
+  if (Faddr == 5) {                     // R_PERF
+    if (FrdSub >= 3 * APP_PERF_COUNTERS)
+      return 0;
+    return FperfSnap[FrdSub / 3] >> (8 * (FrdSub % 3));
+    }
+  if (Faddr == 16)                      // R_WIDE
+    return Fwide[FrdSub % sizeof(Fwide)];
+  if (Faddr == 6) {                     // R_ATTN
+    switch (FrdSub) {
+      case 0:  Fattn &= ~FattnSnap;  return FattnSnap;
+      case 1:  return FattnMask;
+      case 2:  return FfifoBudget & 0xff;
+      case 3:  return (FfifoOvf ? 0x80 : 0) | ((FfifoBudget >> 8) & 0x07);
+      case 4:  return FstreamCount & 0xff;
+      case 5:  return FstreamCount >> 8;
+      default: return 0;
+      }
+    }
+  if (Faddr == 7) {                     // R_STREAM_LOOP, packed again
+    int g = (FrdSub / 4) * 3;
+    switch (FrdSub % 4) {
+      case 0:  return 0x40 | (Floop[g] >> 2);
+      case 1:  return 0x40 | ((Floop[g]   & 0x03) << 4) | (Floop[g+1] >> 4);
+      case 2:  return 0x40 | ((Floop[g+1] & 0x0f) << 2) | (Floop[g+2] >> 6);
+      default: return 0x40 | (Floop[g+2] & 0x3f);
+      }
+    }
+  if (Faddr == 3) {                     // R_STREAM
+    switch (FrdSub) {
+      case 0:  return FstreamCount & 0xff;
+      case 1:  return FstreamCount >> 8;
+      case 2:  return FstreamSum;
+      default: return 0;
+      }
+    }
+  if (Faddr != 0)                       // R_ID
+    return 0;
+  switch (FrdSub % 32) {
+    case 0:  return Fid;
+    case 1:  return 0x40 | Fscratch;
+    case 2:  return 0x50 | (Fmisc & 0x0f);
+    case 3:  return Fcaps;
+    case 4:  return Fcaps2;
+    default: return 0x60 | (FrdSub & 0x0f);
+    }
+  }
+
+//---------------------------------------------------------------------
+// a running test source is taken to have filled the FIFO by the time
+// the host selects it
+void TsimApp::_select(int Areg) {
+  Faddr  = Areg;
+  FrdSub = 0;
+  FwrSub = 0;
+  if (FfifoRun && (Ffifo.size() < APP_FIFO_DEPTH))
+    Fattn |= APP_ATTN_FIFO;
+  while (FfifoRun && (Ffifo.size() < APP_FIFO_DEPTH))
+    Ffifo.push_back(++FfifoSrc);
+  FfifoHdr    = 0;
+  FfifoBudget = (int)Ffifo.size();
+  if (Faddr == 5)
+    memcpy(FperfSnap, Fperf, sizeof(Fperf));
+  if (Faddr == 6)                       // cleared once read
+    FattnSnap = Fattn;
+  if (Faddr == 3)                       // the loop fills from byte 0
+    FloopWr = 0;
+  }
+
+// the registers take the low 6 bits of a whole byte, like pifctl.vhd
+void TsimApp::_regWrite(uint8_t Avalue) {
+  if (Faddr == 1)
+    Fscratch = Avalue & APP_DATA_MASK;
+  else if (Faddr == 2)
+    Fmisc = Avalue & APP_DATA_MASK;
+  else if (Faddr == 16)                 // W_WIDE_REG
+    Fwide[FwrSub % sizeof(Fwide)] = Avalue;
+  else if ((Faddr == 5) && (Avalue & 0x01))
+    memset(Fperf, 0, sizeof(Fperf));
+  else if ((Faddr == 6) && (FwrSub == 0))   // W_ATTN_CTL, set flags
+    attnEvent(Avalue);
+  else if ((Faddr == 6) && (FwrSub == 1))   // and the mask
+    FattnMask = Avalue & APP_ATTN_ALL;
+  else if (Faddr == 4) {                // W_FIFO_CTL
+    FfifoRun = (Avalue & 0x01) != 0;
+    if (Avalue & 0x20) {
+      Ffifo.clear();
+      FfifoOvf = false;
+      FfifoSrc = 0;
+      }
+    }
+  }
+
+void TsimApp::fifoPush(const uint8_t *p, size_t Alen) {
+  for (size_t i=0; i<Alen; i++) {
+    Fattn |= APP_ATTN_FIFO;
+    if (Ffifo.size() < APP_FIFO_DEPTH)
+      Ffifo.push_back(p[i]);
+    else if (!FfifoOvf) {
+      FfifoOvf = true;
+      Fattn   |= APP_ATTN_FIFO_OVF;
+      }
+    }
+  }
+
+// an SPI or X data byte
+void TsimApp::_byteWrite(uint8_t Abyte) {
+  _regWrite(Abyte);
+  if (Faddr == 3)
+    _streamByte(Abyte);
+  FwrSub = (FwrSub + 1) % 128;
+  }
+
+// one I2C byte as pifwb counts it, after the byte has been acted on.
+// Aevent is APP_PERF_TX, or APP_PERF_ADDR, _DATA or _RX for a byte in
+void TsimApp::_countByte(int Aevent) {
+  if (Aevent != APP_PERF_TX)
+    Fperf[APP_PERF_RX]++;
+  if (Aevent != APP_PERF_RX)
+    Fperf[Aevent]++;
+  Fperf[APP_PERF_WB]  += SIM_WB_PER_BYTE;
+  Fperf[APP_PERF_SVC] += SIM_WB_PER_BYTE * SIM_CLOCKS_PER_WB;
+  for (int i=0; i<APP_PERF_COUNTERS; i++)
+    Fperf[i] &= APP_PERF_MASK;
+  }
+
+// the unpacker in pifwb.vhd, the group restarts with the address byte
+void TsimApp::_stream(uint8_t Asym) {
+  uint8_t b = 0;
+  switch (FwrSub % 4) {
+    case 0:  Facc = Asym;                       return;
+    case 1:  b = (Facc << 2) | (Asym >> 4);    break;
+    case 2:  b = (Facc << 4) | (Asym >> 2);    break;
+    case 3:  b = (Facc << 6) | Asym;           break;
+    }
+  Facc = Asym;
+  _streamByte(b);
+  }
+
+void TsimApp::_streamByte(uint8_t Abyte) {
+  if (FloopWr < APP_LOOP_BYTES)
+    Floop[FloopWr++] = Abyte;
+  FstreamCount++;
+  FstreamSum += Abyte;
+  Fattn      |= APP_ATTN_STREAM;
+  }
+
+//---------------------------------------------------------------------
+// one I2C write, an X byte makes the rest of it whole bytes
+void TsimApp::write(const uint8_t *p, size_t Alen) {
+  for (size_t i=0; i<Alen; i++) {
+    uint8_t v = p[i] & 0x3f;
+    switch (p[i] >> 6) {
+      case 0:                           // A_ADDR
+        _select(v & 0x0f);
+        _countByte(APP_PERF_ADDR);
+        break;
+      case 3:                           // X_ADDR
+        _select(v);
+        _countByte(APP_PERF_ADDR);
+        while (++i < Alen) {
+          _byteWrite(p[i]);
+          _countByte(APP_PERF_DATA);
+          }
+        return;
+      case 1:                           // D_ADDR
+        _regWrite(v);
+        if (Faddr == 3)
+          _stream(v);
+        FwrSub = (FwrSub + 1) % 128;
+        _countByte(APP_PERF_DATA);
+        break;
+      default:                          // reserved
+        _countByte(APP_PERF_RX);
+        break;
+      }
+    }
+  }
+
+void TsimApp::_read(uint8_t *p, size_t Alen) {
+  for (size_t i=0; i<Alen; i++) {
+    p[i]   = _readByte();
+    FrdSub = (FrdSub + 1) % 128;
+    }
+  }
+
+// an I2C read, the master's NAK on the last byte restarts pifwb
+void TsimApp::read(uint8_t *p, size_t Alen) {
+  _read(p, Alen);
+  for (size_t i=0; i<Alen; i++)
+    _countByte(APP_PERF_TX);
+  if (Alen) {
+    Fperf[APP_PERF_NAK]     = (Fperf[APP_PERF_NAK] + 1) & APP_PERF_MASK;
+    Fperf[APP_PERF_RESTART] = (Fperf[APP_PERF_RESTART] + 1) & APP_PERF_MASK;
+    }
+  }
+
+//---------------------------------------------------------------------
+void TsimApp::spiTransfer(uint8_t *p, size_t Alen) {
+  if (Alen == 0)
+    return;
+  uint8_t cmd = p[0];
+  _select(cmd & APP_DATA_MASK);
+  p[0]   = 0;
+
+  if (cmd & APP_SPI_WRITE) {
+    for (size_t i=1; i<Alen; i++) {
+      _byteWrite(p[i]);
+      p[i] = 0;
+      }
+    return;
+    }
+  // as in pifwb, only the bytes clocked out after the turnaround count
+  size_t skip = std::min(Alen, (size_t)(1 + APP_SPI_TURNAROUND));
+  memset(p, 0, skip);
+  _read(p + skip, Alen - skip);
+  }
+
+//---------------------------------------------------------------------
+TsimApp::TsimApp()
+      : FwrSub(0), Facc(0), FfifoHdr(0), FfifoBudget(0),
+        Fid(0x43), Faddr(0), FrdSub(0), Fscratch(0x15), Fcaps(0xaf),
+        Fcaps2(0xa3), Fmisc(1), FstreamCount(0), FstreamSum(0), FloopWr(0),
+        FfifoRun(false), FfifoOvf(false), FfifoSrc(0),
+        Fattn(0), FattnSnap(0), FattnMask(0) {
+  memset(Fwide, 0, sizeof(Fwide));
+  memset(Floop, 0, sizeof(Floop));
+  memset(Fperf, 0, sizeof(Fperf));
+  memset(FperfSnap, 0, sizeof(FperfSnap));
+  }
+
+//=====================================================================
+void TsimLowLevel::_hwI2cSetSlave(int AslaveAddr) {
+  Fslave = AslaveAddr;
+  }
+
+//---------------------------------------------------------------------
+int TsimLowLevel::_hwI2cWrite(const uint8_t *pWrData, size_t AwrLen) {
+  int res = _accountI2c(AwrLen);
+  if (Fslave == MCP23008_ADDR) {
+    if ((AwrLen >= 2) && (pWrData[0] < sizeof(FmcpRegs)))
+      FmcpRegs[pWrData[0]] = pWrData[1];
+    return BCM2835_I2C_REASON_OK;
+    }
+  if ((Fslave == I2C_APP_ADDR) && (res == BCM2835_I2C_REASON_OK))
+    Fapp.write(pWrData, AwrLen);
+  _attnSample(pDev->nowNs());
+  return res;
+  }
+
+//---------------------------------------------------------------------
+int TsimLowLevel::_hwI2cRead(uint8_t *pRdData, size_t ArdLen) {
+  int res = _accountI2c(ArdLen);
+  memset(pRdData, 0, ArdLen);
+  if (Fslave == MCP23008_ADDR)
+    return BCM2835_I2C_REASON_OK;
+  if ((Fslave == I2C_APP_ADDR) && (res == BCM2835_I2C_REASON_OK))
+    Fapp.read(pRdData, ArdLen);
+  _attnSample(pDev->nowNs());
+  return res;
+  }
+
+//---------------------------------------------------------------------
+// slave address byte included, 9 clocks a byte. Past maxI2cHz the
+// EFB's clock stretching outlasts the BSC timeout.
+int TsimLowLevel::_accountI2c(size_t Alen) {
+  uint64_t clocking = (uint64_t)((Alen + 1) * 9 * 1e9 / Fi2cHz);
+  Fi2cTransactions++;
+  Fi2cBytes += Alen;
+  Fi2cNs    += clocking;
+  pDev->advance(clocking + pDev->timing().i2cOverheadNs);
+  _attnRun(pDev->nowNs());
+
+  if ((Fslave != MCP23008_ADDR) && (Fslave != I2C_APP_ADDR))
+    return BCM2835_I2C_REASON_ERROR_NACK;
+  double maxHz = pDev->timing().maxI2cHz;
+  if ((Fslave == I2C_APP_ADDR) && (maxHz > 0) && (Fi2cHz > maxHz))
+    return BCM2835_I2C_REASON_ERROR_CLKT;
+  return BCM2835_I2C_REASON_OK;
+  }
+
+void TsimLowLevel::_hwI2cSetBaudrate(uint32_t Ahz) {
+  Fi2cHz = Ahz;
+  }
+
+//---------------------------------------------------------------------
+// one transaction: slave address, the register byte, a repeated start
+// and the slave address again, then the data
+int TsimLowLevel::_hwI2cWriteReadRs(const uint8_t *pWrData,
+                                    uint8_t *pRdData, size_t ArdLen) {
+  memset(pRdData, 0, ArdLen);
+  int res = _accountI2c(ArdLen + 2);
+  if (Fslave != MCP23008_ADDR) {
+    if ((Fslave == I2C_APP_ADDR) && (res == BCM2835_I2C_REASON_OK)) {
+      Fapp.write(pWrData, 1);
+      Fapp.read(pRdData, ArdLen);
+      }
+    _attnSample(pDev->nowNs());
+    return res;
+    }
+
+  for (size_t i=0; i<ArdLen; i++) {
+    size_t reg = pWrData[0] + i;
+    if (reg < sizeof(FmcpRegs))
+      pRdData[i] = FmcpRegs[reg];
+    }
+  return BCM2835_I2C_REASON_OK;
+  }
+
+//---------------------------------------------------------------------
+void TsimLowLevel::_hwSpiWrite(const uint8_t *pWrData, size_t AwrLen) {
+  FspiTransactions++;
+  FspiBytes += AwrLen;
+  _account(AwrLen);
+
+  uint8_t local[64];
+  std::vector<uint8_t> big;
+  uint8_t *p = local;
+  if (AwrLen > sizeof(local)) {
+    big.resize(AwrLen);
+    p = &big[0];
+    }
+  memcpy(p, pWrData, AwrLen);
+  _spiDevice(p, AwrLen);
+  }
+
+//---------------------------------------------------------------------
+void TsimLowLevel::_hwSpiTransfer(uint8_t *pData, size_t Alen) {
+  FspiTransactions++;
+  FspiBytes += Alen;
+  _account(Alen);
+  _spiDevice(pData, Alen);
+  }
+
+//---------------------------------------------------------------------
+// the model wants the whole transaction in one buffer
+void TsimLowLevel::_hwSpiSegs(const TspiSeg *pSegs, int AnumSegs) {
+  size_t len = _gather(pSegs, AnumSegs);
+  FspiTransactions++;
+  FspiBytes += len;
+  _account(len);
+  _spiDevice(&Fscratch[0], len);
+  _scatter(pSegs, AnumSegs);
+  }
+
+//---------------------------------------------------------------------
+void TsimLowLevel::_hwSpiSetDivider(int Adivider) {
+  TsimTiming t = pDev->timing();
+  t.spiHz = LL_SPI_CORE_HZ / Adivider;
+  pDev->setTiming(t);
+  }
+
+// CE0 reaches the sysCONFIG port, CE1 the app's SPI slave
+void TsimLowLevel::_hwSpiChipSelect(bool Aconfig) {
+  FappSelected = !Aconfig;
+  }
+
+void TsimLowLevel::_spiDevice(uint8_t *p, size_t Alen) {
+  if (FappSelected) {
+    _attnRun(pDev->nowNs());
+    Fapp.spiTransfer(p, Alen);
+    _attnSample(pDev->nowNs());
+    }
+  else
+    pDev->spiTransfer(p, Alen);
+  }
+
+//---------------------------------------------------------------------
+// the transfer completes before the device acts on the command
+void TsimLowLevel::_account(size_t Alen) {
+  uint64_t clocking = pDev->clockingNs(Alen);
+  FbusNs += clocking;
+  pDev->advance(clocking + pDev->timing().xferOverheadNs);
+  }
+
+//---------------------------------------------------------------------
+// nobody actually sleeps, the modelled clock moves on instead
+void TsimLowLevel::_hwSleep(long ns) {
+  FsleepNs += ns;
+  pDev->advance(ns);
+  }
+
+//---------------------------------------------------------------------
+// the kernel's edge detector, edges are queued only while the line is
+// requested
+void TsimLowLevel::_attnSample(uint64_t AatNs) {
+  bool line = Fapp.attnLevel();
+  if (line && !FattnLine) {
+    FattnEdges++;
+    if (FattnOpen)
+      Fedges.push_back(AatNs);
+    }
+  FattnLine = line;
+  }
+
+// the scheduled events up to AuntilNs, each at its own time
+void TsimLowLevel::_attnRun(uint64_t AuntilNs) {
+  while (!Fscheduled.empty() && (Fscheduled.begin()->first <= AuntilNs)) {
+    uint64_t      at = Fscheduled.begin()->first;
+    TsimAttnEvent ev = Fscheduled.begin()->second;
+    Fscheduled.erase(Fscheduled.begin());
+    for (int i=0; i<ev.fifoBytes; i++) {
+      uint8_t b = ++Fapp.FfifoSrc;
+      Fapp.fifoPush(&b, 1);
+      }
+    Fapp.attnEvent(ev.flags);
+    _attnSample(at);
+    }
+  }
+
+void TsimLowLevel::attnSchedule(uint64_t AatNs, uint8_t Aflags, int AfifoBytes) {
+  TsimAttnEvent ev;
+  ev.flags     = Aflags;
+  ev.fifoBytes = AfifoBytes;
+  Fscheduled.insert(std::make_pair(AatNs, ev));
+  }
+
+//---------------------------------------------------------------------
+bool TsimLowLevel::_hwAttnOpen(int Agpio) {
+  _attnRun(pDev->nowNs());
+  FattnLine = Fapp.attnLevel();
+  FattnOpen = true;
+  Fedges.clear();
+  return true;
+  }
+
+void TsimLowLevel::_hwAttnClose() {
+  FattnOpen = false;
+  Fedges.clear();
+  }
+
+int TsimLowLevel::_hwAttnLevel() {
+  _attnRun(pDev->nowNs());
+  _attnSample(pDev->nowNs());
+  return FattnLine ? 1 : 0;
+  }
+
+// nobody blocks: the modelled clock jumps to the next event, or to the
+// timeout if that comes first. Waiting for ever on nothing is an error.
+int TsimLowLevel::_hwAttnWait(int AtimeoutMs, uint64_t *pTimestampNs) {
+  uint64_t limit = pDev->nowNs() + (uint64_t)AtimeoutMs * 1000000;
+  bool     slept = false;
+
+  for (;;) {
+    uint64_t now = pDev->nowNs();
+    _attnRun(now);
+    _attnSample(now);
+    if (!Fedges.empty()) {
+      *pTimestampNs = Fedges.front();
+      Fedges.pop_front();
+      if (slept)
+        pDev->advance(pDev->timing().attnWakeNs);
+      return 1;
+      }
+    if (Fscheduled.empty() ||
+        ((AtimeoutMs >= 0) && (Fscheduled.begin()->first > limit))) {
+      if (AtimeoutMs < 0)
+        return -1;
+      if (limit > now)
+        pDev->advance(limit - now);
+      return 0;
+      }
+    pDev->advance(Fscheduled.begin()->first - now);
+    slept = true;
+    }
+  }
+
+//---------------------------------------------------------------------
+void TsimLowLevel::resetCounters() {
+  FspiTransactions = 0;
+  FspiBytes        = 0;
+  FbusNs           = 0;
+  FsleepNs         = 0;
+  Fi2cTransactions = 0;
+  Fi2cBytes        = 0;
+  Fi2cNs           = 0;
+  FattnEdges       = 0;
+  }
+
+//---------------------------------------------------------------------
+TsimLowLevel::TsimLowLevel(TsimXO2 *pDevice)
+      : TlowLevel(false), pDev(pDevice), Fslave(-1), Fi2cHz(LL_I2C_DEFAULT_HZ),
+        FappSelected(false), FattnLine(false), FattnOpen(false),
+        FspiTransactions(0), FspiBytes(0), FbusNs(0), FsleepNs(0),
+        Fi2cTransactions(0), Fi2cBytes(0), Fi2cNs(0), FattnEdges(0) {
+  assert(pDev);
+  memset(FmcpRegs, 0, sizeof(FmcpRegs));
+  FmcpRegs[9] = 0xf7;                       // DONE and INITn high
+  }
+
+TsimLowLevel::~TsimLowLevel() {
+  }
+
+// EOF ----------------------------------------------------------------
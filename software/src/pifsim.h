@@ -0,0 +1,243 @@
+// pifsim.h -----------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// a simulated pif board, so that the library can be exercised and
+// benchmarked without a Pi or an XO2 attached
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef pifsimH
+#define pifsimH
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include "lowlevel.h"
+#include "pif.h"
+
+//---------------------------------------------------------------------
+// timing model, all times in ns. These are modelled figures for
+// comparing strategies, not datasheet guarantees.
+struct TsimTiming {
+  double    spiHz;                      // SPI clock
+  long      xferOverheadNs;             // per chip-select assertion
+  long      progPageNs;                 // busy after a page program
+  long      eraseCfgNs;                 // busy after a config erase
+  long      eraseUfmNs;                 // busy after a UFM erase
+  long      progDoneNs;                 // busy after ISC_PROG_DONE
+  double    maxSpiHz;                   // MISO sampled reliably up to, 0 any
+  double    maxI2cHz;                   // app channel keeps up to, 0 any
+  long      i2cOverheadNs;              // per I2C transaction
+  long      attnWakeNs;                 // GPIO edge to the waiter running
+  };
+
+// defaults for a part with AcfgPages config pages, SPI at 7.8MHz
+TsimTiming simDefaultTiming(int AcfgPages);
+
+//---------------------------------------------------------------------
+// model of the XO2 sysCONFIG port as seen over SPI
+class TsimXO2 {
+  private:
+    TsimTiming Ftiming;
+    uint64_t  FnowNs;                   // modelled time
+    uint64_t  FbusyUntilNs;
+    uint32_t  FidCode;
+    uint32_t  Fusercode;
+    uint8_t   FtraceId[8];
+    bool      FcfgEna;
+    bool      Fdone;
+    bool      Ffail;
+    bool      FufmSector;               // address register points at UFM
+    int       Faddr;                    // page address register
+    double    FfaultRate;               // per programmed page
+    uint32_t  Frng;
+
+    uint32_t _random();
+    bool _busy() { return FnowNs < FbusyUntilNs; }
+    void _setBusy(long ns) { FbusyUntilNs = FnowNs + ns; }
+
+    void _put32(uint8_t *p, uint32_t v);
+    void _prog(std::vector<uint8_t>& mem, const uint8_t *p, size_t len);
+    void _read(std::vector<uint8_t>& mem, uint8_t *p, size_t len);
+
+  public:
+    std::vector<uint8_t> Fcfg;          // config flash, CFG_PAGE_SIZE pages
+    std::vector<uint8_t> Fufm;          // UFM, UFM_PAGE_SIZE pages
+    uint64_t  Ffaults;                  // bits flipped so far
+
+    uint32_t statusReg();
+
+    const TsimTiming& timing() { return Ftiming; }
+    void     setTiming(const TsimTiming& t) { Ftiming = t; }
+    uint64_t nowNs() { return FnowNs; }
+
+    // a marginal link: each programmed page has AperPage odds of
+    // arriving with one bit wrong
+    void     setFaultRate(double AperPage, uint32_t Aseed=1) {
+      FfaultRate = AperPage;
+      Frng       = Aseed ? Aseed : 1;
+      }
+    void     advance(uint64_t ns) { FnowNs += ns; }
+
+    // time the SPI clock runs for Alen bytes, overhead excluded
+    uint64_t clockingNs(size_t Alen) {
+      return (uint64_t)(Alen * 8 * 1e9 / Ftiming.spiHz);
+      }
+
+    // one chip-select assertion, MOSI bytes in, MISO bytes out
+    void spiTransfer(uint8_t *pData, size_t Alen);
+
+    TsimXO2(uint32_t AidCode, int AcfgPages, int AufmPages);
+  };
+
+//---------------------------------------------------------------------
+// model of the pif firmware behind I2C_APP_ADDR, see pifwb.vhd and
+// pifctl.vhd. A bytes (00aaaaaa) select a register and reset the read
+// sub-address, D bytes (01dddddd) write it, each read byte returns the
+// next sub-address of the selected register. Symbols written to
+// register 3 are unpacked, counted and summed like the stream sink in
+// pifctl.vhd. The SPI side carries whole bytes, see spiTransfer(), and
+// so does the rest of an I2C write after an X byte (11aaaaaa).
+// Register 4 is the FIFO: a select snapshots the level, a read returns
+// the two byte header and then pops up to that many bytes. Register 16,
+// reachable by X bytes and SPI only, is 16 bytes of 8-bit RAM.
+// Register 5 has the I2C performance counters, the Wishbone side
+// modelled as SIM_WB_PER_BYTE cycles of SIM_CLOCKS_PER_WB clocks.
+// Register 6 latches the attention flags, attnLevel() is the output. A
+// select snapshots them, reading the flags byte clears the snapshot.
+#define SIM_WB_PER_BYTE         3          /* status, interrupt clear, data */
+#define SIM_CLOCKS_PER_WB       4
+
+class TsimApp {
+  private:
+    int       FwrSub;
+    uint8_t   Facc;
+    int       FfifoHdr;                 // header bytes read since select
+    int       FfifoBudget;
+
+    uint8_t   _readByte();
+    void      _select(int Areg);
+    void      _regWrite(uint8_t Avalue);
+    void      _byteWrite(uint8_t Abyte);
+    void      _read(uint8_t *p, size_t Alen);
+    void      _countByte(int Aevent);
+    void      _stream(uint8_t Asym);
+    void      _streamByte(uint8_t Abyte);
+
+  public:
+    uint8_t   Fid;                      // PIF_ID
+    int       Faddr;
+    int       FrdSub;
+    uint8_t   Fscratch;                 // 6 bits
+    uint8_t   Fcaps;                    // R_ID sub-address 3
+    uint8_t   Fcaps2;                   // and 4
+    uint8_t   Fwide[16];
+    uint32_t  Fperf[APP_PERF_COUNTERS]; // 24 bits used, APP_PERF_xxx
+    uint32_t  FperfSnap[APP_PERF_COUNTERS];
+    int       Fmisc;
+    uint16_t  FstreamCount;
+    uint8_t   FstreamSum;
+    uint8_t   Floop[APP_LOOP_BYTES];    // R_STREAM_LOOP
+    int       FloopWr;
+    std::deque<uint8_t> Ffifo;          // APP_FIFO_DEPTH at most
+    bool      FfifoRun;                 // test source
+    bool      FfifoOvf;
+    uint8_t   FfifoSrc;
+    uint8_t   Fattn;                    // APP_ATTN_xxx flags
+    uint8_t   FattnSnap;
+    uint8_t   FattnMask;
+
+    // bytes from the FPGA side, dropped when full like piffifo.vhd
+    void fifoPush(const uint8_t *p, size_t Alen);
+
+    // FPGA events, and the attention output they drive
+    void attnEvent(uint8_t Aflags) { Fattn |= Aflags & APP_ATTN_ALL; }
+    bool attnLevel() { return (Fattn & FattnMask) != 0; }
+
+    void write(const uint8_t *p, size_t Alen);
+    void read(uint8_t *p, size_t Alen);
+
+    // one CE1 transaction: command byte, then write data, or a
+    // turnaround byte and read data. MISO is zero until the read data.
+    void spiTransfer(uint8_t *p, size_t Alen);
+
+    TsimApp();
+  };
+
+//---------------------------------------------------------------------
+// transport that talks to a TsimXO2 instead of the bcm2835 peripherals
+class TsimLowLevel : public TlowLevel {
+  private:
+    TsimXO2  *pDev;
+    int       Fslave;
+    uint8_t   FmcpRegs[11];             // MCP23008 register file
+    TsimApp   Fapp;
+    uint32_t  Fi2cHz;
+    bool      FappSelected;             // CE1 rather than CE0
+
+    // the attention GPIO: scheduled FPGA events, the line as last
+    // seen and the rising edges not yet waited for
+    struct TsimAttnEvent {
+      uint8_t flags;
+      int     fifoBytes;
+      };
+    std::multimap<uint64_t, TsimAttnEvent> Fscheduled;
+    std::deque<uint64_t> Fedges;
+    bool      FattnLine;
+    bool      FattnOpen;
+
+    void _account(size_t Alen);
+    void _spiDevice(uint8_t *p, size_t Alen);
+    int  _accountI2c(size_t Alen);
+    void _attnRun(uint64_t AuntilNs);
+    void _attnSample(uint64_t AatNs);
+
+  protected:
+    virtual void _hwI2cSetSlave(int AslaveAddr);
+    virtual int  _hwI2cWrite(const uint8_t *pWrData, size_t AwrLen);
+    virtual int  _hwI2cRead(uint8_t *pRdData, size_t ArdLen);
+    virtual int  _hwI2cWriteReadRs(const uint8_t *pWrData,
+                                            uint8_t *pRdData, size_t ArdLen);
+    virtual void _hwSpiWrite(const uint8_t *pWrData, size_t AwrLen);
+    virtual void _hwSpiTransfer(uint8_t *pData, size_t Alen);
+    virtual void _hwSpiSegs(const TspiSeg *pSegs, int AnumSegs);
+    virtual void _hwSpiSetDivider(int Adivider);
+    virtual void _hwSpiChipSelect(bool Aconfig);
+    virtual void _hwI2cSetBaudrate(uint32_t Ahz);
+    virtual void _hwSleep(long ns);
+    virtual bool _hwAttnOpen(int Agpio);
+    virtual void _hwAttnClose();
+    virtual int  _hwAttnWait(int AtimeoutMs, uint64_t *pTimestampNs);
+    virtual int  _hwAttnLevel();
+
+  public:
+    // traffic counters, handy for benchmarks
+    uint64_t  FspiTransactions;
+    uint64_t  FspiBytes;
+    uint64_t  FbusNs;                   // time the SPI clock was running
+    uint64_t  FsleepNs;
+    uint64_t  Fi2cTransactions;
+    uint64_t  Fi2cBytes;
+    uint64_t  Fi2cNs;                   // time the I2C clock was running
+    uint64_t  FattnEdges;               // rising edges on the GPIO
+
+    TsimXO2 *device() { return pDev; }
+    TsimApp *app()    { return &Fapp; }
+    void     resetCounters();
+
+    // an FPGA event at modelled time AatNs: the flags are raised and
+    // AfifoBytes counting bytes pushed, as the firmware would. Events
+    // happen when the modelled clock passes them; a wait moves it on
+    // to the next one.
+    void     attnSchedule(uint64_t AatNs, uint8_t Aflags, int AfifoBytes=0);
+
+    TsimLowLevel(TsimXO2 *pDevice);
+    virtual ~TsimLowLevel();
+  };
+
+#endif
+// EOF ----------------------------------------------------------------
@@ -17,8 +17,17 @@
 
 #include "pifwrap.h"
 #include "pif.h"
+#include "ufm.h"
+#include "ufmkv.h"
+#include "ufmhash.h"
+#include "spitune.h"
+#include "i2ctune.h"
+#include "appshadow.h"
 
 #define pPif ((Tpif *)h)
+#define pUfm ((TufmSession *)u)
+#define pKv  ((TufmKV *)kv)
+#define pHt  ((TufmHashTable *)ht)
 
 //---------------------------------------------------------------------
 int pifVersion(char *outStr, int outLen) {
@@ -76,6 +85,12 @@ int pifReadCfgPages(pifHandle h, int numPages, uint8_t *p) {
 int pifEraseUfm(pifHandle h) {
   return pPif->eraseUfm();
   }
+int pifSetUfmPageAddr(pifHandle h, int pageNumber) {
+  return pPif->setUfmPageAddr(pageNumber);
+  }
+int pifProgUfmPage(pifHandle h, const uint8_t *p) {
+  return pPif->progUfmPage(p);
+  }
 int pifReadUfmPages(pifHandle h, int numPages, uint8_t *p) {
   return pPif->readUfmPages(numPages, p);
   }
@@ -85,6 +100,105 @@ int pifReadUfmPages(pifHandle h, int pageNumber, int numPages, uint8_t *p) {
 int pifWriteUfmPages(pifHandle h, int pageNumber, int numPages, uint8_t *p) {
   return pPif->writeUfmPages(pageNumber, numPages, p);
   }
+
+pifUfmHandle pifUfmOpen(pifHandle h) {
+  TufmSession *s = new TufmSession(*pPif);
+  if (!s->isOpen()) {
+    delete s;
+    s = 0;
+    }
+  return (pifUfmHandle)s;
+  }
+int pifUfmRead(pifUfmHandle u, int pageNumber, int numPages, uint8_t *p) {
+  return pUfm->read(pageNumber, numPages, p);
+  }
+int pifUfmWrite(pifUfmHandle u, int pageNumber, int numPages, const uint8_t *p) {
+  return pUfm->write(pageNumber, numPages, p);
+  }
+int pifUfmErase(pifUfmHandle u) {
+  return pUfm->erase();
+  }
+int pifUfmNumPages(pifUfmHandle u) {
+  return pUfm->numPages();
+  }
+int pifUfmClose(pifUfmHandle u) {
+  int ok = pUfm->close();
+  delete pUfm;
+  return ok;
+  }
+int pifUfmCacheEnable(pifHandle h, int maxPages) {
+  return pPif->enableUfmCache(maxPages);
+  }
+int pifUfmCacheFlush(pifHandle h) {
+  return pPif->flushUfmCache();
+  }
+int pifUfmCacheDisable(pifHandle h) {
+  return pPif->disableUfmCache();
+  }
+
+pifKvHandle pifKvOpen(pifHandle h) {
+  return pifKvOpenSpill(h, 0);
+  }
+pifKvHandle pifKvOpenSpill(pifHandle h, const char *spillPath) {
+  TufmKV *kv = new TufmKV(*pPif, spillPath);
+  if (!kv->open()) {
+    delete kv;
+    kv = 0;
+    }
+  return (pifKvHandle)kv;
+  }
+int pifKvGet(pifKvHandle kv, const char *key, uint8_t *p, int bufLen) {
+  return pKv->get(key, p, bufLen);
+  }
+int pifKvPut(pifKvHandle kv, const char *key, const uint8_t *p, int len) {
+  return pKv->put(key, p, len);
+  }
+int pifKvDelete(pifKvHandle kv, const char *key) {
+  return pKv->remove(key);
+  }
+int pifKvClose(pifKvHandle kv) {
+  int ok = pKv->close();
+  delete pKv;
+  return ok;
+  }
+
+pifHashHandle pifHashOpen(pifHandle h, int startPage) {
+  TufmHashTable *ht = new TufmHashTable(*pPif);
+  if (!ht->open(startPage)) {
+    delete ht;
+    ht = 0;
+    }
+  return (pifHashHandle)ht;
+  }
+int pifHashLookup(pifHashHandle ht, const uint8_t *key, uint8_t *val) {
+  return pHt->lookup(key, val);
+  }
+int pifHashClose(pifHashHandle ht) {
+  int ok = pHt->close();
+  delete pHt;
+  return ok;
+  }
+
+int pifSpiSetDivider(pifHandle h, int divider) {
+  return pPif->setSpiDivider(divider);
+  }
+int pifSpiGetDivider(pifHandle h) {
+  return pPif->spiDivider();
+  }
+int pifSpiTune(pifHandle h, const char *profilePath, int recalibrate) {
+  return spiTune(*pPif, profilePath, recalibrate != 0);
+  }
+
+int pifI2cSetRate(pifHandle h, uint32_t hz) {
+  return pPif->setI2cRate(hz);
+  }
+uint32_t pifI2cGetRate(pifHandle h) {
+  return pPif->i2cRate();
+  }
+uint32_t pifI2cProbe(pifHandle h) {
+  return i2cProbe(*pPif);
+  }
+
 int pifGetBusyFlag(pifHandle h, int *pFlag) {
   return pPif->getBusyFlag(pFlag);
   }
@@ -111,6 +225,98 @@ int pifAppRead(pifHandle h, uint8_t *p, int AnumBytes) {
 int pifAppWrite(pifHandle h, uint8_t *p, int AnumBytes) {
   return pPif->appWrite(p, AnumBytes);
   }
+int pifRegWrite(pifHandle h, int reg, const uint8_t *values, int n) {
+  return pPif->regWrite(reg, values, n);
+  }
+int pifRegRead(pifHandle h, int reg, uint8_t *values, int n) {
+  return pPif->regRead(reg, values, n);
+  }
+int pifAppStreamWrite(pifHandle h, int reg, const uint8_t *p, int n) {
+  return pPif->appStreamWrite(reg, p, n);
+  }
+int pifAppStreamRead(pifHandle h, int reg, uint8_t *p, int n) {
+  return pPif->appStreamRead(reg, p, n);
+  }
+int pifAppCaps(pifHandle h) {
+  return pPif->appCaps(true);
+  }
+int pifXRegWrite(pifHandle h, int reg, const uint8_t *p, int n) {
+  return pPif->xRegWrite(reg, p, n);
+  }
+int pifXRegRead(pifHandle h, int reg, uint8_t *p, int n) {
+  return pPif->xRegRead(reg, p, n);
+  }
+int pifAppPerfRead(pifHandle h, uint32_t *counters, int n) {
+  uint32_t c[APP_PERF_COUNTERS];
+  if (!pPif->appPerfRead(c))
+    return false;
+  if (n > APP_PERF_COUNTERS)
+    n = APP_PERF_COUNTERS;
+  for (int i=0; i<n; i++)
+    counters[i] = c[i];
+  return true;
+  }
+int pifAppPerfClear(pifHandle h) {
+  return pPif->appPerfClear();
+  }
+static void attnStatus(const TappAttn& a, uint64_t *status, int n) {
+  uint64_t v[7] = { a.flags, a.mask, (uint64_t)a.fifoLevel, a.fifoOverflow,
+                    a.streamCount, a.timestampNs, (uint64_t)a.edges };
+  if (n > 7)
+    n = 7;
+  for (int i=0; i<n; i++)
+    status[i] = v[i];
+  }
+int pifAppAttnOpen(pifHandle h, int gpio) {
+  return pPif->appAttnOpen((gpio < 0) ? LL_ATTN_GPIO : gpio);
+  }
+void pifAppAttnClose(pifHandle h) {
+  pPif->appAttnClose();
+  }
+int pifAppAttnEnable(pifHandle h, int mask) {
+  return pPif->appAttnEnable((uint8_t)mask);
+  }
+int pifAppAttnRaise(pifHandle h, int flags) {
+  return pPif->appAttnRaise((uint8_t)flags);
+  }
+int pifAppAttnRead(pifHandle h, uint64_t *status, int n) {
+  TappAttn a;
+  if (!pPif->appAttnRead(&a))
+    return false;
+  attnStatus(a, status, n);
+  return true;
+  }
+int pifAppAttnWait(pifHandle h, int timeoutMs, uint64_t *status, int n) {
+  TappAttn a;
+  int res = pPif->appAttnWait(&a, timeoutMs);
+  if (res > 0)
+    attnStatus(a, status, n);
+  return res;
+  }
+int pifAppReadFifo(pifHandle h, uint8_t *buf, int n) {
+  return pPif->appReadFifo(buf, n);
+  }
+int pifShadowSet(pifHandle h, int reg, int value) {
+  return pPif->shadow()->set(reg, (uint8_t)value);
+  }
+int pifShadowGet(pifHandle h, int reg, uint8_t *value) {
+  return pPif->shadow()->get(reg, value);
+  }
+int pifShadowFlush(pifHandle h) {
+  return pPif->shadow()->flush();
+  }
+int pifShadowSync(pifHandle h) {
+  return pPif->shadow()->sync();
+  }
+int pifAppSpiTransfer(pifHandle h, const uint8_t *wr, uint8_t *rd, int n) {
+  return pPif->appSpiTransfer(wr, rd, n);
+  }
+int pifAppSpiWrite(pifHandle h, int reg, const uint8_t *p, int n) {
+  return pPif->appSpiWrite(reg, p, n);
+  }
+int pifAppSpiRead(pifHandle h, int reg, uint8_t *p, int n) {
+  return pPif->appSpiRead(reg, p, n);
+  }
 
 pifHandle pifInit() {
   return (pifHandle)(new Tpif());
@@ -37,6 +37,9 @@
 #endif
 
 typedef void * pifHandle;
+typedef void * pifUfmHandle;
+typedef void * pifKvHandle;
+typedef void * pifHashHandle;
 
 //---------------------------------------------------------------------
 #ifdef __cplusplus
@@ -64,9 +67,55 @@ PIF_API int  pifProgCfgPage(pifHandle h, const uint8_t *p);
 PIF_API int  pifReadCfgPages(pifHandle h, int numPages, uint8_t *p);
 
 PIF_API int  pifEraseUfm(pifHandle h);
+PIF_API int  pifSetUfmPageAddr(pifHandle h, int pageNumber);
+PIF_API int  pifProgUfmPage(pifHandle h, const uint8_t *p);
 PIF_API int  pifReadUfmPages(pifHandle h, int pageNumber, int numPages, uint8_t *p);
 PIF_API int  pifWriteUfmPages(pifHandle h, int pageNumber, int numPages, uint8_t *p);
 
+// UFM session, the config interface stays enabled until pifUfmClose()
+PIF_API pifUfmHandle pifUfmOpen(pifHandle h);
+PIF_API int  pifUfmRead(pifUfmHandle u, int pageNumber, int numPages, uint8_t *p);
+PIF_API int  pifUfmWrite(pifUfmHandle u, int pageNumber, int numPages, const uint8_t *p);
+PIF_API int  pifUfmErase(pifUfmHandle u);
+PIF_API int  pifUfmNumPages(pifUfmHandle u);
+PIF_API int  pifUfmClose(pifUfmHandle u);
+
+// write-back cache under pifReadUfmPages()/pifWriteUfmPages(),
+// maxPages 0 means no bound
+PIF_API int  pifUfmCacheEnable(pifHandle h, int maxPages);
+PIF_API int  pifUfmCacheFlush(pifHandle h);
+PIF_API int  pifUfmCacheDisable(pifHandle h);
+
+// key/value store kept in the UFM, see ufmkv.h. pifKvGet() returns
+// the value length or -1. With a spill file a power loss during a
+// compaction loses nothing, without one it may lose the store.
+PIF_API pifKvHandle pifKvOpen(pifHandle h);
+PIF_API pifKvHandle pifKvOpenSpill(pifHandle h, const char *spillPath);
+PIF_API int  pifKvGet(pifKvHandle kv, const char *key, uint8_t *p, int bufLen);
+PIF_API int  pifKvPut(pifKvHandle kv, const char *key, const uint8_t *p, int len);
+PIF_API int  pifKvDelete(pifKvHandle kv, const char *key);
+PIF_API int  pifKvClose(pifKvHandle kv);
+
+// read-only hash table built by pifhash, see ufmhash.h. A lookup is
+// one UFM page read, returns 1 if the key was found
+PIF_API pifHashHandle pifHashOpen(pifHandle h, int startPage);
+PIF_API int  pifHashLookup(pifHashHandle ht, const uint8_t *key, uint8_t *val);
+PIF_API int  pifHashClose(pifHashHandle ht);
+
+// SPI clock = 250MHz / divider. pifSpiTune() uses the divider stored
+// for this board in profilePath, or calibrates and stores it; returns
+// the divider in use, 0 on failure. See spitune.h
+PIF_API int  pifSpiSetDivider(pifHandle h, int divider);
+PIF_API int  pifSpiGetDivider(pifHandle h);
+PIF_API int  pifSpiTune(pifHandle h, const char *profilePath, int recalibrate);
+
+// I2C rate in Hz, up to 1MHz (Fast-mode Plus). pifI2cProbe() runs the
+// scratch register loopback at rising rates and leaves the fastest
+// clean one set, see i2ctune.h. Returns the rate, 0 on failure.
+PIF_API int  pifI2cSetRate(pifHandle h, uint32_t hz);
+PIF_API uint32_t pifI2cGetRate(pifHandle h);
+PIF_API uint32_t pifI2cProbe(pifHandle h);
+
 PIF_API int  pifGetBusyFlag(pifHandle h, int *pFlag);
 PIF_API int  pifWaitUntilNotBusy(pifHandle h, int maxLoops);
 
@@ -81,6 +130,63 @@ PIF_API int  pifMcpRead(pifHandle h, int reg, uint8_t* v);
 PIF_API int  pifAppRead(pifHandle h, uint8_t *p, int AnumBytes);
 PIF_API int  pifAppWrite(pifHandle h, uint8_t *p, int AnumBytes);
 
+// tagged register access, address and data in one I2C transaction.
+// Values are six bits, n up to 128 (the sub-address range).
+PIF_API int  pifRegWrite(pifHandle h, int reg, const uint8_t *values, int n);
+PIF_API int  pifRegRead(pifHandle h, int reg, uint8_t *values, int n);
+
+// APP_CAP_xxx bits from the R_ID capabilities byte, 0 for older
+// firmware, -1 on a bus error. Extended access reaches registers 0..63
+// with 8-bit data and fails if the firmware lacks APP_CAP_XADDR.
+PIF_API int  pifAppCaps(pifHandle h);
+PIF_API int  pifXRegWrite(pifHandle h, int reg, const uint8_t *p, int n);
+PIF_API int  pifXRegRead(pifHandle h, int reg, uint8_t *p, int n);
+
+// the firmware's I2C counters, at most n of: bytes received, bytes
+// sent, address bytes, data bytes, NAKs, Wishbone cycles, restarts and
+// FPGA clocks spent on bytes. 24 bits, they wrap.
+PIF_API int  pifAppPerfRead(pifHandle h, uint32_t *counters, int n);
+PIF_API int  pifAppPerfClear(pifHandle h);
+
+// FPGA events on the attention GPIO instead of polling. Open takes
+// the GPIO number, -1 for the default (25). The status is up to n of:
+// flags, enable mask, FIFO level, FIFO overflow, stream count, edge
+// timestamp in ns and edges. Wait returns 1 with it, 0 on a timeout
+// (timeoutMs -1 waits for ever), -1 on an error; read does not wait.
+PIF_API int  pifAppAttnOpen(pifHandle h, int gpio);
+PIF_API void pifAppAttnClose(pifHandle h);
+PIF_API int  pifAppAttnEnable(pifHandle h, int mask);
+PIF_API int  pifAppAttnRaise(pifHandle h, int flags);
+PIF_API int  pifAppAttnRead(pifHandle h, uint64_t *status, int n);
+PIF_API int  pifAppAttnWait(pifHandle h, int timeoutMs, uint64_t *status, int n);
+
+// drains up to n bytes from the FIFO register, usually in one I2C
+// transaction. Returns the count read, -1 on a bus error. The test
+// source is controlled with pifRegWrite to register 4, see pifdefs.vhd.
+PIF_API int  pifAppReadFifo(pifHandle h, uint8_t *buf, int n);
+
+// host copy of the 16 app registers. Sets are combined until a flush,
+// which sends every changed register in one I2C transaction. Get
+// answers from the copy, 0 if the register was never set or synced.
+// Sync loads the scratch and misc values from the R_ID register.
+PIF_API int  pifShadowSet(pifHandle h, int reg, int value);
+PIF_API int  pifShadowGet(pifHandle h, int reg, uint8_t *value);
+PIF_API int  pifShadowFlush(pifHandle h);
+PIF_API int  pifShadowSync(pifHandle h);
+
+// 8-bit data over the 6-bit channel, 3 bytes packed into 4 symbols.
+// See appcodec.h for the format, W_STREAM_REG in pifdefs.vhd for the
+// firmware side. A read needs a register that sends symbols back,
+// R_STREAM_LOOP (7) here, which repeats the last write's first 96 bytes.
+PIF_API int  pifAppStreamWrite(pifHandle h, int reg, const uint8_t *p, int n);
+PIF_API int  pifAppStreamRead(pifHandle h, int reg, uint8_t *p, int n);
+
+// the app port on SPI CE1, 8-bit data and no tags, see pifwb.vhd.
+// A transfer is raw full duplex, either buffer may be NULL.
+PIF_API int  pifAppSpiTransfer(pifHandle h, const uint8_t *wr, uint8_t *rd, int n);
+PIF_API int  pifAppSpiWrite(pifHandle h, int reg, const uint8_t *p, int n);
+PIF_API int  pifAppSpiRead(pifHandle h, int reg, uint8_t *p, int n);
+
 PIF_API pifHandle pifInit();
 PIF_API void      pifClose(pifHandle h);
 
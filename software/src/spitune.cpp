@@ -0,0 +1,157 @@
+// spitune.cpp --------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "spitune.h"
+
+//---------------------------------------------------------------------
+// what the board reads back at the current clock
+static bool readSample(Tpif& pif, uint32_t& idCode, uint8_t *pPages) {
+  bool ok = pif.getDeviceIdCode(idCode);
+  ok = ok && pif.initCfgAddr();
+  ok = ok && pif.readCfgPages(SPI_TUNE_PAGES, pPages);
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+int spiCalibrate(Tpif& Apif, TspiTuneResult *pResult) {
+  TspiTuneResult res;
+  memset(&res, 0, sizeof(res));
+
+  uint8_t  ref[SPI_TUNE_PAGES * CFG_PAGE_SIZE];
+  uint8_t  buf[SPI_TUNE_PAGES * CFG_PAGE_SIZE];
+  uint32_t refId = 0, id;
+
+  bool ok = Apif.setSpiDivider(LL_SPI_DEFAULT_DIVIDER);
+  ok = ok && Apif.enableCfgInterfaceTransparent();
+  ok = ok && readSample(Apif, refId, ref) && (refId != 0);
+  if (ok) {
+    res.fastestPass = LL_SPI_DEFAULT_DIVIDER;
+    for (int div=LL_SPI_DEFAULT_DIVIDER/2; div>=SPI_TUNE_FASTEST; div/=2) {
+      bool pass = Apif.setSpiDivider(div);
+      for (int i=0; pass && (i<SPI_TUNE_PASSES); i++) {
+        res.checks++;
+        pass = readSample(Apif, id, buf) && (id == refId) &&
+                                           (memcmp(buf, ref, sizeof(ref)) == 0);
+        }
+      if (!pass) {
+        res.firstFail = div;
+        break;
+        }
+      res.fastestPass = div;
+      }
+
+    res.divider = res.fastestPass;
+    for (int i=0; i<SPI_TUNE_MARGIN; i++)
+      if (res.divider < LL_SPI_DEFAULT_DIVIDER)
+        res.divider *= 2;
+    }
+
+  // the interface is left at a clock that works, whatever happened
+  Apif.setSpiDivider(res.divider ? res.divider : LL_SPI_DEFAULT_DIVIDER);
+  ok = Apif.disableCfgInterface() && ok;
+  if (!ok)
+    res.divider = 0;
+  if (pResult)
+    *pResult = res;
+  return res.divider;
+  }
+
+//---------------------------------------------------------------------
+static std::string traceHex(const uint8_t *p) {
+  char s[17];
+  for (int i=0; i<8; i++)
+    sprintf(s + 2*i, "%02x", p[i]);
+  return std::string(s, 16);
+  }
+
+//---------------------------------------------------------------------
+bool spiProfileLoad(const char *Apath, const uint8_t *pTraceId, int *pDivider) {
+  FILE *fd = fopen(Apath, "r");
+  if (!fd)
+    return false;
+
+  std::string trace = traceHex(pTraceId);
+  bool found = false;
+  char line[80], key[32];
+  int  div;
+  while (!found && fgets(line, sizeof(line), fd))
+    if ((sscanf(line, "%31s %d", key, &div) == 2) && (trace == key) &&
+                                    (div >= 2) && (div <= 65536) && !(div & 1)) {
+      *pDivider = div;
+      found = true;
+      }
+  fclose(fd);
+  return found;
+  }
+
+//---------------------------------------------------------------------
+// other boards' lines are kept, the file is replaced in one rename()
+bool spiProfileSave(const char *Apath, const uint8_t *pTraceId, int Adivider) {
+  std::string trace = traceHex(pTraceId);
+  std::vector<std::string> lines;
+  char line[80], key[32];
+
+  FILE *fd = fopen(Apath, "r");
+  if (fd) {
+    while (fgets(line, sizeof(line), fd))
+      if ((sscanf(line, "%31s", key) == 1) && (trace != key))
+        lines.push_back(line);
+    fclose(fd);
+    }
+  sprintf(line, "%s %d\n", trace.c_str(), Adivider);
+  lines.push_back(line);
+
+  std::string tmp = std::string(Apath) + ".tmp";
+  fd = fopen(tmp.c_str(), "w");
+  if (!fd)
+    return false;
+  bool ok = true;
+  for (size_t i=0; i<lines.size(); i++)
+    ok = ok && (fputs(lines[i].c_str(), fd) >= 0);
+  ok = (fclose(fd) == 0) && ok;
+  ok = ok && (rename(tmp.c_str(), Apath) == 0);
+  if (!ok)
+    remove(tmp.c_str());
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+int spiTune(Tpif& Apif, const char *Apath, bool AforceCalibrate) {
+  uint8_t  traceId[8];
+  uint32_t idCode = 0, check = 0;
+  int      div;
+
+  if (!Apif.setSpiDivider(LL_SPI_DEFAULT_DIVIDER) ||
+      !Apif.getTraceId(traceId) || !Apif.getDeviceIdCode(idCode))
+    return 0;
+
+  // a stored clock that no longer reads the IDCODE (another cable, say)
+  // is calibrated again
+  if (!AforceCalibrate && spiProfileLoad(Apath, traceId, &div) &&
+                                              Apif.setSpiDivider(div)) {
+    bool ok = true;
+    for (int i=0; ok && (i<SPI_TUNE_PASSES); i++)
+      ok = Apif.getDeviceIdCode(check) && (check == idCode);
+    if (ok)
+      return div;
+    }
+
+  div = spiCalibrate(Apif);
+  if (div)
+    spiProfileSave(Apath, traceId, div);
+  return div;
+  }
+
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,46 @@
+// spitune.h ----------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// finds the fastest SPI clock a board and cable read back reliably,
+// and remembers it per board
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef spituneH
+#define spituneH
+
+#include "pif.h"
+
+#define SPI_TUNE_FASTEST        2         /* 125MHz, nothing passes that */
+#define SPI_TUNE_PASSES         8         /* checks per divider */
+#define SPI_TUNE_PAGES          32        /* config pages per readback */
+#define SPI_TUNE_MARGIN         1         /* steps back from the fastest pass */
+
+//---------------------------------------------------------------------
+struct TspiTuneResult {
+  int       divider;                    // chosen, 0 if calibration failed
+  int       fastestPass;                // fastest divider with no errors
+  int       firstFail;                  // 0 if none failed
+  int       checks;                     // IDCODE + readback checks run
+  };
+
+// Halves the divider from LL_SPI_DEFAULT_DIVIDER on, each step has to
+// pass SPI_TUNE_PASSES rounds of IDCODE and config readback compared to
+// what was read at the default clock. The device keeps running, the
+// config interface is used in transparent mode. The chosen divider is
+// SPI_TUNE_MARGIN steps slower than the fastest pass and is left set.
+int spiCalibrate(Tpif& Apif, TspiTuneResult *pResult=0);
+
+// the profile is a text file, one "<TraceID hex> <divider>" per board
+bool spiProfileLoad(const char *Apath, const uint8_t *pTraceId, int *pDivider);
+bool spiProfileSave(const char *Apath, const uint8_t *pTraceId, int Adivider);
+
+// the profile's divider for this board if it still reads the IDCODE,
+// otherwise calibrate and save it.
+// Returns the divider now in use, 0 on failure.
+int spiTune(Tpif& Apif, const char *Apath, bool AforceCalibrate=false);
+
+#endif
+// EOF ----------------------------------------------------------------
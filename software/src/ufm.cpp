@@ -0,0 +1,116 @@
+// ufm.cpp ------------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <assert.h>
+
+#include "ufm.h"
+#include "ufmcache.h"
+#include "xo2.h"
+
+//---------------------------------------------------------------------
+bool TufmSession::open() {
+  if (Fopen)
+    return true;
+
+  uint32_t idCode = 0;
+  const Txo2Device *dev = 0;
+  if (Fpif.getDeviceIdCode(idCode))
+    dev = xo2FindDevice(idCode);
+  FnumPages = dev ? dev->ufmPages : UFM_PAGE_COUNT;
+
+  Fopen     = Fpif.enableCfgInterfaceTransparent();
+  Fwritten  = false;
+  FnextPage = -1;
+  return Fopen;
+  }
+
+//---------------------------------------------------------------------
+// a read-only session never touches DONE
+bool TufmSession::close() {
+  if (!Fopen)
+    return true;
+  Fopen = false;
+
+  bool ok = Fpif.waitUntilNotBusy(-1);
+  if (Fwritten)
+    ok = Fpif.progDone() && ok;
+  ok = Fpif.disableCfgInterface() && ok;
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+bool TufmSession::_seek(int pageNumber) {
+  if (pageNumber == FnextPage)
+    return true;
+  FnextPage = -1;
+  bool ok = Fpif.setUfmPageAddr(pageNumber);
+  if (ok)
+    FnextPage = pageNumber;
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+bool TufmSession::read(int pageNumber, int numPages, uint8_t *p) {
+  assert(p);
+  if (!Fopen || (pageNumber < 0) || (numPages < 0) ||
+                                    (pageNumber + numPages > FnumPages))
+    return false;
+
+  bool ok = _seek(pageNumber);
+  ok = ok && Fpif.readUfmPages(numPages, p);
+  FnextPage = ok ? pageNumber + numPages : -1;
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+bool TufmSession::_program(int pageNumber, int numPages, const uint8_t *p) {
+  assert(p);
+  if (!Fopen || (pageNumber < 0) || (numPages < 0) ||
+                                    (pageNumber + numPages > FnumPages))
+    return false;
+
+  bool ok = _seek(pageNumber);
+  for (int i=0; ok && (i<numPages); i++)
+    ok = Fpif.progUfmPage(p + UFM_PAGE_SIZE*i);
+  Fwritten  = Fwritten || (numPages > 0);
+  FnextPage = ok ? pageNumber + numPages : -1;
+  return ok;
+  }
+
+// the cached copies are stale now, dirty ones included
+bool TufmSession::write(int pageNumber, int numPages, const uint8_t *p) {
+  bool ok = _program(pageNumber, numPages, p);
+  if (Fpif.ufmCache())
+    Fpif.ufmCache()->invalidate(pageNumber, numPages);
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+bool TufmSession::erase() {
+  if (!Fopen)
+    return false;
+  bool ok = Fpif.eraseUfm();
+  ok = Fpif.waitUntilNotBusy(-1) && ok;
+  Fwritten  = true;
+  FnextPage = -1;
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+TufmSession::TufmSession(Tpif& Apif, bool AopenNow)
+      : Fpif(Apif), Fopen(false), Fwritten(false),
+        FnumPages(UFM_PAGE_COUNT), FnextPage(-1) {
+  if (AopenNow)
+    open();
+  }
+
+TufmSession::~TufmSession() {
+  close();
+  }
+
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,51 @@
+// ufm.h --------------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// UFM access that keeps the config interface open between operations
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef ufmH
+#define ufmH
+
+#include <stdint.h>
+
+#include "pif.h"
+
+//---------------------------------------------------------------------
+// transparent mode is entered once by open() (or the constructor) and
+// left by close() (or the destructor). In between, reads and writes
+// go to any page and only cost an address set when they are not
+// sequential. The FPGA keeps running throughout. Pages written here
+// are dropped from Tpif's UFM cache, if there is one.
+class TufmSession {
+  private:
+    Tpif&   Fpif;
+    bool    Fopen;
+    bool    Fwritten;                   // pages programmed since open()
+    int     FnumPages;
+    int     FnextPage;                  // address register, -1 if unknown
+
+    bool _seek(int pageNumber);
+    bool _program(int pageNumber, int numPages, const uint8_t *p);
+
+    friend class TufmCache;             // flush() programs through _program()
+
+  public:
+    bool open();
+    bool close();
+    bool isOpen() { return Fopen; }
+    int  numPages() { return FnumPages; }
+
+    bool read(int pageNumber, int numPages, uint8_t *p);
+    bool write(int pageNumber, int numPages, const uint8_t *p);
+    bool erase();                       // the whole UFM sector
+
+    TufmSession(Tpif& Apif, bool AopenNow=true);
+    ~TufmSession();
+  };
+
+#endif
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,166 @@
+// ufmcache.cpp -------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <assert.h>
+#include <string.h>
+
+#include "ufmcache.h"
+#include "ufm.h"
+#include "xo2.h"
+
+//---------------------------------------------------------------------
+// finds or inserts the page and makes it the most recently used
+TufmCache::Tpage& TufmCache::_touch(int pageNumber) {
+  TpageMap::iterator it = Fpages.find(pageNumber);
+  if (it != Fpages.end()) {
+    Flru.splice(Flru.begin(), Flru, it->second.Flru);
+    return it->second;
+    }
+  Tpage& pg = Fpages[pageNumber];
+  pg.Fdirty = false;
+  Flru.push_front(pageNumber);
+  pg.Flru = Flru.begin();
+  return pg;
+  }
+
+//---------------------------------------------------------------------
+// runs with no session open, flush() opens its own
+void TufmCache::_trim() {
+  if (FmaxPages == UFM_CACHE_ALL)
+    return;
+  while ((int)Fpages.size() > FmaxPages) {
+    TpageMap::iterator it = Fpages.find(Flru.back());
+    if (it->second.Fdirty && !flush())
+      return;
+    Fpages.erase(it);
+    Flru.pop_back();
+    }
+  }
+
+//---------------------------------------------------------------------
+// the UFM size of the device, as TufmSession::open() finds it
+int TufmCache::_numPages() {
+  if (FnumPages == 0) {
+    uint32_t idCode = 0;
+    const Txo2Device *dev = 0;
+    if (Fpif.getDeviceIdCode(idCode))
+      dev = xo2FindDevice(idCode);
+    FnumPages = dev ? dev->ufmPages : UFM_PAGE_COUNT;
+    }
+  return FnumPages;
+  }
+
+//---------------------------------------------------------------------
+bool TufmCache::read(int pageNumber, int numPages, uint8_t *p) {
+  assert(p);
+  TufmSession session(Fpif, false);
+  bool ok = true;
+
+  for (int i=0; ok && (i<numPages); ) {
+    TpageMap::iterator it = Fpages.find(pageNumber + i);
+    if (it != Fpages.end()) {
+      Flru.splice(Flru.begin(), Flru, it->second.Flru);
+      memcpy(p + UFM_PAGE_SIZE*i, it->second.Fdata, UFM_PAGE_SIZE);
+      Fhits++;
+      i++;
+      continue;
+      }
+
+    // fetch the whole run of missing pages in one go
+    int n = 1;
+    while ((i+n < numPages) && (Fpages.find(pageNumber + i + n) == Fpages.end()))
+      n++;
+    ok = session.open() && session.read(pageNumber + i, n, p + UFM_PAGE_SIZE*i);
+    for (int j=0; ok && (j<n); j++)
+      memcpy(_touch(pageNumber + i + j).Fdata, p + UFM_PAGE_SIZE*(i+j), UFM_PAGE_SIZE);
+    Fmisses += n;
+    i += n;
+    }
+  ok = session.close() && ok;
+  _trim();
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+bool TufmCache::write(int pageNumber, int numPages, const uint8_t *p) {
+  assert(p);
+  if ((pageNumber < 0) || (numPages < 0) ||
+                           (pageNumber + numPages > _numPages()))
+    return false;
+  for (int i=0; i<numPages; i++) {
+    Tpage& pg = _touch(pageNumber + i);
+    memcpy(pg.Fdata, p + UFM_PAGE_SIZE*i, UFM_PAGE_SIZE);
+    pg.Fdirty = true;
+    }
+  _trim();
+  return true;
+  }
+
+//---------------------------------------------------------------------
+// the map is ordered, so dirty pages come out as ascending runs
+bool TufmCache::flush() {
+  if (dirtyPages() == 0)
+    return true;
+
+  TufmSession session(Fpif);
+  bool ok = session.isOpen();
+  TpageMap::iterator it = Fpages.begin();
+  while (ok && (it != Fpages.end())) {
+    if (!it->second.Fdirty) {
+      ++it;
+      continue;
+      }
+    int first = it->first;
+    int n = 0;
+    for (; ok && (it != Fpages.end()) && it->second.Fdirty &&
+                                         (it->first == first + n); ++it, n++) {
+      ok = session._program(first + n, 1, it->second.Fdata);
+      it->second.Fdirty = !ok;
+      }
+    Fflushed += n;
+    Fruns++;
+    }
+  ok = session.close() && ok;
+  return ok;
+  }
+
+//---------------------------------------------------------------------
+void TufmCache::invalidate() {
+  Fpages.clear();
+  Flru.clear();
+  }
+
+void TufmCache::invalidate(int pageNumber, int numPages) {
+  for (int i=0; i<numPages; i++) {
+    TpageMap::iterator it = Fpages.find(pageNumber + i);
+    if (it == Fpages.end())
+      continue;
+    Flru.erase(it->second.Flru);
+    Fpages.erase(it);
+    }
+  }
+
+int TufmCache::dirtyPages() {
+  int n = 0;
+  for (TpageMap::iterator it = Fpages.begin(); it != Fpages.end(); ++it)
+    n += it->second.Fdirty;
+  return n;
+  }
+
+//---------------------------------------------------------------------
+TufmCache::TufmCache(Tpif& Apif, int AmaxPages)
+      : Fpif(Apif), FmaxPages(AmaxPages), FnumPages(0),
+        Fhits(0), Fmisses(0), Fflushed(0), Fruns(0) {
+  assert(AmaxPages >= 0);
+  }
+
+TufmCache::~TufmCache() {
+  flush();
+  }
+
+// EOF ----------------------------------------------------------------
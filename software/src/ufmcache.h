@@ -0,0 +1,67 @@
+// ufmcache.h ---------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// write-back cache of UFM pages, held by Tpif once enabled
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef ufmcacheH
+#define ufmcacheH
+
+#include <stdint.h>
+#include <list>
+#include <map>
+
+#include "pif.h"
+
+#define UFM_CACHE_ALL           0         /* maxPages: no LRU bound */
+
+//---------------------------------------------------------------------
+// reads are served from memory once a page has been seen, writes only
+// mark the page dirty. flush() programs the dirty pages in ascending
+// order, one address set per run of consecutive pages. Beyond
+// AmaxPages the least recently used pages are dropped, flushing first
+// if one of them is dirty.
+class TufmCache {
+  private:
+    struct Tpage {
+      uint8_t Fdata[UFM_PAGE_SIZE];
+      bool    Fdirty;
+      std::list<int>::iterator Flru;
+      };
+    typedef std::map<int, Tpage> TpageMap;
+
+    Tpif&           Fpif;
+    int             FmaxPages;
+    int             FnumPages;          // UFM pages, 0 until known
+    TpageMap        Fpages;
+    std::list<int>  Flru;               // most recently used first
+
+    Tpage& _touch(int pageNumber);
+    void   _trim();
+    int    _numPages();
+
+  public:
+    // statistics, in pages
+    uint64_t  Fhits;
+    uint64_t  Fmisses;
+    uint64_t  Fflushed;
+    uint64_t  Fruns;                    // address sets done by flush()
+
+    bool read(int pageNumber, int numPages, uint8_t *p);
+    bool write(int pageNumber, int numPages, const uint8_t *p);
+    bool flush();
+    void invalidate();                  // after an erase, dirty data is lost
+    void invalidate(int pageNumber, int numPages);
+
+    int  cachedPages() { return (int)Fpages.size(); }
+    int  dirtyPages();
+
+    TufmCache(Tpif& Apif, int AmaxPages=UFM_CACHE_ALL);
+    ~TufmCache();
+  };
+
+#endif
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,227 @@
+// ufmhash.cpp --------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+#include "ufmhash.h"
+
+#define HDR_MAGIC               0
+#define HDR_SEED                4
+#define HDR_BUCKETS             8
+#define HDR_KEY_LEN             10
+#define HDR_VAL_LEN             11
+#define HDR_COUNT               12
+#define HDR_GROUPS              14
+
+#define DIR_PAGES(groups)       (((groups) + UFM_PAGE_SIZE - 1) / UFM_PAGE_SIZE)
+
+//---------------------------------------------------------------------
+// FNV-1a, seeded
+uint32_t ufmHash(const uint8_t *pKey, int AkeyLen, uint32_t Aseed) {
+  uint32_t h = 2166136261u ^ Aseed;
+  for (int i=0; i<AkeyLen; i++) {
+    h ^= pKey[i];
+    h *= 16777619u;
+    }
+  return h ^ (h >> 15);
+  }
+
+//---------------------------------------------------------------------
+int ufmHashBucket(const uint8_t *pKey, int AkeyLen, uint32_t Aseed,
+                                  const uint8_t *pDir, int AnumBuckets) {
+  int g = (int)(ufmHash(pKey, AkeyLen, Aseed) % (uint32_t)AnumBuckets);
+  uint32_t h = ufmHash(pKey, AkeyLen, Aseed ^ ((pDir[g] + 1) * 0x85ebca6bu));
+  return (int)(h % (uint32_t)AnumBuckets);
+  }
+
+int ufmHashPages(int AnumBuckets) {
+  return 1 + DIR_PAGES(AnumBuckets) + AnumBuckets;
+  }
+
+//---------------------------------------------------------------------
+static bool isZero(const uint8_t *p, int Alen) {
+  for (int i=0; i<Alen; i++)
+    if (p[i])
+      return false;
+  return true;
+  }
+
+//=====================================================================
+bool TufmHashBuilder::add(const uint8_t *pKey, const uint8_t *pVal) {
+  if (isZero(pKey, FkeyLen))
+    return false;
+  if (!Fkeys.insert(std::string((const char *)pKey, FkeyLen)).second)
+    return false;
+  Fentries.insert(Fentries.end(), pKey, pKey + FkeyLen);
+  Fentries.insert(Fentries.end(), pVal, pVal + FvalLen);
+  return true;
+  }
+
+//---------------------------------------------------------------------
+void TufmHashBuilder::_header(uint8_t *h, int AnumBuckets, uint32_t Aseed) {
+  memcpy(h + HDR_MAGIC, UFMHASH_MAGIC, 4);
+  h[HDR_SEED+0]    = (uint8_t)(Aseed >> 24);
+  h[HDR_SEED+1]    = (uint8_t)(Aseed >> 16);
+  h[HDR_SEED+2]    = (uint8_t)(Aseed >> 8);
+  h[HDR_SEED+3]    = (uint8_t)Aseed;
+  h[HDR_BUCKETS]   = (uint8_t)(AnumBuckets >> 8);
+  h[HDR_BUCKETS+1] = (uint8_t)AnumBuckets;
+  h[HDR_KEY_LEN]   = (uint8_t)FkeyLen;
+  h[HDR_VAL_LEN]   = (uint8_t)FvalLen;
+  h[HDR_COUNT]     = (uint8_t)(count() >> 8);
+  h[HDR_COUNT+1]   = (uint8_t)count();
+  h[HDR_GROUPS]    = (uint8_t)(AnumBuckets >> 8);
+  h[HDR_GROUPS+1]  = (uint8_t)AnumBuckets;
+  }
+
+//---------------------------------------------------------------------
+// one try at a table seed, false if some group finds no displacement
+bool TufmHashBuilder::_place(int AnumBuckets, uint32_t Aseed,
+                                                std::vector<uint8_t>& pages) {
+  int slot    = FkeyLen + FvalLen;
+  int slots   = slotsPerPage();
+  int dirPages = DIR_PAGES(AnumBuckets);
+
+  // entries by group, biggest groups first
+  std::vector< std::vector<int> > groups(AnumBuckets);
+  for (int i=0; i<count(); i++) {
+    const uint8_t *e = &Fentries[(size_t)i * slot];
+    groups[ufmHash(e, FkeyLen, Aseed) % (uint32_t)AnumBuckets].push_back(i);
+    }
+  std::vector< std::pair<int,int> > order;
+  for (int g=0; g<AnumBuckets; g++)
+    if (!groups[g].empty())
+      order.push_back(std::make_pair(-(int)groups[g].size(), g));
+  std::sort(order.begin(), order.end());
+
+  pages.assign((size_t)ufmHashPages(AnumBuckets) * UFM_PAGE_SIZE, 0);
+  uint8_t *dir     = &pages[UFM_PAGE_SIZE];
+  uint8_t *buckets = &pages[(size_t)(1 + dirPages) * UFM_PAGE_SIZE];
+  std::vector<uint8_t> used(AnumBuckets, 0);
+  std::vector<int>     tryUsed;
+
+  for (size_t o=0; o<order.size(); o++) {
+    const std::vector<int>& grp = groups[order[o].second];
+    bool placed = false;
+    for (int d=0; !placed && (d<256); d++) {
+      dir[order[o].second] = (uint8_t)d;
+      tryUsed.clear();
+      placed = true;
+      for (size_t k=0; placed && (k<grp.size()); k++) {
+        const uint8_t *e = &Fentries[(size_t)grp[k] * slot];
+        int b = ufmHashBucket(e, FkeyLen, Aseed, dir, AnumBuckets);
+        int n = used[b];
+        for (size_t t=0; t<tryUsed.size(); t++)
+          n += (tryUsed[t] == b);
+        placed = (n < slots);
+        tryUsed.push_back(b);
+        }
+      }
+    if (!placed)
+      return false;
+
+    for (size_t k=0; k<grp.size(); k++) {
+      const uint8_t *e = &Fentries[(size_t)grp[k] * slot];
+      int b = tryUsed[k];
+      memcpy(buckets + (size_t)b * UFM_PAGE_SIZE + used[b] * slot, e, slot);
+      used[b]++;
+      }
+    }
+
+  _header(&pages[0], AnumBuckets, Aseed);
+  return true;
+  }
+
+//---------------------------------------------------------------------
+// starts from the fewest buckets that could hold everything and grows
+// by 1/16th each time no table seed works out
+bool TufmHashBuilder::build(std::vector<uint8_t>& pages, int AmaxPages) {
+  int slots = slotsPerPage();
+  if ((slots < 1) || (count() > 0xffff))
+    return false;
+
+  int numBuckets = (count() + slots - 1) / slots;
+  if (numBuckets < 1)
+    numBuckets = 1;
+  while ((ufmHashPages(numBuckets) <= AmaxPages) && (numBuckets <= 0xffff)) {
+    for (uint32_t seed=1; seed<=UFMHASH_SEED_TRIES; seed++)
+      if (_place(numBuckets, seed * 0x9e3779b9u, pages))
+        return true;
+    numBuckets += (numBuckets + 15) / 16;
+    }
+  pages.clear();
+  return false;
+  }
+
+//---------------------------------------------------------------------
+TufmHashBuilder::TufmHashBuilder(int AkeyLen, int AvalLen)
+      : FkeyLen(AkeyLen), FvalLen(AvalLen) {
+  assert((AkeyLen > 0) && (AvalLen >= 0));
+  }
+
+//=====================================================================
+bool TufmHashTable::open(int AstartPage) {
+  uint8_t h[UFM_PAGE_SIZE];
+  FnumBuckets = 0;
+  if (!Fsession.open() || !Fsession.read(AstartPage, 1, h))
+    return false;
+  if (memcmp(h + HDR_MAGIC, UFMHASH_MAGIC, 4) != 0)
+    return false;
+
+  FstartPage  = AstartPage;
+  Fseed       = ((uint32_t)h[HDR_SEED] << 24) | ((uint32_t)h[HDR_SEED+1] << 16) |
+                ((uint32_t)h[HDR_SEED+2] << 8) | h[HDR_SEED+3];
+  FkeyLen     = h[HDR_KEY_LEN];
+  FvalLen     = h[HDR_VAL_LEN];
+  Fcount      = (h[HDR_COUNT] << 8) | h[HDR_COUNT+1];
+  FnumBuckets = (h[HDR_BUCKETS] << 8) | h[HDR_BUCKETS+1];
+  int groups  = (h[HDR_GROUPS] << 8) | h[HDR_GROUPS+1];
+  if ((FkeyLen == 0) || (FkeyLen + FvalLen > UFM_PAGE_SIZE) ||
+      (FnumBuckets == 0) || (groups != FnumBuckets) ||
+      (AstartPage + numPages() > Fsession.numPages())) {
+    FnumBuckets = 0;
+    return false;
+    }
+
+  Fdir.resize((size_t)DIR_PAGES(groups) * UFM_PAGE_SIZE);
+  if (!Fsession.read(AstartPage + 1, DIR_PAGES(groups), &Fdir[0])) {
+    FnumBuckets = 0;
+    return false;
+    }
+  return true;
+  }
+
+//---------------------------------------------------------------------
+bool TufmHashTable::lookup(const uint8_t *pKey, uint8_t *pVal) {
+  if ((FnumBuckets == 0) || isZero(pKey, FkeyLen))
+    return false;
+
+  int b = ufmHashBucket(pKey, FkeyLen, Fseed, &Fdir[0], FnumBuckets);
+  uint8_t page[UFM_PAGE_SIZE];
+  if (!Fsession.read(FstartPage + 1 + DIR_PAGES(FnumBuckets) + b, 1, page))
+    return false;
+
+  int slot = FkeyLen + FvalLen;
+  for (int s=0; s + slot <= UFM_PAGE_SIZE; s += slot)
+    if (memcmp(page + s, pKey, FkeyLen) == 0) {
+      if (pVal)
+        memcpy(pVal, page + s + FkeyLen, FvalLen);
+      return true;
+      }
+  return false;
+  }
+
+//---------------------------------------------------------------------
+TufmHashTable::TufmHashTable(Tpif& Apif)
+      : Fsession(Apif, false), FstartPage(0), Fseed(0), FnumBuckets(0),
+        FkeyLen(0), FvalLen(0), Fcount(0) {
+  }
+
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,104 @@
+// ufmhash.h ----------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// read-only hash tables laid out for the UFM, one page read per lookup
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef ufmhashH
+#define ufmhashH
+
+#include <stdint.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ufm.h"
+
+#define UFMHASH_MAGIC           "UHT1"
+#define UFMHASH_SEED_TRIES      16        /* table seeds per bucket count */
+
+//---------------------------------------------------------------------
+// hash and displace: a key picks a group with the table seed, the
+// group's displacement byte then picks the bucket. Every bucket is one
+// UFM page and is never over-full, so with the displacements held in
+// RAM any key is found with a single page read.
+//
+// table layout, starting at any UFM page:
+//   header page      magic, seed (BE32), buckets (BE16), key length,
+//                    value length, entries (BE16), groups (BE16)
+//   directory pages  one displacement byte per group
+//   bucket pages     (key,value) slots, unused slots all zero
+// Keys and values are fixed size and a slot must fit in a page. The
+// all-zero key marks a free slot and cannot be stored.
+uint32_t ufmHash(const uint8_t *pKey, int AkeyLen, uint32_t Aseed);
+
+// bucket for a key, given the table seed and directory
+int ufmHashBucket(const uint8_t *pKey, int AkeyLen, uint32_t Aseed,
+                                  const uint8_t *pDir, int AnumBuckets);
+
+// pages used by a table with AnumBuckets buckets (one group each)
+int ufmHashPages(int AnumBuckets);
+
+//---------------------------------------------------------------------
+// collects the entries, then places the biggest groups first, trying
+// displacements until each group's keys land in buckets with room
+class TufmHashBuilder {
+  private:
+    int                    FkeyLen;
+    int                    FvalLen;
+    std::vector<uint8_t>   Fentries;    // key then value, back to back
+    std::set<std::string>  Fkeys;
+
+    bool _place(int AnumBuckets, uint32_t Aseed, std::vector<uint8_t>& pages);
+    void _header(uint8_t *h, int AnumBuckets, uint32_t Aseed);
+
+  public:
+    int  slotsPerPage() { return UFM_PAGE_SIZE / (FkeyLen + FvalLen); }
+    int  count()        { return (int)Fkeys.size(); }
+    int  keyLen()       { return FkeyLen; }
+    int  valLen()       { return FvalLen; }
+
+    // false on a duplicate or all-zero key
+    bool add(const uint8_t *pKey, const uint8_t *pVal);
+
+    // header, directory and buckets, whole pages. Fails if the table
+    // would need more than AmaxPages.
+    bool build(std::vector<uint8_t>& pages, int AmaxPages);
+
+    TufmHashBuilder(int AkeyLen, int AvalLen);
+  };
+
+//---------------------------------------------------------------------
+// a table already in the UFM. open() reads the header and directory
+// pages, after that every lookup is one address set and one page read.
+class TufmHashTable {
+  private:
+    TufmSession  Fsession;
+    int          FstartPage;
+    uint32_t     Fseed;
+    int          FnumBuckets;
+    int          FkeyLen;
+    int          FvalLen;
+    int          Fcount;
+    std::vector<uint8_t> Fdir;          // displacement per group
+
+  public:
+    bool open(int AstartPage);
+    bool close() { return Fsession.close(); }
+
+    // true and the value in pVal if the key is present
+    bool lookup(const uint8_t *pKey, uint8_t *pVal);
+
+    int  keyLen()   { return FkeyLen; }
+    int  valLen()   { return FvalLen; }
+    int  count()    { return Fcount; }
+    int  numPages() { return ufmHashPages(FnumBuckets); }
+
+    TufmHashTable(Tpif& Apif);
+  };
+
+#endif
+// EOF ----------------------------------------------------------------
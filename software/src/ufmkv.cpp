@@ -0,0 +1,304 @@
+// ufmkv.cpp ----------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ufmkv.h"
+
+//---------------------------------------------------------------------
+int TufmKV::_pagesFor(int AkeyLen, int AvalLen) {
+  int len = UFMKV_HDR_SIZE + AkeyLen + AvalLen;
+  return (len + UFM_PAGE_SIZE - 1) / UFM_PAGE_SIZE;
+  }
+
+// xor of the record, header check byte excluded
+uint8_t TufmKV::_check(const uint8_t *p, int Alen) {
+  uint8_t v = 0x5a;
+  for (int i=0; i<Alen; i++)
+    if (i != UFMKV_HDR_SIZE-1)
+      v ^= p[i];
+  return v;
+  }
+
+bool TufmKV::_blank(const uint8_t *p) {
+  for (int i=0; i<UFM_PAGE_SIZE; i++)
+    if (p[i])
+      return false;
+  return true;
+  }
+
+// the pages a record header claims, 0 if it is no header or the record
+// would not end by AmaxPages
+int TufmKV::_recordPages(const uint8_t *p, int AmaxPages) {
+  int valLen  = (p[2] << 8) | p[3];
+  int dataLen = (valLen == UFMKV_TOMBSTONE) ? 0 : valLen;
+  int n = _pagesFor(p[1], dataLen);
+  if ((p[0] != UFMKV_MAGIC) || (p[1] == 0) || (n > AmaxPages))
+    return 0;
+  return n;
+  }
+
+// the check byte matches header, key and value
+bool TufmKV::_intact(const uint8_t *p) {
+  int valLen  = (p[2] << 8) | p[3];
+  int dataLen = (valLen == UFMKV_TOMBSTONE) ? 0 : valLen;
+  return _check(p, UFMKV_HDR_SIZE + p[1] + dataLen) == p[UFMKV_HDR_SIZE-1];
+  }
+
+//---------------------------------------------------------------------
+// the whole UFM in one session and one burst read, then the index is
+// rebuilt from memory. The log ends after the last page that is not
+// blank. A record that fails its check was torn by a power loss; its
+// pages are stepped over as its header claims, since any of them may
+// have been programmed, with zeros or not, and must not be again.
+bool TufmKV::_scan() {
+  int numPages = Fsession.numPages();
+  std::vector<uint8_t> img((size_t)numPages * UFM_PAGE_SIZE);
+  if (!Fsession.read(0, numPages, &img[0]))
+    return false;
+
+  int end = numPages;
+  while ((end > 0) && _blank(&img[(size_t)(end-1) * UFM_PAGE_SIZE]))
+    end--;
+
+  Findex.clear();
+  FdeadPages = 0;
+  int pg = 0;
+  while (pg < end) {
+    const uint8_t *p = &img[(size_t)pg * UFM_PAGE_SIZE];
+    int keyLen = p[1];
+    int valLen = (p[2] << 8) | p[3];
+    int n = _recordPages(p, numPages - pg);
+
+    if (!n) {                           // blank or foreign page
+      FdeadPages++;
+      pg++;
+      continue;
+      }
+    if (!_intact(p)) {
+      FdeadPages += n;                  // torn record
+      pg += n;
+      continue;
+      }
+
+    std::string key((const char *)p + UFMKV_HDR_SIZE, keyLen);
+    Tindex::iterator it = Findex.find(key);
+    if (it != Findex.end()) {
+      FdeadPages += _pagesFor(keyLen, it->second.FvalLen);
+      Findex.erase(it);
+      }
+    if (valLen == UFMKV_TOMBSTONE)
+      FdeadPages += n;
+    else {
+      Tloc loc = { pg, valLen };
+      Findex[key] = loc;
+      }
+    pg += n;
+    }
+  FnextPage = pg;
+  return true;
+  }
+
+//---------------------------------------------------------------------
+bool TufmKV::_readRecord(const Tloc& loc, int AkeyLen, std::vector<uint8_t>& buf) {
+  int n = _pagesFor(AkeyLen, loc.FvalLen);
+  buf.resize((size_t)n * UFM_PAGE_SIZE);
+  return Fsession.read(loc.Fpage, n, &buf[0]);
+  }
+
+//---------------------------------------------------------------------
+bool TufmKV::_append(const std::string& key, const uint8_t *pVal, int AvalLen) {
+  int keyLen  = (int)key.size();
+  int dataLen = (AvalLen == UFMKV_TOMBSTONE) ? 0 : AvalLen;
+  int n = _pagesFor(keyLen, dataLen);
+
+  if ((FnextPage + n > Fsession.numPages()) && !_compact(n))
+    return false;
+
+  std::vector<uint8_t> rec((size_t)n * UFM_PAGE_SIZE, 0);
+  rec[0] = UFMKV_MAGIC;
+  rec[1] = (uint8_t)keyLen;
+  rec[2] = (uint8_t)(AvalLen >> 8);
+  rec[3] = (uint8_t)AvalLen;
+  memcpy(&rec[UFMKV_HDR_SIZE], key.data(), keyLen);
+  if (dataLen)
+    memcpy(&rec[UFMKV_HDR_SIZE + keyLen], pVal, dataLen);
+  rec[UFMKV_HDR_SIZE-1] = _check(&rec[0], UFMKV_HDR_SIZE + keyLen + dataLen);
+
+  int pg = FnextPage;
+  FnextPage += n;                       // used even if the write fails
+  if (!Fsession.write(pg, n, &rec[0]))
+    return false;
+  FpagesWritten += n;
+
+  Tindex::iterator it = Findex.find(key);
+  if (it != Findex.end()) {
+    FdeadPages += _pagesFor(keyLen, it->second.FvalLen);
+    Findex.erase(it);
+    }
+  if (AvalLen == UFMKV_TOMBSTONE)
+    FdeadPages += n;
+  else {
+    Tloc loc = { pg, AvalLen };
+    Findex[key] = loc;
+    }
+  return true;
+  }
+
+//---------------------------------------------------------------------
+// live records are collected in RAM, spilled if there is a spill file,
+// then one sector erase
+bool TufmKV::_compact(int AneedPages) {
+  int pages = 0;
+  for (Tindex::iterator it = Findex.begin(); it != Findex.end(); ++it)
+    pages += _pagesFor((int)it->first.size(), it->second.FvalLen);
+  if (pages + AneedPages > Fsession.numPages())
+    return false;
+
+  std::vector<uint8_t> live, rec;
+  for (Tindex::iterator it = Findex.begin(); it != Findex.end(); ++it) {
+    if (!_readRecord(it->second, (int)it->first.size(), rec))
+      return false;
+    live.insert(live.end(), rec.begin(), rec.end());
+    }
+
+  if (!FspillPath.empty() && !_spill(live))
+    return false;
+  if (!_rewrite(live))
+    return false;
+  if (!FspillPath.empty())
+    unlink(FspillPath.c_str());
+  return true;
+  }
+
+// the records back to back from page 0, then the index from the UFM
+bool TufmKV::_rewrite(const std::vector<uint8_t>& live) {
+  if (!Fsession.erase())
+    return false;
+  Ferases++;
+
+  int n = (int)(live.size() / UFM_PAGE_SIZE);
+  if (n && !Fsession.write(0, n, &live[0]))
+    return false;
+  FpagesWritten += n;
+  return _scan();
+  }
+
+//---------------------------------------------------------------------
+// the records, then a trailer page: magic and the record page count
+bool TufmKV::_spill(const std::vector<uint8_t>& live) {
+  int n = (int)(live.size() / UFM_PAGE_SIZE);
+  uint8_t trailer[UFM_PAGE_SIZE];
+  memset(trailer, 0, sizeof(trailer));
+  memcpy(trailer, UFMKV_SPILL_MAGIC, 8);
+  trailer[8] = (uint8_t)(n >> 8);
+  trailer[9] = (uint8_t)n;
+
+  int fd = ::open(FspillPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+  bool ok = live.empty() ||
+            (write(fd, &live[0], live.size()) == (ssize_t)live.size());
+  ok = ok && (write(fd, trailer, sizeof(trailer)) == (ssize_t)sizeof(trailer));
+  ok = ok && (fsync(fd) == 0);
+  return (::close(fd) == 0) && ok;
+  }
+
+// a spill file is only left by a compaction that did not finish. If it
+// is complete the UFM may be half rewritten, so it is rebuilt from the
+// file; a torn one was never followed by the erase.
+bool TufmKV::_recover() {
+  if (FspillPath.empty())
+    return true;
+  FILE *fd = fopen(FspillPath.c_str(), "rb");
+  if (!fd)
+    return true;
+
+  std::vector<uint8_t> live;
+  uint8_t page[UFM_PAGE_SIZE];
+  while (fread(page, 1, sizeof(page), fd) == sizeof(page))
+    live.insert(live.end(), page, page + sizeof(page));
+  bool torn = !feof(fd) || live.empty();
+  fclose(fd);
+
+  int n = (int)(live.size() / UFM_PAGE_SIZE) - 1;
+  if (!torn) {
+    const uint8_t *t = &live[(size_t)n * UFM_PAGE_SIZE];
+    torn = (memcmp(t, UFMKV_SPILL_MAGIC, 8) != 0) || (((t[8] << 8) | t[9]) != n);
+    }
+  for (int pg=0; !torn && (pg<n); ) {
+    const uint8_t *p = &live[(size_t)pg * UFM_PAGE_SIZE];
+    int m = _recordPages(p, n - pg);
+    torn = !m || !_intact(p);
+    pg += m;
+    }
+
+  if (!torn) {
+    live.resize((size_t)n * UFM_PAGE_SIZE);
+    if (!_rewrite(live))
+      return false;
+    }
+  unlink(FspillPath.c_str());
+  return true;
+  }
+
+//---------------------------------------------------------------------
+bool TufmKV::open() {
+  return Fsession.open() && _recover() && _scan();
+  }
+
+bool TufmKV::close() {
+  Findex.clear();
+  return Fsession.close();
+  }
+
+//---------------------------------------------------------------------
+int TufmKV::get(const std::string& key, uint8_t *pBuf, int AbufLen) {
+  Tindex::iterator it = Findex.find(key);
+  if (it == Findex.end())
+    return -1;
+
+  std::vector<uint8_t> rec;
+  if (!_readRecord(it->second, (int)key.size(), rec))
+    return -1;
+  int n = it->second.FvalLen;
+  if (pBuf)
+    memcpy(pBuf, &rec[UFMKV_HDR_SIZE + key.size()], (n < AbufLen) ? n : AbufLen);
+  return n;
+  }
+
+//---------------------------------------------------------------------
+bool TufmKV::put(const std::string& key, const uint8_t *pVal, int AvalLen) {
+  if (key.empty() || (key.size() > UFMKV_MAX_KEY) ||
+                     (AvalLen < 0) || (AvalLen > UFMKV_MAX_VALUE))
+    return false;
+  assert(pVal || (AvalLen == 0));
+  return _append(key, pVal, AvalLen);
+  }
+
+bool TufmKV::remove(const std::string& key) {
+  if (Findex.find(key) == Findex.end())
+    return true;
+  return _append(key, 0, UFMKV_TOMBSTONE);
+  }
+
+//---------------------------------------------------------------------
+TufmKV::TufmKV(Tpif& Apif, const char *pSpillPath)
+      : Fsession(Apif, false), FspillPath(pSpillPath ? pSpillPath : ""),
+        FnextPage(0), FdeadPages(0), FpagesWritten(0), Ferases(0) {
+  }
+
+TufmKV::~TufmKV() {
+  close();
+  }
+
+// EOF ----------------------------------------------------------------
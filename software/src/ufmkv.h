@@ -0,0 +1,92 @@
+// ufmkv.h ------------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// a small log-structured key/value store in the UFM
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef ufmkvH
+#define ufmkvH
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ufm.h"
+
+#define UFMKV_MAGIC             0xa5      /* erased UFM reads as 0x00 */
+#define UFMKV_HDR_SIZE          5
+#define UFMKV_TOMBSTONE         0xffff    /* value length of a delete */
+#define UFMKV_MAX_KEY           255
+#define UFMKV_MAX_VALUE         1024
+#define UFMKV_SPILL_MAGIC       "ufmkvspl" /* 8 bytes, spill file trailer */
+
+//---------------------------------------------------------------------
+// records are appended to the next free page, each one
+//   magic, key length, value length (BE16), check byte, key, value
+// padded out to a whole page. A later record for the same key wins.
+// The UFM can only be erased as a whole, so when the log reaches the
+// end the live records are read back, the sector is erased once and
+// they are rewritten from page 0.
+//
+// Between that erase and the rewrite the live records are only in RAM.
+// Given a spill file they are first written there, with a trailer and
+// synced, and the file is removed once the rewrite is done. open()
+// finding a complete spill file erases and rewrites the UFM from it; a
+// torn one means the erase never started. Without a spill file a power
+// loss in that window loses the store.
+class TufmKV {
+  private:
+    struct Tloc {
+      int       Fpage;
+      int       FvalLen;
+      };
+    typedef std::map<std::string, Tloc> Tindex;
+
+    TufmSession   Fsession;
+    std::string   FspillPath;           // empty, no spill file
+    Tindex        Findex;
+    int           FnextPage;            // first free page
+    int           FdeadPages;           // superseded or deleted records
+
+    static int     _pagesFor(int AkeyLen, int AvalLen);
+    static uint8_t _check(const uint8_t *p, int Alen);
+    static bool    _blank(const uint8_t *p);
+    static int     _recordPages(const uint8_t *p, int AmaxPages);
+    static bool    _intact(const uint8_t *p);
+
+    bool _scan();
+    bool _readRecord(const Tloc& loc, int AkeyLen, std::vector<uint8_t>& buf);
+    bool _append(const std::string& key, const uint8_t *pVal, int AvalLen);
+    bool _compact(int AneedPages);
+    bool _rewrite(const std::vector<uint8_t>& live);
+    bool _spill(const std::vector<uint8_t>& live);
+    bool _recover();
+
+  public:
+    // statistics
+    uint64_t  FpagesWritten;
+    uint64_t  Ferases;
+
+    bool open();                        // reads the whole UFM once
+    bool close();
+
+    // returns the value length, -1 if not found. At most AbufLen
+    // bytes are copied.
+    int  get(const std::string& key, uint8_t *pBuf, int AbufLen);
+    bool put(const std::string& key, const uint8_t *pVal, int AvalLen);
+    bool remove(const std::string& key);
+
+    int  count()     { return (int)Findex.size(); }
+    int  freePages() { return Fsession.numPages() - FnextPage; }
+    int  deadPages() { return FdeadPages; }
+
+    TufmKV(Tpif& Apif, const char *pSpillPath=0);
+    ~TufmKV();
+  };
+
+#endif
+// EOF ----------------------------------------------------------------
@@ -0,0 +1,82 @@
+// xo2.cpp ------------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+
+#include <assert.h>
+#include <string.h>
+
+#include "xo2.h"
+
+#define XO2_ID_MASK             0xffff8fff      /* model bits cleared */
+
+static const Txo2Device devices[] = {
+  //  name          model  ID code      cfg   ufm
+  { "XO2-1200HC",   2,     0x012ba043,  2175,  512 },
+  { "XO2-2000HC",   3,     0x012bb043,  3198,  640 },
+  { "XO2-4000HC",   4,     0x012bc043,  5758,  768 },
+  { "XO2-7000HC",   5,     0x012bd043,  9212, 2048 },
+  };
+static const int numDevices = sizeof(devices) / sizeof(devices[0]);
+
+//---------------------------------------------------------------------
+const Txo2Device *xo2FindDevice(uint32_t idCode) {
+  if ((idCode & XO2_ID_MASK) != (devices[0].idCode & XO2_ID_MASK))
+    return 0;
+  int model = (idCode >> 12) & 7;
+  for (int i=0; i<numDevices; i++)
+    if (devices[i].model == model)
+      return &devices[i];
+  return 0;
+  }
+
+const Txo2Device *xo2DeviceList(int *pCount) {
+  *pCount = numDevices;
+  return devices;
+  }
+
+//---------------------------------------------------------------------
+void xo2DecodeStatus(uint32_t v, Txo2Status& s) {
+  s.done    = ((v >>  8) & 1) != 0;
+  s.cfgEna  = ((v >>  9) & 1) != 0;
+  s.busy    = ((v >> 12) & 1) != 0;
+  s.fail    = ((v >> 13) & 1) != 0;
+  s.errCode =  (v >> 23) & 7;
+  }
+
+//---------------------------------------------------------------------
+const char *xo2ErrString(int errCode) {
+  switch (errCode) {
+    case 0: return "No Error";
+    case 1: return "ID ERR";
+    case 2: return "CMD ERR";
+    case 3: return "CRC ERR";
+    case 4: return "Preamble ERR";
+    case 5: return "Abort ERR";
+    case 6: return "Overflow ERR";
+    case 7: return "SDM EOF";
+    }
+  return "?";
+  }
+
+//---------------------------------------------------------------------
+int xo2ComparePages(const uint8_t *pA, const uint8_t *pB,
+                                            int numPages, int pageSize) {
+  assert((numPages >= 0) && (pageSize > 0));
+  // one big compare first, the page search only happens on a mismatch
+  if (memcmp(pA, pB, (size_t)numPages * pageSize) == 0)
+    return -1;
+
+  for (int i=0; i<numPages; i++) {
+    if (memcmp(pA, pB, pageSize) != 0)
+      return i;
+    pA += pageSize;
+    pB += pageSize;
+    }
+  return -1;
+  }
+
+// EOF ----------------------------------------------------------------
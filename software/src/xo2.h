@@ -0,0 +1,77 @@
+// xo2.h --------------------------------------------------------------
+//
+// Copyright (c) 2001 to 2013  te
+//
+// MachXO2 device knowledge that needs no hardware access
+//
+// Licence: Creative Commons Attribution-ShareAlike 3.0 Unported License.
+//          http://creativecommons.org/licenses/by-sa/3.0/
+//---------------------------------------------------------------------
+#ifndef xo2H
+#define xo2H
+
+#include <stdint.h>
+
+//---------------------------------------------------------------------
+// sysCONFIG commands, see the table at the top of pif.cpp
+#define ISC_ERASE               0x0e
+#define ISC_DISABLE             0x26
+#define ISC_INIT_CFG_ADDR       0x46
+#define ISC_INIT_UFM_ADDR       0x47
+#define ISC_PROG_DONE           0x5e
+#define ISC_PROG_CFG_INCR       0x70
+#define ISC_READ_CFG_INCR       0x73
+#define ISC_ENABLE_X            0x74
+#define ISC_REFRESH             0x79
+#define ISC_ENABLE_PROG         0xc6
+#define ISC_PROG_UFM_INCR       0xc9
+#define ISC_READ_UFM_INCR       0xca
+#define ISC_ERASE_UFM           0xcb
+#define LSC_WRITE_ADDRESS       0xb4
+
+#define BYPASS                  0xff
+#define CHECK_BUSY_FLAG         0xf0
+
+#define READ_DEVICE_ID_CODE     0xe0
+#define READ_STATUS_REG         0x3c
+#define READ_TRACE_ID_CODE      0x19
+
+#define READ_USERCODE           0xc0
+#define ISC_PROGRAM_USERCODE    0xc2
+
+#define XO2_HDR_LEN             4         /* command + 3 operand bytes */
+#define XO2_PROG_FRAME_SIZE     (XO2_HDR_LEN + 16)  /* header + page */
+
+//---------------------------------------------------------------------
+// densities the loader knows about, page counts match pifglobs.py
+struct Txo2Device {
+  const char *name;
+  int         model;                  // ID code bits 14..12
+  uint32_t    idCode;
+  int         cfgPages;
+  int         ufmPages;
+  };
+
+// NULL if the ID code is not a recognised XO2
+const Txo2Device *xo2FindDevice(uint32_t idCode);
+const Txo2Device *xo2DeviceList(int *pCount);
+
+//---------------------------------------------------------------------
+// configuration status register, as returned by READ_STATUS_REG
+struct Txo2Status {
+  bool done;
+  bool cfgEna;
+  bool busy;
+  bool fail;
+  int  errCode;                   // flash check result, 0 = no error
+  };
+
+void        xo2DecodeStatus(uint32_t v, Txo2Status& s);
+const char *xo2ErrString(int errCode);
+
+// returns the index of the first page that differs, or -1 if they match
+int         xo2ComparePages(const uint8_t *pA, const uint8_t *pB,
+                                            int numPages, int pageSize);
+
+#endif
+// EOF ----------------------------------------------------------------